@@ -0,0 +1,275 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "decoderservice.h"
+#include "sharedframe.h"
+#include "third_party/common/qthelper.hpp"
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QSocketNotifier>
+#include <QDebug>
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr int kPositionInterval = 1000; // ms
+
+DecoderService::DecoderService(int s, QObject *parent)
+    : QObject(parent), sock(s)
+{
+    positionTimer.setInterval(kPositionInterval);
+    connect(&positionTimer, &QTimer::timeout, this, &DecoderService::reportPosition);
+}
+
+DecoderService::~DecoderService()
+{
+    if (renderContext)
+        mpv_render_context_free(renderContext);
+    if (mpv)
+        mpv_terminate_destroy(mpv);
+    release();
+    if (sock >= 0)
+        close(sock);
+}
+
+bool DecoderService::init()
+{
+    mpv = mpv_create();
+    if (!mpv) {
+        qCritical() << "could not create mpv context";
+        return false;
+    }
+
+    mpv_set_option_string(mpv, "vo", "libmpv");
+    if (mpv_initialize(mpv) < 0) {
+        qCritical() << "could not initialize mpv context";
+        return false;
+    }
+
+    mpv::qt::set_option_variant(mpv, "hwdec", "auto-copy");
+    // no audio is demuxed or decoded until the desktop selects a track.
+    mpv::qt::set_option_variant(mpv, "aid", "no");
+    mpv::qt::set_option_variant(mpv, "loop", "inf");
+    // resuming seeks to a keyframe, no decoding up to the exact position.
+    mpv::qt::set_option_variant(mpv, "hr-seek", "no");
+
+    mpv_render_param params[] {
+        {MPV_RENDER_PARAM_API_TYPE, const_cast<char *>(MPV_RENDER_API_TYPE_SW)},
+        {MPV_RENDER_PARAM_INVALID, nullptr}};
+    if (mpv_render_context_create(&renderContext, mpv, params) < 0) {
+        qCritical() << "failed to initialize mpv software render context";
+        renderContext = nullptr;
+        return false;
+    }
+
+    mpv_render_context_set_update_callback(renderContext, DecoderService::onUpdate, this);
+    mpv_set_wakeup_callback(mpv, DecoderService::wakeup, this);
+
+    notifier = new QSocketNotifier(sock, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &DecoderService::onMessage);
+    return true;
+}
+
+void DecoderService::onMessage()
+{
+    QByteArray msg;
+    int fd = -1;
+    while (SharedFrame::receiveMessage(sock, &msg, &fd)) {
+        if (fd >= 0)
+            close(fd);
+
+        if (msg.isEmpty())
+            return;
+
+        QJsonParseError error;
+        const QJsonDocument doc = QJsonDocument::fromJson(msg, &error);
+        if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+            qWarning() << "invalid message" << error.errorString();
+            continue;
+        }
+
+        handle(doc.object());
+    }
+
+    // the desktop is gone.
+    notifier->setEnabled(false);
+    qApp->quit();
+}
+
+void DecoderService::handle(const QJsonObject &msg)
+{
+    const QString cmd = msg.value("cmd").toString();
+    if (cmd == "load") {
+        const qreal start = msg.value("start").toDouble();
+        // resume where the crashed instance was.
+        mpv::qt::set_property_variant(mpv, "start", start > 0 ? QString::number(start, 'f', 3) : QString("none"));
+        mpv::qt::command_variant(mpv, QVariantList { "loadfile", msg.value("file").toString() });
+        positionTimer.start();
+    } else if (cmd == "stop") {
+        mpv::qt::command_variant(mpv, QVariantList { "stop" });
+        positionTimer.stop();
+    } else if (cmd == "pause") {
+        mpv::qt::set_property_variant(mpv, "pause", msg.value("value").toBool());
+    } else if (cmd == "size") {
+        // cover the frame when it spans screens, letterbox otherwise.
+        mpv::qt::set_property_variant(mpv, "panscan", msg.value("cover").toBool() ? 1.0 : 0.0);
+        allocate(QSize(msg.value("width").toInt(), msg.value("height").toInt()));
+    } else if (cmd == "set") {
+        mpv::qt::set_property_variant(mpv, msg.value("name").toString(), msg.value("value").toVariant());
+    } else {
+        qWarning() << "unknown command" << cmd;
+    }
+}
+
+void DecoderService::send(const QJsonObject &msg, int fd)
+{
+    SharedFrame::sendMessage(sock, QJsonDocument(msg).toJson(QJsonDocument::Compact), fd);
+}
+
+bool DecoderService::allocate(const QSize &s)
+{
+    if (s == size)
+        return true;
+
+    if (s.isEmpty() || s.width() > 16384 || s.height() > 16384) {
+        qWarning() << "invalid frame size" << s;
+        return false;
+    }
+
+    const uint32_t stride = static_cast<uint32_t>(s.width()) * 4;
+    const size_t len = SharedFrame::bufferSize(stride, static_cast<uint32_t>(s.height()));
+
+    int fd = memfd_create("videowallpaper-frames", MFD_CLOEXEC);
+    if (fd < 0) {
+        qCritical() << "memfd_create failed" << strerror(errno);
+        return false;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(len)) < 0) {
+        qCritical() << "ftruncate failed" << strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    void *mem = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) {
+        qCritical() << "mmap failed" << strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    // the file is zero filled, so are the atomics.
+    auto header = static_cast<SharedFrame::Header *>(mem);
+    header->magic = SharedFrame::kMagic;
+    header->version = SharedFrame::kVersion;
+    header->width = static_cast<uint32_t>(s.width());
+    header->height = static_cast<uint32_t>(s.height());
+    header->stride = stride;
+    header->slots = SharedFrame::kSlots;
+    header->latest.store(SharedFrame::kNoSlot);
+    header->reading.store(SharedFrame::kNoSlot);
+
+    // the client keeps the old buffer mapped while frames of it are still shown.
+    release();
+    map = mem;
+    mapSize = len;
+    size = s;
+
+    send(QJsonObject { { "event", "buffer" }, { "width", s.width() }, { "height", s.height() } }, fd);
+    close(fd);
+
+    // a paused video still has to fill the new buffer.
+    mpv::qt::command_variant(mpv, QVariantList { "seek", 0, "relative+exact" });
+    return true;
+}
+
+void DecoderService::release()
+{
+    if (map)
+        munmap(map, mapSize);
+    map = nullptr;
+    mapSize = 0;
+    size = QSize();
+}
+
+void DecoderService::render()
+{
+    if (!renderContext)
+        return;
+
+    if (!(mpv_render_context_update(renderContext) & MPV_RENDER_UPDATE_FRAME))
+        return;
+
+    if (!map)
+        return;
+
+    auto header = static_cast<SharedFrame::Header *>(map);
+    // pairs with the claim of the plugin: it stores reading then reads latest,
+    // this stores latest then reads reading, that needs seq_cst on both sides.
+    const uint32_t latest = header->latest.load(std::memory_order_seq_cst);
+    const uint32_t reading = header->reading.load(std::memory_order_seq_cst);
+    uint32_t slot = 0;
+    while (slot == latest || slot == reading)
+        ++slot;
+
+    int swSize[2] = { size.width(), size.height() };
+    // as allocated, the header is mapped by the plugin too.
+    const uint32_t rowBytes = static_cast<uint32_t>(size.width()) * 4;
+    size_t stride = rowBytes;
+    uchar *data = SharedFrame::slotData(map, rowBytes, static_cast<uint32_t>(size.height()), slot);
+    mpv_render_param params[] {
+        {MPV_RENDER_PARAM_SW_SIZE, swSize},
+        {MPV_RENDER_PARAM_SW_FORMAT, const_cast<char *>("rgb0")},
+        {MPV_RENDER_PARAM_SW_STRIDE, &stride},
+        {MPV_RENDER_PARAM_SW_POINTER, data},
+        {MPV_RENDER_PARAM_INVALID, nullptr}};
+
+    if (mpv_render_context_render(renderContext, params) < 0)
+        return;
+
+    header->latest.store(slot, std::memory_order_seq_cst);
+    header->sequence.fetch_add(1, std::memory_order_seq_cst);
+
+    send(QJsonObject { { "event", "frame" } });
+}
+
+void DecoderService::reportPosition()
+{
+    const QVariant pos = mpv::qt::get_property_variant(mpv, "time-pos");
+    if (pos.isValid())
+        send(QJsonObject { { "event", "position" }, { "value", pos.toDouble() } });
+}
+
+void DecoderService::onMpvEvents()
+{
+    while (mpv) {
+        mpv_event *event = mpv_wait_event(mpv, 0);
+        if (event->event_id == MPV_EVENT_NONE)
+            break;
+
+        if (event->event_id == MPV_EVENT_END_FILE) {
+            auto end = static_cast<mpv_event_end_file *>(event->data);
+            if (end && end->reason == MPV_END_FILE_REASON_ERROR)
+                send(QJsonObject { { "event", "error" }, { "reason", QString(mpv_error_string(end->error)) } });
+        }
+    }
+}
+
+void DecoderService::onUpdate(void *ctx)
+{
+    QMetaObject::invokeMethod(reinterpret_cast<DecoderService *>(ctx),
+                              &DecoderService::render,
+                              Qt::QueuedConnection);
+}
+
+void DecoderService::wakeup(void *ctx)
+{
+    QMetaObject::invokeMethod(reinterpret_cast<DecoderService *>(ctx),
+                              &DecoderService::onMpvEvents,
+                              Qt::QueuedConnection);
+}
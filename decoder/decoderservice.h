@@ -0,0 +1,56 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DECODERSERVICE_H
+#define DECODERSERVICE_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QSize>
+#include <QTimer>
+
+#include <mpv/client.h>
+#include <mpv/render.h>
+
+class QSocketNotifier;
+
+/**
+ * Decodes with libmpv into a shared memory ring, see sharedframe.h.
+ */
+class DecoderService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DecoderService(int sock, QObject *parent = nullptr);
+    ~DecoderService() override;
+    bool init();
+
+private slots:
+    void onMessage();
+    void onMpvEvents();
+    void render();
+    void reportPosition();
+
+private:
+    void handle(const QJsonObject &msg);
+    void send(const QJsonObject &msg, int fd = -1);
+    bool allocate(const QSize &size);
+    void release();
+
+    static void onUpdate(void *ctx);
+    static void wakeup(void *ctx);
+
+private:
+    int sock = -1;
+    QSocketNotifier *notifier = nullptr;
+    QTimer positionTimer;
+    mpv_handle *mpv = nullptr;
+    mpv_render_context *renderContext = nullptr;
+    void *map = nullptr;
+    size_t mapSize = 0;
+    QSize size;
+};
+
+#endif // DECODERSERVICE_H
@@ -0,0 +1,387 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "hostservice.h"
+#include "hoststream.h"
+#include "sharedframe.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QSocketNotifier>
+#include <QVector>
+
+#include <grp.h>
+#include <pwd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr int kPositionInterval = 1000; // ms
+static constexpr int kLinger = 5000; // ms, a reloading desktop comes back meanwhile
+static constexpr int kMaxPeersPerUser = 8;
+static constexpr int kMaxStreams = 16;
+static constexpr int kMaxStreamsPerUser = 4; // lingering ones included
+static constexpr int kMaxFrameWidth = 7680; // the largest outputs there are
+static constexpr int kMaxFrameHeight = 4320;
+static constexpr int kSystemdFd = 3; // SD_LISTEN_FDS_START
+
+HostService::HostService(QObject *parent)
+    : QObject(parent)
+{
+    positionTimer.setInterval(kPositionInterval);
+    connect(&positionTimer, &QTimer::timeout, this, &HostService::reportPosition);
+}
+
+HostService::~HostService()
+{
+    for (Peer *peer : peers.values())
+        removePeer(peer);
+
+    for (const Stream &stream : streams.values())
+        delete stream.decoder;
+
+    if (listener >= 0)
+        close(listener);
+}
+
+void HostService::setAllowedGroup(gid_t gid)
+{
+    restricted = true;
+    allowedGroup = gid;
+}
+
+bool HostService::listen(const QString &path)
+{
+    // every session could write into the frames of the others.
+    if (!HostStream::canSeal()) {
+        qCritical() << "frame buffers can not be sealed read only, refuse to serve the host.";
+        return false;
+    }
+
+    const bool activated = qgetenv("LISTEN_PID").toLongLong() == getpid() && qgetenv("LISTEN_FDS").toInt() == 1;
+    if (activated) {
+        listener = kSystemdFd;
+        fcntl(listener, F_SETFD, FD_CLOEXEC);
+    } else {
+        listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (listener < 0) {
+            qCritical() << "socket failed" << strerror(errno);
+            return false;
+        }
+
+        sockaddr_un addr {};
+        addr.sun_family = AF_UNIX;
+        const QByteArray name = QFile::encodeName(path);
+        if (name.size() >= static_cast<int>(sizeof(addr.sun_path))) {
+            qCritical() << "socket path is too long" << path;
+            return false;
+        }
+        memcpy(addr.sun_path, name.constData(), static_cast<size_t>(name.size()));
+
+        unlink(name.constData());
+        if (bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+            qCritical() << "bind" << path << "failed" << strerror(errno);
+            return false;
+        }
+        // who may connect is decided by the peer credentials.
+        chmod(name.constData(), 0666);
+
+        if (::listen(listener, SOMAXCONN) < 0) {
+            qCritical() << "listen failed" << strerror(errno);
+            return false;
+        }
+    }
+
+    notifier = new QSocketNotifier(listener, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &HostService::onConnection);
+    positionTimer.start();
+    qInfo() << "host decoder is listening on" << (activated ? QString("the systemd socket") : path);
+    return true;
+}
+
+bool HostService::isAllowed(uid_t uid) const
+{
+    if (!restricted || uid == 0 || uid == getuid())
+        return true;
+
+    passwd *pw = getpwuid(uid);
+    if (!pw)
+        return false;
+
+    int count = 0;
+    getgrouplist(pw->pw_name, pw->pw_gid, nullptr, &count);
+    QVector<gid_t> groups(count);
+    if (getgrouplist(pw->pw_name, pw->pw_gid, groups.data(), &count) < 0)
+        return false;
+
+    return groups.contains(allowedGroup);
+}
+
+void HostService::onConnection()
+{
+    const int sock = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (sock < 0)
+        return;
+
+    ucred cred {};
+    socklen_t len = sizeof(cred);
+    if (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+        qWarning() << "can not get the peer credentials" << strerror(errno);
+        close(sock);
+        return;
+    }
+
+    if (!isAllowed(cred.uid)) {
+        qWarning() << "refuse uid" << cred.uid << "pid" << cred.pid;
+        close(sock);
+        return;
+    }
+
+    int sessions = 0;
+    for (const Peer *peer : peers.values()) {
+        if (peer->uid == cred.uid)
+            ++sessions;
+    }
+    if (sessions >= kMaxPeersPerUser) {
+        qWarning() << "uid" << cred.uid << "has too many connections";
+        close(sock);
+        return;
+    }
+
+    Peer *peer = new Peer;
+    peer->sock = sock;
+    peer->uid = cred.uid;
+    peer->pid = cred.pid;
+    peer->notifier = new QSocketNotifier(sock, QSocketNotifier::Read, this);
+    connect(peer->notifier, &QSocketNotifier::activated, this, [this, peer]() {
+        onMessage(peer);
+    });
+    peers.insert(peer);
+    qInfo() << "session connected, uid" << peer->uid << "pid" << peer->pid;
+}
+
+void HostService::onMessage(Peer *peer)
+{
+    QByteArray msg;
+    int fd = -1;
+    while (SharedFrame::receiveMessage(peer->sock, &msg, &fd)) {
+        if (msg.isEmpty()) {
+            if (fd >= 0)
+                close(fd);
+            return;
+        }
+
+        QJsonParseError error;
+        const QJsonDocument doc = QJsonDocument::fromJson(msg, &error);
+        if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+            qWarning() << "invalid message from pid" << peer->pid << error.errorString();
+            if (fd >= 0)
+                close(fd);
+            continue;
+        }
+
+        // takes the descriptor.
+        handle(peer, doc.object(), fd);
+    }
+
+    qInfo() << "session disconnected, uid" << peer->uid << "pid" << peer->pid;
+    removePeer(peer);
+}
+
+void HostService::handle(Peer *peer, const QJsonObject &msg, int fd)
+{
+    const QString cmd = msg.value("cmd").toString();
+    if (cmd == "load") {
+        if (fd < 0) {
+            send(peer, QJsonObject { { "event", "error" }, { "reason", "the file is to be passed along" } });
+            return;
+        }
+        if (peer->file >= 0)
+            close(peer->file);
+        peer->file = fd;
+        peer->start = msg.value("start").toDouble();
+        subscribe(peer);
+        return;
+    }
+
+    if (fd >= 0)
+        close(fd);
+
+    if (cmd == "size") {
+        const QSize size(msg.value("width").toInt(), msg.value("height").toInt());
+        if (size.isEmpty() || size.width() > kMaxFrameWidth || size.height() > kMaxFrameHeight) {
+            qWarning() << "refuse frame size" << size << "of uid" << peer->uid;
+            send(peer, QJsonObject { { "event", "error" }, { "reason", "the frame size is out of range" } });
+            return;
+        }
+        peer->size = size;
+        peer->cover = msg.value("cover").toBool();
+        subscribe(peer);
+    } else if (cmd == "stop") {
+        unsubscribe(peer);
+        if (peer->file >= 0)
+            close(peer->file);
+        peer->file = -1;
+    } else if (cmd == "pause") {
+        peer->paused = msg.value("value").toBool();
+        updatePaused(peer->stream);
+    } else if (cmd == "set") {
+        // the stream is shared, no session tunes it for the others.
+    } else {
+        qWarning() << "unknown command" << cmd;
+    }
+}
+
+void HostService::subscribe(Peer *peer)
+{
+    if (peer->file < 0 || peer->size.isEmpty())
+        return;
+
+    struct stat st;
+    if (fstat(peer->file, &st) < 0 || !S_ISREG(st.st_mode)) {
+        send(peer, QJsonObject { { "event", "error" }, { "reason", "not a regular file" } });
+        return;
+    }
+
+    // the same clip is the same inode in the same state, whatever path the session sees it by.
+    const QString key = QString("%0:%1:%2:%3.%4:%5x%6:%7")
+                                .arg(st.st_dev).arg(st.st_ino).arg(st.st_size)
+                                .arg(st.st_mtim.tv_sec).arg(st.st_mtim.tv_nsec)
+                                .arg(peer->size.width()).arg(peer->size.height())
+                                .arg(peer->cover ? 1 : 0);
+    if (peer->stream == key)
+        return;
+
+    unsubscribe(peer);
+
+    auto itor = streams.find(key);
+    if (itor == streams.end()) {
+        if (streams.size() >= kMaxStreams) {
+            qWarning() << "too many streams, refuse uid" << peer->uid;
+            send(peer, QJsonObject { { "event", "error" }, { "reason", "the host decoder is busy" } });
+            return;
+        }
+
+        // one user cycling sizes must not take the streams of the others.
+        int owned = 0;
+        for (const Stream &stream : streams.values()) {
+            if (stream.owner == peer->uid)
+                ++owned;
+        }
+        if (owned >= kMaxStreamsPerUser) {
+            qWarning() << "uid" << peer->uid << "has too many streams";
+            send(peer, QJsonObject { { "event", "error" }, { "reason", "too many streams" } });
+            return;
+        }
+
+        // the session keeps its own descriptor to resubscribe by.
+        const int file = fcntl(peer->file, F_DUPFD_CLOEXEC, 0);
+        HostStream *decoder = new HostStream(this);
+        if (file < 0 || !decoder->init(file, peer->size, peer->cover, peer->start)) {
+            delete decoder;
+            send(peer, QJsonObject { { "event", "error" }, { "reason", "can not decode" } });
+            return;
+        }
+
+        connect(decoder, &HostStream::frameReady, this, [this, key]() {
+            auto stream = streams.constFind(key);
+            if (stream == streams.constEnd())
+                return;
+            for (Peer *p : stream->peers)
+                send(p, QJsonObject { { "event", "frame" } });
+        });
+        connect(decoder, &HostStream::error, this, [this, key](const QString &reason) {
+            auto stream = streams.constFind(key);
+            if (stream == streams.constEnd())
+                return;
+            for (Peer *p : stream->peers)
+                send(p, QJsonObject { { "event", "error" }, { "reason", reason } });
+        });
+
+        itor = streams.insert(key, Stream { decoder, {}, peer->uid });
+        qInfo() << "new stream" << key << ", streams:" << streams.size();
+    }
+
+    itor->peers.insert(peer);
+    peer->stream = key;
+    send(peer, QJsonObject { { "event", "buffer" }, { "width", peer->size.width() }, { "height", peer->size.height() } },
+         itor->decoder->bufferFd());
+    updatePaused(key);
+}
+
+void HostService::unsubscribe(Peer *peer)
+{
+    const QString key = peer->stream;
+    peer->stream.clear();
+
+    auto itor = streams.find(key);
+    if (itor == streams.end())
+        return;
+
+    itor->peers.remove(peer);
+    updatePaused(key);
+    if (!itor->peers.isEmpty())
+        return;
+
+    QTimer::singleShot(kLinger, this, [this, key]() {
+        auto unused = streams.find(key);
+        if (unused == streams.end() || !unused->peers.isEmpty())
+            return;
+
+        delete unused->decoder;
+        streams.erase(unused);
+        qInfo() << "drop stream" << key << ", streams:" << streams.size();
+    });
+}
+
+void HostService::updatePaused(const QString &key)
+{
+    auto itor = streams.find(key);
+    if (itor == streams.end())
+        return;
+
+    // plays as long as one session shows it.
+    bool paused = true;
+    for (const Peer *peer : itor->peers) {
+        if (!peer->paused)
+            paused = false;
+    }
+    itor->decoder->setPaused(paused);
+}
+
+void HostService::removePeer(Peer *peer)
+{
+    unsubscribe(peer);
+    peers.remove(peer);
+    // it might be emitting right now.
+    peer->notifier->setEnabled(false);
+    peer->notifier->deleteLater();
+    if (peer->file >= 0)
+        close(peer->file);
+    close(peer->sock);
+    delete peer;
+}
+
+void HostService::reportPosition()
+{
+    for (const Stream &stream : streams.values()) {
+        const qreal pos = stream.decoder->position();
+        if (pos < 0)
+            continue;
+
+        for (Peer *peer : stream.peers)
+            send(peer, QJsonObject { { "event", "position" }, { "value", pos } });
+    }
+}
+
+void HostService::send(Peer *peer, const QJsonObject &msg, int fd)
+{
+    // a session that does not keep up misses frames, it never blocks the others.
+    SharedFrame::sendMessage(peer->sock, QJsonDocument(msg).toJson(QJsonDocument::Compact), fd);
+}
@@ -0,0 +1,86 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef HOSTSERVICE_H
+#define HOSTSERVICE_H
+
+#include <QObject>
+#include <QHash>
+#include <QJsonObject>
+#include <QSet>
+#include <QSize>
+#include <QTimer>
+
+#include <sys/types.h>
+
+class QSocketNotifier;
+class HostStream;
+
+/**
+ * The per-host decoder shared by all desktop sessions, see sharedframe.h.
+ *
+ * Sessions connect to kHostSocket, or the socket passed by systemd, and are
+ * told apart by their peer credentials. Each distinct clip is decoded once per
+ * frame size, the stream lives as long as a session uses it and pauses when
+ * all of them do. Frame sizes, streams and connections are limited per user,
+ * as any local user may connect unless a group is set.
+ */
+class HostService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HostService(QObject *parent = nullptr);
+    ~HostService() override;
+
+    // only members of the group may connect if set, root always may
+    void setAllowedGroup(gid_t gid);
+    bool listen(const QString &path);
+
+private slots:
+    void onConnection();
+    void reportPosition();
+
+private:
+    struct Peer
+    {
+        int sock = -1;
+        QSocketNotifier *notifier = nullptr;
+        uid_t uid = 0;
+        pid_t pid = 0;
+        int file = -1; // as passed by the session
+        qreal start = 0;
+        QSize size;
+        bool cover = false;
+        bool paused = false;
+        QString stream;
+    };
+
+    struct Stream
+    {
+        HostStream *decoder = nullptr;
+        QSet<Peer *> peers;
+        uid_t owner = 0; // who made it, counted against until it is dropped
+    };
+
+    bool isAllowed(uid_t uid) const;
+    void onMessage(Peer *peer);
+    void handle(Peer *peer, const QJsonObject &msg, int fd);
+    void subscribe(Peer *peer);
+    void unsubscribe(Peer *peer);
+    void updatePaused(const QString &key);
+    void removePeer(Peer *peer);
+    void send(Peer *peer, const QJsonObject &msg, int fd = -1);
+
+private:
+    int listener = -1;
+    QSocketNotifier *notifier = nullptr;
+    bool restricted = false;
+    gid_t allowedGroup = 0;
+    QSet<Peer *> peers;
+    QHash<QString, Stream> streams; // by clip and frame size
+    QTimer positionTimer;
+};
+
+#endif // HOSTSERVICE_H
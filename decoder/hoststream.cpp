@@ -0,0 +1,257 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "hoststream.h"
+#include "sharedframe.h"
+#include "third_party/common/qthelper.hpp"
+
+#include <QDebug>
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace ddplugin_videowallpaper;
+
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010 // linux 5.1, the headers may be older than the kernel
+#endif
+
+static constexpr int kSeals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL | F_SEAL_FUTURE_WRITE;
+
+// the sessions may only map the buffer read only, nothing is served otherwise.
+static bool seal(int fd)
+{
+    if (fcntl(fd, F_ADD_SEALS, kSeals) < 0) {
+        qCritical() << "can not seal the frame buffer read only" << strerror(errno);
+        return false;
+    }
+
+    const int seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0 || (seals & kSeals) != kSeals) {
+        qCritical() << "the frame buffer is not sealed read only, seals" << seals;
+        return false;
+    }
+
+    return true;
+}
+
+HostStream::HostStream(QObject *parent)
+    : QObject(parent)
+{
+}
+
+HostStream::~HostStream()
+{
+    if (renderContext)
+        mpv_render_context_free(renderContext);
+    if (mpv)
+        mpv_terminate_destroy(mpv);
+    if (map)
+        munmap(map, mapSize);
+    if (memfd >= 0)
+        close(memfd);
+}
+
+bool HostStream::init(int file, const QSize &size, bool cover, qreal start)
+{
+    if (!allocate(size)) {
+        close(file);
+        return false;
+    }
+
+    mpv = mpv_create();
+    if (!mpv) {
+        qCritical() << "could not create mpv context";
+        close(file);
+        return false;
+    }
+
+    mpv_set_option_string(mpv, "vo", "libmpv");
+    if (mpv_initialize(mpv) < 0) {
+        qCritical() << "could not initialize mpv context";
+        close(file);
+        return false;
+    }
+
+    mpv::qt::set_option_variant(mpv, "hwdec", "auto-copy");
+    // sessions share the picture, never the sound.
+    mpv::qt::set_option_variant(mpv, "aid", "no");
+    mpv::qt::set_option_variant(mpv, "loop", "inf");
+    mpv::qt::set_option_variant(mpv, "hr-seek", "no");
+    mpv::qt::set_property_variant(mpv, "panscan", cover ? 1.0 : 0.0);
+
+    mpv_render_param params[] {
+        {MPV_RENDER_PARAM_API_TYPE, const_cast<char *>(MPV_RENDER_API_TYPE_SW)},
+        {MPV_RENDER_PARAM_INVALID, nullptr}};
+    if (mpv_render_context_create(&renderContext, mpv, params) < 0) {
+        qCritical() << "failed to initialize mpv software render context";
+        renderContext = nullptr;
+        close(file);
+        return false;
+    }
+
+    mpv_render_context_set_update_callback(renderContext, HostStream::onUpdate, this);
+    mpv_set_wakeup_callback(mpv, HostStream::wakeup, this);
+
+    // the file was opened by the session, mpv closes it when done.
+    mpv::qt::set_property_variant(mpv, "start", start > 0 ? QString::number(start, 'f', 3) : QString("none"));
+    mpv::qt::command_variant(mpv, QVariantList { "loadfile", QString("fdclose://%0").arg(file) });
+    return true;
+}
+
+bool HostStream::canSeal()
+{
+    int fd = memfd_create("videowallpaper-seal-probe", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        qCritical() << "memfd_create failed" << strerror(errno);
+        return false;
+    }
+
+    const bool ok = ftruncate(fd, 4096) == 0 && seal(fd);
+    close(fd);
+    return ok;
+}
+
+int HostStream::bufferFd() const
+{
+    return memfd;
+}
+
+QSize HostStream::size() const
+{
+    return frameSize;
+}
+
+void HostStream::setPaused(bool pause)
+{
+    if (mpv)
+        mpv::qt::set_property_variant(mpv, "pause", pause);
+}
+
+qreal HostStream::position() const
+{
+    const QVariant pos = mpv ? mpv::qt::get_property_variant(mpv, "time-pos") : QVariant();
+    return pos.isValid() ? pos.toDouble() : -1;
+}
+
+bool HostStream::allocate(const QSize &s)
+{
+    if (s.isEmpty() || s.width() > 16384 || s.height() > 16384) {
+        qWarning() << "invalid frame size" << s;
+        return false;
+    }
+
+    const uint32_t stride = static_cast<uint32_t>(s.width()) * 4;
+    const size_t len = SharedFrame::hostBufferSize(stride, static_cast<uint32_t>(s.height()));
+
+    int fd = memfd_create("videowallpaper-host-frames", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        qCritical() << "memfd_create failed" << strerror(errno);
+        return false;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(len)) < 0) {
+        qCritical() << "ftruncate failed" << strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    void *mem = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) {
+        qCritical() << "mmap failed" << strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    // only this mapping stays writable, the sessions can not map it so.
+    if (!seal(fd)) {
+        munmap(mem, len);
+        close(fd);
+        return false;
+    }
+
+    // the file is zero filled, so are the atomics.
+    auto header = static_cast<SharedFrame::HostHeader *>(mem);
+    header->magic = SharedFrame::kMagic;
+    header->version = SharedFrame::kHostVersion;
+    header->width = static_cast<uint32_t>(s.width());
+    header->height = static_cast<uint32_t>(s.height());
+    header->stride = stride;
+    header->slots = SharedFrame::kHostSlots;
+    header->latest.store(SharedFrame::kNoSlot);
+
+    memfd = fd;
+    map = mem;
+    mapSize = len;
+    frameSize = s;
+    return true;
+}
+
+void HostStream::render()
+{
+    if (!renderContext)
+        return;
+
+    if (!(mpv_render_context_update(renderContext) & MPV_RENDER_UPDATE_FRAME))
+        return;
+
+    auto header = static_cast<SharedFrame::HostHeader *>(map);
+    const uint32_t latest = header->latest.load(std::memory_order_relaxed);
+    const uint32_t slot = latest < SharedFrame::kHostSlots ? (latest + 1) % SharedFrame::kHostSlots : 0;
+
+    // odd while written, readers drop what they copied meanwhile.
+    std::atomic<uint64_t> &seq = header->slotSequence[slot];
+    seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    int swSize[2] = { frameSize.width(), frameSize.height() };
+    const uint32_t rowBytes = static_cast<uint32_t>(frameSize.width()) * 4;
+    size_t stride = rowBytes;
+    uchar *data = SharedFrame::slotData(map, rowBytes, static_cast<uint32_t>(frameSize.height()), slot);
+    mpv_render_param params[] {
+        {MPV_RENDER_PARAM_SW_SIZE, swSize},
+        {MPV_RENDER_PARAM_SW_FORMAT, const_cast<char *>("rgb0")},
+        {MPV_RENDER_PARAM_SW_STRIDE, &stride},
+        {MPV_RENDER_PARAM_SW_POINTER, data},
+        {MPV_RENDER_PARAM_INVALID, nullptr}};
+
+    const bool ok = mpv_render_context_render(renderContext, params) >= 0;
+    seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    if (!ok)
+        return;
+
+    header->latest.store(slot, std::memory_order_release);
+    header->sequence.fetch_add(1, std::memory_order_release);
+    emit frameReady();
+}
+
+void HostStream::onMpvEvents()
+{
+    while (mpv) {
+        mpv_event *event = mpv_wait_event(mpv, 0);
+        if (event->event_id == MPV_EVENT_NONE)
+            break;
+
+        if (event->event_id == MPV_EVENT_END_FILE) {
+            auto end = static_cast<mpv_event_end_file *>(event->data);
+            if (end && end->reason == MPV_END_FILE_REASON_ERROR)
+                emit error(QString(mpv_error_string(end->error)));
+        }
+    }
+}
+
+void HostStream::onUpdate(void *ctx)
+{
+    QMetaObject::invokeMethod(reinterpret_cast<HostStream *>(ctx),
+                              &HostStream::render,
+                              Qt::QueuedConnection);
+}
+
+void HostStream::wakeup(void *ctx)
+{
+    QMetaObject::invokeMethod(reinterpret_cast<HostStream *>(ctx),
+                              &HostStream::onMpvEvents,
+                              Qt::QueuedConnection);
+}
@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef HOSTSTREAM_H
+#define HOSTSTREAM_H
+
+#include <QObject>
+#include <QSize>
+
+#include <mpv/client.h>
+#include <mpv/render.h>
+
+/**
+ * One clip decoded at one size for all sessions of the host, into a sealed
+ * buffer with a HostHeader, see sharedframe.h.
+ */
+class HostStream : public QObject
+{
+    Q_OBJECT
+
+public:
+    // the kernel can seal buffers against writable mappings
+    static bool canSeal();
+
+    explicit HostStream(QObject *parent = nullptr);
+    ~HostStream() override;
+
+    // takes the file descriptor, start in seconds
+    bool init(int file, const QSize &size, bool cover, qreal start);
+    // read only for the sessions
+    int bufferFd() const;
+    QSize size() const;
+    void setPaused(bool pause);
+    // in seconds, negative if unknown
+    qreal position() const;
+
+signals:
+    void frameReady();
+    void error(const QString &reason);
+
+private slots:
+    void onMpvEvents();
+    void render();
+
+private:
+    bool allocate(const QSize &size);
+
+    static void onUpdate(void *ctx);
+    static void wakeup(void *ctx);
+
+private:
+    mpv_handle *mpv = nullptr;
+    mpv_render_context *renderContext = nullptr;
+    int memfd = -1;
+    void *map = nullptr;
+    size_t mapSize = 0;
+    QSize frameSize;
+};
+
+#endif // HOSTSTREAM_H
@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "decoderservice.h"
+#include "hostservice.h"
+#include "sharedframe.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include <clocale>
+#include <csignal>
+
+#include <grp.h>
+#include <sys/prctl.h>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("dde-videowallpaper-decoder");
+
+    // for libmpv
+    setlocale(LC_NUMERIC, "C");
+
+    QCommandLineParser parser;
+    QCommandLineOption fdOption("fd", "The socket connected to the desktop.", "fd");
+    QCommandLineOption hostOption("host", "Serve all desktop sessions of the host.");
+    QCommandLineOption socketOption("socket", "The socket to listen on in host mode.", "path",
+                                    ddplugin_videowallpaper::SharedFrame::kHostSocket);
+    QCommandLineOption groupOption("allow-group", "Only serve members of the group in host mode.", "group");
+    parser.addOption(fdOption);
+    parser.addOption(hostOption);
+    parser.addOption(socketOption);
+    parser.addOption(groupOption);
+    parser.addHelpOption();
+    parser.process(app);
+
+    if (parser.isSet(hostOption)) {
+        HostService host;
+        if (parser.isSet(groupOption)) {
+            group *gr = getgrnam(parser.value(groupOption).toLocal8Bit().constData());
+            if (!gr) {
+                qCritical() << "no such group" << parser.value(groupOption);
+                return 1;
+            }
+            host.setAllowedGroup(gr->gr_gid);
+        }
+
+        if (!host.listen(parser.value(socketOption)))
+            return 1;
+
+        return app.exec();
+    }
+
+    // never outlive the desktop
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+    bool ok = false;
+    int fd = parser.value(fdOption).toInt(&ok);
+    if (!ok || fd < 0) {
+        qCritical() << "no socket is given.";
+        return 1;
+    }
+
+    DecoderService service(fd);
+    if (!service.init())
+        return 1;
+
+    return app.exec();
+}
@@ -0,0 +1,290 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "animatedimagesource.h"
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr qint64 kDefaultBudget = 64 * 1024 * 1024;
+static constexpr int kDefaultDelay = 100; // ms, what browsers use for a zero delay
+static constexpr int kMinDelay = 10;
+static constexpr int kAhead = 2; // frames decoded before they are due
+
+AnimatedImageSource::AnimatedImageSource(QObject *parent)
+    : QObject(parent)
+    , budget(kDefaultBudget)
+{
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    connect(&timer, &QTimer::timeout, this, &AnimatedImageSource::nextFrame);
+
+    // frames are decoded in order.
+    pool.setMaxThreadCount(1);
+}
+
+AnimatedImageSource::~AnimatedImageSource()
+{
+    pool.clear();
+    pool.waitForDone();
+}
+
+bool AnimatedImageSource::isAnimatedImage(const QString &file)
+{
+    QImageReader reader(file);
+    if (!reader.canRead() || !reader.supportsAnimation())
+        return false;
+
+    // 0 means unknown, let it be tried.
+    return reader.imageCount() != 1;
+}
+
+bool AnimatedImageSource::load(const QString &f)
+{
+    stop();
+    file = f;
+    if (file.isEmpty())
+        return false;
+
+    fmInfo() << "play animated image" << file;
+    // shown as soon as the first frame is decoded.
+    waiting = true;
+    request();
+    return true;
+}
+
+QString AnimatedImageSource::fileName() const
+{
+    return file;
+}
+
+void AnimatedImageSource::stop()
+{
+    timer.stop();
+    restart();
+    waiting = false;
+    reader.reset();
+}
+
+void AnimatedImageSource::setPaused(bool pause)
+{
+    if (paused == pause)
+        return;
+
+    paused = pause;
+    if (paused)
+        timer.stop();
+    else if (!file.isEmpty())
+        nextFrame();
+}
+
+bool AnimatedImageSource::isPlaying() const
+{
+    return !paused && (timer.isActive() || waiting || !frames.isEmpty());
+}
+
+void AnimatedImageSource::setTarget(const QSize &span, qreal ratio)
+{
+    if (spanSize == span && qFuzzyCompare(pixelRatio, ratio))
+        return;
+
+    spanSize = span;
+    pixelRatio = ratio;
+
+    // decoded frames are scaled for the old target.
+    if (reader || complete) {
+        restart();
+        request();
+    }
+}
+
+void AnimatedImageSource::setPixelFormat(QImage::Format format)
+{
+    if (pixelFormat == format)
+        return;
+
+    pixelFormat = format;
+    // decoded frames are in the old format.
+    if (reader || complete) {
+        restart();
+        request();
+    }
+}
+
+void AnimatedImageSource::setBudget(qint64 bytes)
+{
+    const bool grown = bytes > budget;
+    budget = bytes;
+    if (cachedBytes > budget) {
+        fmInfo() << "animated image cache over budget, decode on the fly.";
+        const bool wasComplete = complete;
+        dropCache();
+        streaming = true;
+        // the reader is gone once the loop is cached, play on from its start.
+        if (wasComplete) {
+            current = 0;
+            request();
+        }
+    } else if (grown && streaming && reader) {
+        // it might fit now, cache it from the start of the loop.
+        restart();
+        request();
+    }
+}
+
+qint64 AnimatedImageSource::defaultBudget()
+{
+    return kDefaultBudget;
+}
+
+qint64 AnimatedImageSource::cacheSize() const
+{
+    return cachedBytes;
+}
+
+void AnimatedImageSource::nextFrame()
+{
+    if (paused)
+        return;
+
+    Frame frame;
+    if (!ahead.isEmpty()) {
+        frame = ahead.dequeue();
+    } else if (complete && !frames.isEmpty()) {
+        frame = frames.at(current);
+        current = (current + 1) % frames.size();
+    } else {
+        // the decoder fell behind, present it once it is there.
+        waiting = true;
+        request();
+        return;
+    }
+
+    waiting = false;
+    request();
+
+    // keep the pace of the animation, only skip presenting.
+    if (minInterval <= 0 || !lastEmit.isValid() || lastEmit.elapsed() >= minInterval) {
+        lastEmit.start();
+        emit frameReady(frame.image);
+    }
+    timer.start(frame.delay);
+}
+
+void AnimatedImageSource::setMaxFps(int fps)
+{
+    minInterval = fps > 0 ? 1000 / fps : 0;
+}
+
+void AnimatedImageSource::request()
+{
+    if (decoding || complete || file.isEmpty() || ahead.size() >= kAhead)
+        return;
+
+    if (!reader)
+        reader = std::make_shared<QImageReader>(file);
+
+    decoding = true;
+    const int gen = generation;
+    const std::shared_ptr<QImageReader> r = reader;
+    const QSize span = spanSize;
+    const qreal ratio = pixelRatio;
+    const QImage::Format format = pixelFormat;
+    pool.start([this, gen, r, span, ratio, format]() {
+        const Decoded result = decode(r.get(), span, ratio, format);
+        QMetaObject::invokeMethod(this, [this, gen, result]() {
+            onDecoded(gen, result);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void AnimatedImageSource::onDecoded(int gen, const Decoded &result)
+{
+    if (gen != generation)
+        return;
+
+    decoding = false;
+    if (result.end) {
+        if (decoded == 0) {
+            fmWarning() << "can not read animated image" << file;
+            waiting = false;
+            reader.reset();
+            return;
+        }
+
+        if (!streaming && frames.size() == decoded) {
+            complete = true;
+            fmDebug() << "animated image cached" << frames.size() << "frames" << cachedBytes << "bytes";
+        }
+
+        // nothing left to decode, or the loop starts over.
+        reader.reset();
+        decoded = 0;
+    } else {
+        ++decoded;
+        if (!streaming) {
+            cachedBytes += result.frame.image.sizeInBytes();
+            if (cachedBytes > budget) {
+                fmInfo() << "animated image is larger than" << budget << "bytes, decode on the fly.";
+                dropCache();
+                streaming = true;
+            } else {
+                frames.append(result.frame);
+            }
+        }
+        ahead.enqueue(result.frame);
+    }
+
+    if (waiting)
+        nextFrame();
+    else
+        request();
+}
+
+AnimatedImageSource::Decoded AnimatedImageSource::decode(QImageReader *reader, const QSize &span,
+                                                         qreal ratio, QImage::Format format)
+{
+    Decoded ret;
+    QImage img = reader->canRead() ? reader->read() : QImage();
+    if (img.isNull()) {
+        ret.end = true;
+        return ret;
+    }
+
+    int delay = reader->nextImageDelay();
+    ret.frame.delay = delay > 0 ? qMax(delay, kMinDelay) : kDefaultDelay;
+
+    // scale once here, screens sharing the ratio can take it as it is.
+    if (span.isValid()) {
+        img = img.scaled(span, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+    } else {
+        const QSize target = img.size().scaled(img.size().boundedTo(QSize(1920, 1280)) * ratio,
+                                               Qt::KeepAspectRatio);
+        if (target != img.size())
+            img = img.scaled(target, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    ret.frame.image = img.convertToFormat(format);
+    ret.frame.image.setDevicePixelRatio(ratio);
+    return ret;
+}
+
+void AnimatedImageSource::restart()
+{
+    // a task in flight still holds the old reader, its result is dropped.
+    ++generation;
+    decoding = false;
+    decoded = 0;
+    ahead.clear();
+    reader.reset();
+    dropCache();
+    current = 0;
+}
+
+void AnimatedImageSource::dropCache()
+{
+    frames.clear();
+    frames.squeeze();
+    cachedBytes = 0;
+    complete = false;
+    streaming = false;
+}
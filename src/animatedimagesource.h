@@ -0,0 +1,108 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef ANIMATEDIMAGESOURCE_H
+#define ANIMATEDIMAGESOURCE_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QObject>
+#include <QImage>
+#include <QElapsedTimer>
+#include <QImageReader>
+#include <QQueue>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <memory>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Plays GIF/WebP/APNG loops without the video pipeline.
+ *
+ * Frames are decoded once, scaled for the screens and kept in a frame cache
+ * shared by all screens. If the whole loop does not fit the memory budget,
+ * the cache is dropped and frames are decoded on the fly.
+ *
+ * Decoding and scaling run a few frames ahead in a thread of their own, the
+ * gui thread only presents them.
+ */
+class AnimatedImageSource : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AnimatedImageSource(QObject *parent = nullptr);
+    ~AnimatedImageSource() override;
+
+    static bool isAnimatedImage(const QString &file);
+
+    bool load(const QString &file);
+    QString fileName() const;
+    void stop();
+    void setPaused(bool pause);
+    bool isPlaying() const;
+
+    // size of frames covering the desktop in span mode, otherwise invalid
+    void setTarget(const QSize &span, qreal ratio);
+    void setBudget(qint64 bytes);
+    static qint64 defaultBudget();
+    void setPixelFormat(QImage::Format format);
+    // frames coming faster are skipped, 0 for no limit
+    void setMaxFps(int fps);
+    qint64 cacheSize() const;
+
+signals:
+    void frameReady(const QImage &frame);
+
+private slots:
+    void nextFrame();
+
+private:
+    struct Frame
+    {
+        QImage image;
+        int delay = 0;
+    };
+    struct Decoded
+    {
+        Frame frame;
+        bool end = false; // of the loop, no frame
+    };
+
+    void request();
+    void onDecoded(int gen, const Decoded &result);
+    static Decoded decode(QImageReader *reader, const QSize &span, qreal ratio, QImage::Format format);
+    void restart();
+    void dropCache();
+
+private:
+    QString file;
+    // read by the pool only, replaced to start the loop over
+    std::shared_ptr<QImageReader> reader;
+    QThreadPool pool;
+    int generation = 0; // results of older ones are dropped
+    bool decoding = false;
+    int decoded = 0; // frames of this pass of the loop
+    QQueue<Frame> ahead;
+    bool waiting = false; // the timer is due, but no frame is ready yet
+    QTimer timer;
+    QVector<Frame> frames;
+    int current = 0; // next one of the cache
+    qint64 cachedBytes = 0;
+    qint64 budget;
+    bool complete = false; // all frames are in cache
+    bool streaming = false; // over budget, decode every time
+    bool paused = false;
+    QSize spanSize;
+    qreal pixelRatio = 1.0;
+    QImage::Format pixelFormat = QImage::Format_RGB32;
+    int minInterval = 0; // ms
+    QElapsedTimer lastEmit;
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // ANIMATEDIMAGESOURCE_H
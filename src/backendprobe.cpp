@@ -0,0 +1,118 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "backendprobe.h"
+#include "playbackbackend.h"
+#include "tracer.h"
+
+#include <QDir>
+#include <QHash>
+#include <QSet>
+#include <QFileInfo>
+#include <QMediaFormat>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+
+using namespace ddplugin_videowallpaper;
+
+static BackendProbe::Capabilities probe()
+{
+    VW_TRACE_SCOPE("BackendProbe::probe");
+    BackendProbe::Capabilities caps;
+
+    QOpenGLContext context;
+    QOffscreenSurface surface;
+    surface.create();
+    if (context.create() && context.makeCurrent(&surface)) {
+        caps.glRenderer = QString::fromLatin1(reinterpret_cast<const char *>(
+                context.functions()->glGetString(GL_RENDERER)));
+        context.doneCurrent();
+    }
+
+    static const QStringList kSoftware { "llvmpipe", "softpipe", "swrast", "Software Rasterizer" };
+    caps.softwareGL = caps.glRenderer.isEmpty();
+    for (const QString &sw : kSoftware) {
+        if (caps.glRenderer.contains(sw, Qt::CaseInsensitive))
+            caps.softwareGL = true;
+    }
+
+    // a render node is only a hint, whether its driver decodes the codec is not asked.
+    caps.hwdec = !QDir("/dev/dri").entryList({ "renderD*" }, QDir::System).isEmpty();
+
+    fmInfo() << "GL renderer:" << caps.glRenderer << "software:" << caps.softwareGL
+             << "hwdec:" << caps.hwdec;
+    return caps;
+}
+
+const BackendProbe::Capabilities &BackendProbe::capabilities()
+{
+    static const Capabilities caps = probe();
+    return caps;
+}
+
+static QSet<QUrl> &unsupportedFiles()
+{
+    static QSet<QUrl> files;
+    return files;
+}
+
+bool BackendProbe::multimediaSupports(const QUrl &source)
+{
+    if (!source.isLocalFile() || unsupportedFiles().contains(source))
+        return false;
+
+    // the container is all that can be told without opening the file,
+    // the codec is checked once loaded.
+    static const QHash<QString, QMediaFormat::FileFormat> kFormats {
+        { "mp4", QMediaFormat::MPEG4 },
+        { "m4v", QMediaFormat::MPEG4 },
+        { "mov", QMediaFormat::QuickTime },
+        { "mkv", QMediaFormat::Matroska },
+        { "webm", QMediaFormat::WebM },
+        { "avi", QMediaFormat::AVI },
+        { "wmv", QMediaFormat::WMV },
+        { "ogv", QMediaFormat::Ogg },
+        { "ogg", QMediaFormat::Ogg },
+    };
+
+    const QString suffix = QFileInfo(source.toLocalFile()).suffix().toLower();
+    if (!kFormats.contains(suffix))
+        return false;
+
+    return QMediaFormat(kFormats.value(suffix)).isSupported(QMediaFormat::Decode);
+}
+
+bool BackendProbe::multimediaDecodes(QMediaFormat::VideoCodec codec)
+{
+    static const QList<QMediaFormat::VideoCodec> kCodecs = QMediaFormat().supportedVideoCodecs(QMediaFormat::Decode);
+    return kCodecs.contains(codec);
+}
+
+void BackendProbe::markUnsupported(const QUrl &source)
+{
+    unsupportedFiles().insert(source);
+}
+
+QString BackendProbe::choose(const QString &preferred, const QUrl &source, int screens)
+{
+    if (preferred == BackendName::kMpv || preferred == BackendName::kMultimedia)
+        return preferred;
+
+    const Capabilities &caps = capabilities();
+    QString ret = BackendName::kMpv;
+    if (!multimediaSupports(source)) {
+        // mpv plays anything, streams included.
+    } else if (caps.softwareGL) {
+        // rendering by mpv through llvmpipe costs more than decoding once
+        // and sharing the frames.
+        ret = BackendName::kMultimedia;
+    } else if (!caps.hwdec && screens > 1) {
+        // every screen would decode in software.
+        ret = BackendName::kMultimedia;
+    }
+
+    fmInfo() << "choose backend" << ret << "for" << source << "on" << screens << "screens";
+    return ret;
+}
@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef BACKENDPROBE_H
+#define BACKENDPROBE_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QMediaFormat>
+#include <QString>
+#include <QUrl>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Picks the cheapest playback backend for this machine and file.
+ *
+ * Before a file is opened only its container is known. The codec is checked
+ * by the multimedia backend once loaded, a file whose codec Qt can not decode
+ * is remembered and played by mpv from then on.
+ */
+class BackendProbe
+{
+public:
+    struct Capabilities
+    {
+        QString glRenderer;
+        bool softwareGL = false; // llvmpipe and the like
+        bool hwdec = false; // a render node to decode on
+    };
+
+    // probed once, must be called in the gui thread
+    static const Capabilities &capabilities();
+    static bool multimediaSupports(const QUrl &source);
+    static bool multimediaDecodes(QMediaFormat::VideoCodec codec);
+    // the file is played by mpv from now on
+    static void markUnsupported(const QUrl &source);
+    static QString choose(const QString &preferred, const QUrl &source, int screens);
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // BACKENDPROBE_H
@@ -0,0 +1,535 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "decoderclient.h"
+#include "wallpaperconfig.h"
+#include "tracer.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSocketNotifier>
+#include <QStandardPaths>
+#include <QTimer>
+
+#include <climits>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr int kChildFd = 3;
+static constexpr int kRestartDelay = 500; // ms
+static constexpr int kCrashWindow = 60 * 1000; // ms
+static constexpr int kMaxCrashes = 3; // in the window, then give up
+static constexpr int kStopTimeout = 1000; // ms
+
+static QString decoderPath()
+{
+#ifdef VIDEOWALLPAPER_DECODER_PATH
+    return QStringLiteral(VIDEOWALLPAPER_DECODER_PATH);
+#else
+    return QString();
+#endif
+}
+
+bool DecoderClient::isAvailable()
+{
+    const QString path = decoderPath();
+    return !path.isEmpty() && QFileInfo(path).isExecutable();
+}
+
+bool DecoderClient::isHostAvailable()
+{
+    return QFileInfo::exists(SharedFrame::kHostSocket);
+}
+
+DecoderClient::DecoderClient(bool h, QObject *parent)
+    : QObject(parent), host(h)
+{
+}
+
+DecoderClient::~DecoderClient()
+{
+    shutdown();
+    release(current);
+}
+
+bool DecoderClient::start()
+{
+    if (process || sock >= 0)
+        return true;
+
+    stopping = false;
+    return launch();
+}
+
+bool DecoderClient::launch()
+{
+    VW_TRACE_SCOPE("DecoderClient::launch");
+    if (host)
+        return connectHost();
+
+    int fds[2] = { -1, -1 };
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0) {
+        fmCritical() << "socketpair failed" << strerror(errno);
+        return false;
+    }
+
+    const int child = fds[1];
+    process = new QProcess(this);
+    process->setProcessChannelMode(QProcess::ForwardedChannels);
+    process->setChildProcessModifier([child]() {
+        // only async-signal-safe calls here.
+        if (child == kChildFd)
+            fcntl(kChildFd, F_SETFD, 0);
+        else
+            dup2(child, kChildFd);
+    });
+
+    QString program = decoderPath();
+    QStringList args { "--fd", QString::number(kChildFd) };
+
+    // let systemd enforce the limits when they are set.
+    const QString memoryMax = WpCfg->decoderMemoryMax();
+    const QString cpuQuota = WpCfg->decoderCPUQuota();
+    const QString systemdRun = QStandardPaths::findExecutable("systemd-run");
+    if ((!memoryMax.isEmpty() || !cpuQuota.isEmpty()) && !systemdRun.isEmpty()) {
+        QStringList wrapped { "--user", "--scope", "--quiet" };
+        if (!memoryMax.isEmpty())
+            wrapped << "-p" << QString("MemoryMax=%0").arg(memoryMax);
+        if (!cpuQuota.isEmpty())
+            wrapped << "-p" << QString("CPUQuota=%0").arg(cpuQuota);
+        wrapped << "--" << program;
+        args = wrapped + args;
+        program = systemdRun;
+    }
+
+    connect(process, &QProcess::finished, this, &DecoderClient::onFinished);
+    process->start(program, args);
+    close(child);
+
+    if (!process->waitForStarted()) {
+        fmCritical() << "failed to start decoder" << program << process->errorString();
+        close(fds[0]);
+        process->deleteLater();
+        process = nullptr;
+        return false;
+    }
+
+    fmInfo() << "decoder started" << process->processId() << program;
+    sock = fds[0];
+    notifier = new QSocketNotifier(sock, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &DecoderClient::onMessage);
+    return true;
+}
+
+bool DecoderClient::connectHost()
+{
+    const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fmCritical() << "socket failed" << strerror(errno);
+        return false;
+    }
+
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, SharedFrame::kHostSocket, sizeof(addr.sun_path) - 1);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        fmCritical() << "can not connect to the host decoder" << SharedFrame::kHostSocket << strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    fmInfo() << "connected to the host decoder";
+    sock = fd;
+    notifier = new QSocketNotifier(sock, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &DecoderClient::onMessage);
+    return true;
+}
+
+void DecoderClient::shutdown()
+{
+    stopping = true;
+    if (notifier) {
+        delete notifier;
+        notifier = nullptr;
+    }
+
+    // the decoder quits on hang up.
+    if (sock >= 0) {
+        close(sock);
+        sock = -1;
+    }
+
+    if (process) {
+        process->disconnect(this);
+        if (!process->waitForFinished(kStopTimeout))
+            process->kill();
+        delete process;
+        process = nullptr;
+    }
+}
+
+void DecoderClient::load(const QString &f, qreal start)
+{
+    file = f;
+    position = start;
+    sendLoad();
+}
+
+void DecoderClient::sendLoad()
+{
+    if (!host) {
+        send(QJsonObject { { "cmd", "load" }, { "file", file }, { "start", position } });
+        return;
+    }
+
+    // the host decoder plays what this session can open, nothing else.
+    const int fd = open(QFile::encodeName(file).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fmWarning() << "the host decoder only plays local files," << file << strerror(errno);
+        QTimer::singleShot(0, this, &DecoderClient::failed);
+        return;
+    }
+
+    send(QJsonObject { { "cmd", "load" }, { "start", position } }, fd);
+    close(fd);
+}
+
+void DecoderClient::stop()
+{
+    file.clear();
+    position = 0;
+    send(QJsonObject { { "cmd", "stop" } });
+}
+
+void DecoderClient::setPaused(bool pause)
+{
+    paused = pause;
+    send(QJsonObject { { "cmd", "pause" }, { "value", pause } });
+}
+
+void DecoderClient::setFrameSize(const QSize &size, qreal ratio, bool c)
+{
+    if (frameSize == size && qFuzzyCompare(pixelRatio, ratio) && cover == c)
+        return;
+
+    frameSize = size;
+    pixelRatio = ratio;
+    cover = c;
+    send(QJsonObject { { "cmd", "size" }, { "width", size.width() }, { "height", size.height() }, { "cover", cover } });
+}
+
+void DecoderClient::setMpvProperty(const QString &name, const QVariant &value)
+{
+    properties.insert(name, QJsonValue::fromVariant(value));
+    send(QJsonObject { { "cmd", "set" }, { "name", name }, { "value", QJsonValue::fromVariant(value) } });
+}
+
+QString DecoderClient::fileName() const
+{
+    return file;
+}
+
+qreal DecoderClient::currentPosition() const
+{
+    return file.isEmpty() ? -1 : position;
+}
+
+int DecoderClient::restarts() const
+{
+    return restartCount;
+}
+
+void DecoderClient::send(const QJsonObject &msg, int fd)
+{
+    if (sock < 0)
+        return;
+
+    if (!SharedFrame::sendMessage(sock, QJsonDocument(msg).toJson(QJsonDocument::Compact), fd))
+        fmWarning() << "failed to send to decoder" << msg.value("cmd").toString() << strerror(errno);
+}
+
+void DecoderClient::replay()
+{
+    if (!frameSize.isEmpty())
+        send(QJsonObject { { "cmd", "size" }, { "width", frameSize.width() }, { "height", frameSize.height() }, { "cover", cover } });
+
+    for (auto itor = properties.begin(); itor != properties.end(); ++itor)
+        send(QJsonObject { { "cmd", "set" }, { "name", itor.key() }, { "value", itor.value() } });
+
+    if (paused)
+        send(QJsonObject { { "cmd", "pause" }, { "value", true } });
+
+    if (!file.isEmpty())
+        sendLoad();
+}
+
+void DecoderClient::onMessage()
+{
+    bool frame = false;
+    bool gone = true;
+    QByteArray msg;
+    int fd = -1;
+    while (SharedFrame::receiveMessage(sock, &msg, &fd)) {
+        if (msg.isEmpty()) {
+            if (fd >= 0)
+                close(fd);
+            gone = false;
+            break;
+        }
+
+        const QJsonObject obj = QJsonDocument::fromJson(msg).object();
+        const QString event = obj.value("event").toString();
+        if (event == "buffer" && fd >= 0) {
+            attachBuffer(fd);
+            fd = -1;
+        } else if (event == "frame") {
+            // only the latest one matters.
+            frame = true;
+        } else if (event == "position") {
+            position = obj.value("value").toDouble();
+        } else if (event == "error") {
+            fmWarning() << "decoder error" << obj.value("reason").toString() << file;
+        }
+
+        if (fd >= 0)
+            close(fd);
+    }
+
+    if (frame)
+        readFrame();
+
+    // the own decoder is watched by its process, the host one only by the socket.
+    if (gone && host)
+        disconnected();
+}
+
+void DecoderClient::disconnected()
+{
+    fmWarning() << "host decoder hung up";
+    if (notifier) {
+        notifier->setEnabled(false);
+        notifier->deleteLater();
+        notifier = nullptr;
+    }
+    if (sock >= 0) {
+        close(sock);
+        sock = -1;
+    }
+
+    if (!stopping)
+        scheduleRestart();
+}
+
+void DecoderClient::attachBuffer(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < SharedFrame::headerSize()) {
+        fmWarning() << "invalid frame buffer";
+        close(fd);
+        return;
+    }
+
+    const size_t len = static_cast<size_t>(st.st_size);
+    // reading is written back, so it can not be read only, unless the buffer is shared by the host.
+    void *base = mmap(nullptr, len, host ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fmWarning() << "failed to map frame buffer" << strerror(errno);
+        return;
+    }
+
+    auto header = static_cast<SharedFrame::Header *>(base);
+    // one read of each field, the checks and the mapping use the same values.
+    const uint32_t width = header->width;
+    const uint32_t height = header->height;
+    const uint32_t stride = header->stride;
+    const bool shared = header->version == SharedFrame::kHostVersion;
+    const size_t needed = shared ? SharedFrame::hostBufferSize(stride, height)
+                                 : SharedFrame::bufferSize(stride, height);
+    if (header->magic != SharedFrame::kMagic || shared != host
+            || (!shared && header->version != SharedFrame::kVersion)
+            || header->slots != (shared ? SharedFrame::kHostSlots : SharedFrame::kSlots)
+            || width == 0 || height == 0 || width > INT_MAX / 4 || height > uint32_t(INT_MAX)
+            || needed > len
+            || stride < uint64_t(width) * 4) {
+        fmWarning() << "incompatible frame buffer";
+        munmap(base, len);
+        return;
+    }
+
+    // frames of the old buffer still on the screens keep it mapped.
+    release(current);
+    current = new Mapping;
+    current->base = base;
+    current->size = len;
+    current->host = shared;
+    current->width = width;
+    current->height = height;
+    current->stride = stride;
+    currentShown = false;
+    lastSequence = 0;
+}
+
+void DecoderClient::readFrame()
+{
+    if (!current)
+        return;
+
+    auto header = static_cast<SharedFrame::Header *>(current->base);
+    const uint64_t seq = header->sequence.load();
+    if (seq == lastSequence)
+        return;
+
+    if (current->host) {
+        QImage img = copyHostFrame(current);
+        if (img.isNull())
+            return;
+
+        lastSequence = seq;
+        img.setDevicePixelRatio(pixelRatio);
+        emit frameReady(img);
+        currentShown = true;
+        return;
+    }
+
+    // claim the latest slot, the decoder skips it from now on. The store to
+    // reading has to be visible before latest is read again, as the decoder
+    // stores latest before it reads reading, both sides are seq_cst.
+    // The previous slot is given up, the screens move on to this one in
+    // frameReady before anything is painted again.
+    uint32_t slot = SharedFrame::kNoSlot;
+    do {
+        slot = header->latest.load(std::memory_order_seq_cst);
+        header->reading.store(slot, std::memory_order_seq_cst);
+    } while (slot != header->latest.load(std::memory_order_seq_cst));
+
+    if (slot >= SharedFrame::kSlots)
+        return;
+
+    QImage img = holdSlot(current, slot);
+    lastSequence = seq;
+    img.setDevicePixelRatio(pixelRatio);
+
+    if (!currentShown)
+        VW_TRACE_INSTANT("decoder frame");
+
+    emit frameReady(img);
+    currentShown = true;
+}
+
+QImage DecoderClient::holdSlot(Mapping *m, uint32_t slot)
+{
+    ++m->refs;
+    ++m->slotRefs[slot];
+    const uchar *data = SharedFrame::slotData(m->base, m->stride, m->height, slot);
+    // read only, whoever wants to draw into it gets a copy.
+    return QImage(data, static_cast<int>(m->width), static_cast<int>(m->height), m->stride,
+                  QImage::Format_RGBX8888, &DecoderClient::releaseSlot, new HeldSlot { m, slot });
+}
+
+void DecoderClient::releaseSlot(void *info)
+{
+    auto held = static_cast<HeldSlot *>(info);
+    Mapping *m = held->mapping;
+    // unless a newer frame has been claimed meanwhile, the decoder may have the slot back.
+    if (--m->slotRefs[held->slot] == 0) {
+        uint32_t slot = held->slot;
+        static_cast<SharedFrame::Header *>(m->base)->reading.compare_exchange_strong(slot, SharedFrame::kNoSlot);
+    }
+
+    delete held;
+    release(m);
+}
+
+QImage DecoderClient::copyHostFrame(Mapping *m)
+{
+    auto header = static_cast<SharedFrame::HostHeader *>(m->base);
+    const uint32_t slot = header->latest.load(std::memory_order_acquire);
+    if (slot >= SharedFrame::kHostSlots)
+        return QImage();
+
+    // the decoder may write the slot while it is copied, then the copy is dropped.
+    std::atomic<uint64_t> &seq = header->slotSequence[slot];
+    const uint64_t before = seq.load(std::memory_order_acquire);
+    if (before & 1)
+        return QImage();
+
+    // other sessions read the same slots, so they can not be claimed, only copied.
+    QImage img(static_cast<int>(m->width), static_cast<int>(m->height), QImage::Format_RGBX8888);
+    const uchar *src = SharedFrame::slotData(m->base, m->stride, m->height, slot);
+    const size_t row = size_t(m->width) * 4;
+    for (int y = 0; y < img.height(); ++y)
+        memcpy(img.scanLine(y), src + size_t(m->stride) * y, row);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq.load(std::memory_order_relaxed) != before)
+        return QImage();
+
+    return img;
+}
+
+void DecoderClient::onFinished(int exitCode, QProcess::ExitStatus status)
+{
+    fmWarning() << "decoder exited" << exitCode << status;
+    if (notifier) {
+        delete notifier;
+        notifier = nullptr;
+    }
+    if (sock >= 0) {
+        close(sock);
+        sock = -1;
+    }
+    process->deleteLater();
+    process = nullptr;
+
+    if (stopping)
+        return;
+
+    scheduleRestart();
+}
+
+void DecoderClient::scheduleRestart()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    crashes.append(now);
+    while (!crashes.isEmpty() && now - crashes.first() > kCrashWindow)
+        crashes.removeFirst();
+
+    if (crashes.size() >= kMaxCrashes) {
+        fmCritical() << "decoder keeps crashing, give up.";
+        stopping = true;
+        emit failed();
+        return;
+    }
+
+    // the last frame stays on the screens meanwhile.
+    QTimer::singleShot(kRestartDelay, this, [this]() {
+        if (stopping || process || sock >= 0)
+            return;
+
+        ++restartCount;
+        fmInfo() << "restart decoder at" << position << file;
+        if (launch())
+            replay();
+        else if (host)
+            scheduleRestart();
+    });
+}
+
+void DecoderClient::release(Mapping *m)
+{
+    if (!m || --m->refs > 0)
+        return;
+
+    munmap(m->base, m->size);
+    delete m;
+}
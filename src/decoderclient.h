@@ -0,0 +1,129 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DECODERCLIENT_H
+#define DECODERCLIENT_H
+
+#include "ddplugin_videowallpaper_global.h"
+#include "sharedframe.h"
+
+#include <QObject>
+#include <QImage>
+#include <QJsonObject>
+#include <QProcess>
+#include <QList>
+
+class QSocketNotifier;
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Drives the out-of-process decoder, frames arrive through shared memory,
+ * see sharedframe.h. The images handed out point into the slot they were
+ * decoded to, which stays claimed and mapped until the last of them is gone.
+ *
+ * A crashed decoder is restarted with the same file, position and pause
+ * state while the last frame stays on the screens. failed() is emitted when
+ * it keeps crashing.
+ *
+ * In host mode it connects to the decoder shared by all sessions of the host
+ * instead, whose read only buffer is guarded by per-slot sequences.
+ */
+class DecoderClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    static bool isAvailable();
+    // the per-host decoder is listening
+    static bool isHostAvailable();
+
+    // host to connect to the per-host decoder rather than starting an own one
+    explicit DecoderClient(bool host = false, QObject *parent = nullptr);
+    ~DecoderClient() override;
+
+    bool start();
+    // start in seconds, from a keyframe at or before it
+    void load(const QString &file, qreal start = 0);
+    void stop();
+    void setPaused(bool pause);
+    void setFrameSize(const QSize &size, qreal ratio, bool cover);
+    void setMpvProperty(const QString &name, const QVariant &value);
+
+    QString fileName() const;
+    // in seconds, negative if nothing is loaded
+    qreal currentPosition() const;
+    int restarts() const;
+
+signals:
+    void frameReady(const QImage &frame);
+    void failed();
+
+private slots:
+    void onMessage();
+    void onFinished(int exitCode, QProcess::ExitStatus status);
+
+private:
+    // shared by the client and the images of its slots
+    struct Mapping
+    {
+        void *base = nullptr;
+        size_t size = 0;
+        bool host = false;
+        // as checked on attaching, the header can be rewritten by the decoder
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t stride = 0;
+        std::atomic_int refs { 1 };
+        std::atomic_int slotRefs[SharedFrame::kSlots] {};
+    };
+
+    struct HeldSlot
+    {
+        Mapping *mapping;
+        uint32_t slot;
+    };
+
+    bool launch();
+    bool connectHost();
+    void shutdown();
+    void disconnected();
+    void scheduleRestart();
+    void send(const QJsonObject &msg, int fd = -1);
+    void sendLoad();
+    void replay();
+    void attachBuffer(int fd);
+    void readFrame();
+    QImage copyHostFrame(Mapping *m);
+    static QImage holdSlot(Mapping *m, uint32_t slot);
+    static void releaseSlot(void *info);
+    static void release(Mapping *m);
+
+private:
+    bool host = false;
+    QProcess *process = nullptr;
+    QSocketNotifier *notifier = nullptr;
+    int sock = -1;
+    bool stopping = false;
+
+    Mapping *current = nullptr;
+    bool currentShown = false;
+    uint64_t lastSequence = 0;
+
+    // replayed to a restarted decoder
+    QString file;
+    qreal position = 0;
+    bool paused = false;
+    QSize frameSize;
+    qreal pixelRatio = 1.0;
+    bool cover = false;
+    QJsonObject properties;
+
+    QList<qint64> crashes; // ms since epoch
+    int restartCount = 0;
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // DECODERCLIENT_H
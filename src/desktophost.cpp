@@ -0,0 +1,82 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "desktophost.h"
+#include "wallpaperengine.h"
+
+#include <desktoputils/ddpugin_eventinterface_helper.h>
+
+#include <DNotifySender>
+
+#include <QStandardPaths>
+
+#include <memory>
+
+using namespace ddplugin_videowallpaper;
+
+#define CanvasCoreSubscribe(topic, func) \
+    dpfSignalDispatcher->subscribe("ddplugin_core", QT_STRINGIFY2(topic), engine, func);
+
+#define CanvasCoreUnsubscribe(topic, func) \
+    dpfSignalDispatcher->unsubscribe("ddplugin_core", QT_STRINGIFY2(topic), engine, func);
+
+static std::unique_ptr<DesktopHost> &host()
+{
+    static std::unique_ptr<DesktopHost> ins(new DesktopHost);
+    return ins;
+}
+
+DesktopHost::~DesktopHost()
+{
+}
+
+DesktopHost *DesktopHost::instance()
+{
+    return host().get();
+}
+
+void DesktopHost::setInstance(DesktopHost *h)
+{
+    host().reset(h ? h : new DesktopHost);
+}
+
+QList<QWidget *> DesktopHost::rootWindows() const
+{
+    return ddplugin_desktop_util::desktopFrameRootWindows();
+}
+
+void DesktopHost::subscribe(WallpaperEngine *engine)
+{
+    CanvasCoreUnsubscribe(signal_DesktopFrame_WindowAboutToBeBuilded, &WallpaperEngine::onDetachWindows);
+    CanvasCoreSubscribe(signal_DesktopFrame_WindowBuilded, &WallpaperEngine::build);
+    CanvasCoreSubscribe(signal_DesktopFrame_WindowShowed, &WallpaperEngine::play);
+    CanvasCoreSubscribe(signal_DesktopFrame_GeometryChanged, &WallpaperEngine::geometryChanged);
+}
+
+void DesktopHost::unsubscribe(WallpaperEngine *engine)
+{
+    CanvasCoreUnsubscribe(signal_DesktopFrame_WindowAboutToBeBuilded, &WallpaperEngine::onDetachWindows);
+    CanvasCoreUnsubscribe(signal_DesktopFrame_WindowBuilded, &WallpaperEngine::build);
+    CanvasCoreUnsubscribe(signal_DesktopFrame_WindowShowed, &WallpaperEngine::play);
+    CanvasCoreUnsubscribe(signal_DesktopFrame_GeometryChanged, &WallpaperEngine::geometryChanged);
+}
+
+void DesktopHost::layoutWidgets()
+{
+    dpfSlotChannel->push("ddplugin_core", "slot_DesktopFrame_LayoutWidget");
+}
+
+void DesktopHost::notify(const QString &appName, const QString &text)
+{
+    Dtk::Core::DUtil::DNotifySender(text)
+            .appName(appName)
+            .appIcon("deepin-toggle-desktop")
+            .timeOut(5000)
+            .call();
+}
+
+QString DesktopHost::wallpaperDirectory() const
+{
+    return QStandardPaths::standardLocations(QStandardPaths::MoviesLocation).first() + "/video-wallpaper";
+}
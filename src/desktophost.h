@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DESKTOPHOST_H
+#define DESKTOPHOST_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QList>
+#include <QString>
+
+class QWidget;
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+class WallpaperEngine;
+
+/**
+ * What the engine takes from the desktop: the root windows of the screens,
+ * the events of the desktop frame and its notifications.
+ *
+ * The default one goes through the dpf channels of ddplugin_core, the tests
+ * replace it to drive the engine without a desktop.
+ */
+class DesktopHost
+{
+public:
+    virtual ~DesktopHost();
+    static DesktopHost *instance();
+    // takes the ownership, nullptr restores the default one
+    static void setInstance(DesktopHost *host);
+
+    virtual QList<QWidget *> rootWindows() const;
+    // build, play and geometryChanged of the engine follow the desktop frame
+    virtual void subscribe(WallpaperEngine *engine);
+    virtual void unsubscribe(WallpaperEngine *engine);
+    virtual void layoutWidgets();
+    virtual void notify(const QString &appName, const QString &text);
+    // where the user puts the clips
+    virtual QString wallpaperDirectory() const;
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // DESKTOPHOST_H
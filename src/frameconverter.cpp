@@ -0,0 +1,198 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "frameconverter.h"
+#include "wallpaperconfig.h"
+
+#include <QVideoFrame>
+
+#include <vector>
+
+using namespace ddplugin_videowallpaper;
+
+namespace {
+struct Rgb
+{
+    int r;
+    int g;
+    int b;
+};
+
+// yuv to rgb of a color space and range, 8 bit fixed point
+struct Matrix
+{
+    int yOffset;
+    int y;
+    int rv;
+    int gu;
+    int gv;
+    int bu;
+};
+
+// by the luma weights of the color space
+Matrix matrixOf(double kr, double kb, bool full)
+{
+    const double kg = 1 - kr - kb;
+    const double ys = full ? 1.0 : 255.0 / 219;
+    const double cs = full ? 1.0 : 255.0 / 224;
+    const auto fixed = [](double v) { return qRound(v * 256); };
+    return { full ? 0 : 16,
+             fixed(ys),
+             fixed(2 * (1 - kr) * cs),
+             fixed(2 * kb * (1 - kb) / kg * cs),
+             fixed(2 * kr * (1 - kr) / kg * cs),
+             fixed(2 * (1 - kb) * cs) };
+}
+
+Matrix matrixOf(const QVideoFrameFormat &format)
+{
+    // limited range unless known otherwise, as decoders assume.
+    const bool full = format.colorRange() == QVideoFrameFormat::ColorRange_Full;
+    switch (format.colorSpace()) {
+    case QVideoFrameFormat::ColorSpace_BT601:
+        return matrixOf(0.299, 0.114, full);
+    case QVideoFrameFormat::ColorSpace_BT709:
+        return matrixOf(0.2126, 0.0722, full);
+    case QVideoFrameFormat::ColorSpace_BT2020:
+        return matrixOf(0.2627, 0.0593, full);
+    default:
+        // untagged streams: SD is BT.601, HD is BT.709.
+        return format.frameHeight() >= 720 ? matrixOf(0.2126, 0.0722, full) : matrixOf(0.299, 0.114, full);
+    }
+}
+
+inline Rgb yuvToRgb(const Matrix &m, int y, int u, int v)
+{
+    const int c = (y - m.yOffset) * m.y;
+    const int d = u - 128;
+    const int e = v - 128;
+    return { qBound(0, (c + m.rv * e + 128) >> 8, 255),
+             qBound(0, (c - m.gu * d - m.gv * e + 128) >> 8, 255),
+             qBound(0, (c + m.bu * d + 128) >> 8, 255) };
+}
+
+template<QImage::Format F>
+inline void store(uchar *line, int x, const Rgb &p);
+
+template<>
+inline void store<QImage::Format_RGB16>(uchar *line, int x, const Rgb &p)
+{
+    reinterpret_cast<quint16 *>(line)[x] = static_cast<quint16>(((p.r >> 3) << 11) | ((p.g >> 2) << 5) | (p.b >> 3));
+}
+
+template<>
+inline void store<QImage::Format_RGB888>(uchar *line, int x, const Rgb &p)
+{
+    uchar *px = line + x * 3;
+    px[0] = static_cast<uchar>(p.r);
+    px[1] = static_cast<uchar>(p.g);
+    px[2] = static_cast<uchar>(p.b);
+}
+
+template<>
+inline void store<QImage::Format_RGB32>(uchar *line, int x, const Rgb &p)
+{
+    reinterpret_cast<quint32 *>(line)[x] = 0xff000000u | (p.r << 16) | (p.g << 8) | p.b;
+}
+
+// samples the nearest pixel, the frames are scaled down far more often than up.
+template<QImage::Format F>
+void convertPlanes(const QVideoFrame &frame, bool interleaved, const QRect &source, QImage *out)
+{
+    const uchar *yPlane = frame.bits(0);
+    const uchar *uPlane = frame.bits(1);
+    const uchar *vPlane = interleaved ? frame.bits(1) + 1 : frame.bits(2);
+    const int yStride = frame.bytesPerLine(0);
+    const int uvStride = frame.bytesPerLine(1);
+    const int uvStep = interleaved ? 2 : 1;
+    const Matrix m = matrixOf(frame.surfaceFormat());
+
+    const int width = out->width();
+    const int height = out->height();
+    std::vector<int> xs(static_cast<size_t>(width));
+    for (int x = 0; x < width; ++x)
+        xs[static_cast<size_t>(x)] = source.x() + x * source.width() / width;
+
+    for (int y = 0; y < height; ++y) {
+        const int sy = source.y() + y * source.height() / height;
+        const uchar *yLine = yPlane + sy * yStride;
+        const uchar *uLine = uPlane + (sy / 2) * uvStride;
+        const uchar *vLine = vPlane + (sy / 2) * uvStride;
+        uchar *line = out->scanLine(y);
+        for (int x = 0; x < width; ++x) {
+            const int sx = xs[static_cast<size_t>(x)];
+            const int c = (sx / 2) * uvStep;
+            store<F>(line, x, yuvToRgb(m, yLine[sx], uLine[c], vLine[c]));
+        }
+    }
+}
+}
+
+QImage::Format FrameConverter::imageFormat(const QString &name)
+{
+    if (name == PixelFormat::kRgb16)
+        return QImage::Format_RGB16;
+    if (name == PixelFormat::kRgb888)
+        return QImage::Format_RGB888;
+    return QImage::Format_RGB32;
+}
+
+const char *FrameConverter::mpvFormat(QImage::Format format)
+{
+    switch (format) {
+    case QImage::Format_RGB16:
+        return "rgb565";
+    case QImage::Format_RGB888:
+        return "rgb24";
+    default:
+        return "rgb0";
+    }
+}
+
+int FrameConverter::depth(QImage::Format format)
+{
+    return QImage::toPixelFormat(format).bitsPerPixel();
+}
+
+QImage FrameConverter::fromVideoFrame(const QVideoFrame &frame, QImage::Format format,
+                                      const QSize &target, bool cover)
+{
+    const QVideoFrameFormat::PixelFormat pf = frame.pixelFormat();
+    const bool planar = pf == QVideoFrameFormat::Format_NV12 || pf == QVideoFrameFormat::Format_YUV420P;
+    if (!planar || target.isEmpty()) {
+        QImage img = frame.toImage();
+        if (target.isEmpty())
+            return img.convertToFormat(format);
+        return img.scaled(target, cover ? Qt::KeepAspectRatioByExpanding : Qt::KeepAspectRatio, Qt::FastTransformation)
+                .convertToFormat(format);
+    }
+
+    QVideoFrame mapped(frame);
+    if (!mapped.map(QVideoFrame::ReadOnly))
+        return QImage();
+
+    // the part of the frame with the aspect ratio of the target
+    QRect source(QPoint(0, 0), mapped.size());
+    if (cover) {
+        const QSize crop = target.scaled(source.size(), Qt::KeepAspectRatio);
+        source = QRect(QPoint((source.width() - crop.width()) / 2, (source.height() - crop.height()) / 2), crop);
+    }
+
+    QImage out(target, format);
+    const bool nv12 = pf == QVideoFrameFormat::Format_NV12;
+    switch (format) {
+    case QImage::Format_RGB16:
+        convertPlanes<QImage::Format_RGB16>(mapped, nv12, source, &out);
+        break;
+    case QImage::Format_RGB888:
+        convertPlanes<QImage::Format_RGB888>(mapped, nv12, source, &out);
+        break;
+    default:
+        convertPlanes<QImage::Format_RGB32>(mapped, nv12, source, &out);
+        break;
+    }
+
+    mapped.unmap();
+    return out;
+}
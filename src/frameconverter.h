@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef FRAMECONVERTER_H
+#define FRAMECONVERTER_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QImage>
+
+class QVideoFrame;
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Pixel formats of the frames pushed to the screens.
+ *
+ * 16 and 24 bit frames halve or save a quarter of the memory traffic of
+ * converting, scaling and uploading them, at the cost of some banding.
+ */
+class FrameConverter
+{
+public:
+    // by the "pixelFormat" config value, 32 bit if unknown
+    static QImage::Format imageFormat(const QString &name);
+    // the mpv software render format writing the same bytes
+    static const char *mpvFormat(QImage::Format format);
+    static int depth(QImage::Format format);
+
+    // converts the planes of NV12 or YUV420P frames straight into an image of the target size,
+    // cropped to it if cover, otherwise the target is to have the aspect ratio of the frame.
+    // The matrix and range are those of the frame, BT.601 or BT.709 by its height if untagged.
+    // Other frames are converted by Qt first.
+    static QImage fromVideoFrame(const QVideoFrame &frame, QImage::Format format,
+                                 const QSize &target, bool cover);
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // FRAMECONVERTER_H
@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "framelayer.h"
+#include "videoproxy.h"
+
+#include <QPainter>
+
+using namespace ddplugin_videowallpaper;
+
+FrameLayer::FrameLayer(VideoProxy *p)
+    : QOpenGLWidget(p)
+    , proxy(p)
+{
+    // nothing behind it needs to be blended.
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+int FrameLayer::paints() const
+{
+    return paintCount;
+}
+
+void FrameLayer::paintGL()
+{
+    ++paintCount;
+    QPainter painter(this);
+    proxy->paintFrame(&painter);
+}
@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef FRAMELAYER_H
+#define FRAMELAYER_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QOpenGLWidget>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+class VideoProxy;
+
+/**
+ * Presents the frames of a VideoProxy as a texture.
+ *
+ * Updates of a render-to-texture widget do not dirty the backing store of
+ * the window, so the canvas above the video is composited with the new
+ * texture instead of being repainted at the frame rate.
+ */
+class FrameLayer : public QOpenGLWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FrameLayer(VideoProxy *proxy);
+    int paints() const;
+
+protected:
+    void paintGL() override;
+
+private:
+    VideoProxy *proxy = nullptr;
+    int paintCount = 0;
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // FRAMELAYER_H
@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "lifecyclestats.h"
+
+#include <QFile>
+#include <QHash>
+
+#include <atomic>
+
+#include <unistd.h>
+
+using namespace ddplugin_videowallpaper;
+
+namespace {
+struct Latency
+{
+    qint64 count = 0;
+    qint64 total = 0; // us
+    qint64 max = 0;
+    qint64 last = 0;
+};
+
+std::atomic_int liveObjects[LifecycleStats::kKindCount] {};
+// lifecycle operations only run in the main thread.
+QHash<QString, Latency> latencies;
+qint64 baselineRss = -1;
+
+const char *kindName(LifecycleStats::Kind kind)
+{
+    switch (kind) {
+    case LifecycleStats::kVideoProxy:
+        return "videoProxies";
+    case LifecycleStats::kMpvContext:
+        return "mpvContexts";
+    case LifecycleStats::kWatcher:
+        return "watchers";
+    case LifecycleStats::kDecoderClient:
+        return "decoderClients";
+    case LifecycleStats::kImageSource:
+        return "imageSources";
+    default:
+        return "unknown";
+    }
+}
+}
+
+void LifecycleStats::track(QObject *object, Kind kind)
+{
+    ++liveObjects[kind];
+    QObject::connect(object, &QObject::destroyed, [kind]() {
+        --liveObjects[kind];
+    });
+}
+
+int LifecycleStats::live(Kind kind)
+{
+    return liveObjects[kind].load();
+}
+
+qint64 LifecycleStats::residentBytes()
+{
+    QFile file("/proc/self/statm");
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+
+    // size resident shared text lib data dt, in pages
+    const QList<QByteArray> fields = file.readLine().simplified().split(' ');
+    if (fields.size() < 2)
+        return 0;
+
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+}
+
+QVariantMap LifecycleStats::stats()
+{
+    QVariantMap live;
+    for (int i = 0; i < kKindCount; ++i)
+        live.insert(kindName(static_cast<Kind>(i)), liveObjects[i].load());
+
+    QVariantMap ops;
+    for (auto itor = latencies.cbegin(); itor != latencies.cend(); ++itor) {
+        const Latency &l = itor.value();
+        ops.insert(itor.key(), QVariantMap {
+                                       { "count", l.count },
+                                       { "avgUs", l.count > 0 ? l.total / l.count : 0 },
+                                       { "maxUs", l.max },
+                                       { "lastUs", l.last },
+                               });
+    }
+
+    const qint64 rss = residentBytes();
+    return QVariantMap {
+        { "live", live },
+        { "operations", ops },
+        { "rss", rss },
+        { "rssDrift", baselineRss < 0 ? 0 : rss - baselineRss },
+    };
+}
+
+void LifecycleStats::record(const char *operation, qint64 us)
+{
+    Latency &l = latencies[QString::fromLatin1(operation)];
+    ++l.count;
+    l.total += us;
+    l.max = qMax(l.max, us);
+    l.last = us;
+
+    // procfs is only read once here, the operations are on the hot path.
+    if (baselineRss < 0)
+        baselineRss = residentBytes();
+}
+
+LifecycleStats::Scope::Scope(const char *operation)
+    : op(operation)
+{
+    elapsed.start();
+}
+
+LifecycleStats::Scope::~Scope()
+{
+    LifecycleStats::record(op, elapsed.nsecsElapsed() / 1000);
+}
@@ -0,0 +1,63 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef LIFECYCLESTATS_H
+#define LIFECYCLESTATS_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QVariantMap>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Counters of the engine lifecycle: live objects that must not outlive a
+ * turnOff, the latency of each lifecycle operation and the drift of the
+ * resident memory since the first operation, read when the stats are.
+ */
+class LifecycleStats
+{
+public:
+    enum Kind {
+        kVideoProxy,
+        kMpvContext,
+        kWatcher,
+        kDecoderClient,
+        kImageSource,
+        kKindCount
+    };
+
+    // counted until the object is destroyed
+    static void track(QObject *object, Kind kind);
+    static int live(Kind kind);
+    static qint64 residentBytes();
+    static QVariantMap stats();
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char *operation);
+        ~Scope();
+
+    private:
+        Q_DISABLE_COPY(Scope)
+        const char *op;
+        QElapsedTimer elapsed;
+    };
+
+private:
+    static void record(const char *operation, qint64 us);
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#define VW_LIFECYCLE_CONCAT_IMPL(a, b) a##b
+#define VW_LIFECYCLE_CONCAT(a, b) VW_LIFECYCLE_CONCAT_IMPL(a, b)
+
+#define VW_LIFECYCLE_SCOPE(name) \
+    DDP_VIDEOWALLPAPER_NAMESPACE::LifecycleStats::Scope VW_LIFECYCLE_CONCAT(__vwLifecycleScope, __LINE__)(name)
+
+#endif // LIFECYCLESTATS_H
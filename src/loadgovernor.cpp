@@ -0,0 +1,199 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "loadgovernor.h"
+
+#include <QFile>
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr int kSampleInterval = 2000; // ms
+static constexpr int kStepDownSamples = 2; // busy for 4s
+static constexpr int kStepUpSamples = 5; // idle for 10s
+
+LoadGovernor::LoadGovernor(const QString &procRoot, QObject *parent)
+    : QObject(parent)
+    , root(procRoot)
+{
+    timer.setInterval(kSampleInterval);
+    connect(&timer, &QTimer::timeout, this, &LoadGovernor::sample);
+}
+
+void LoadGovernor::start()
+{
+    if (timer.isActive())
+        return;
+
+    lastBusy = lastTotal = lastSelf = -1;
+    highCount = lowCount = 0;
+    timer.start();
+    sample();
+}
+
+void LoadGovernor::stop()
+{
+    timer.stop();
+    if (current != QualityLevel::kFull) {
+        current = QualityLevel::kFull;
+        emit levelChanged(current);
+    }
+}
+
+QualityLevel LoadGovernor::level() const
+{
+    return current;
+}
+
+void LoadGovernor::setThresholds(qreal high, qreal low)
+{
+    if (low >= high) {
+        fmWarning() << "ignore load thresholds" << high << low << ", the low one is to be below the high one";
+        return;
+    }
+
+    highLoad = high;
+    lowLoad = low;
+    highCount = lowCount = 0;
+}
+
+QVariantMap LoadGovernor::stats() const
+{
+    return QVariantMap {
+        { "level", qualityName(current) },
+        { "system", last.system },
+        { "self", last.self },
+        { "pressure", last.pressure },
+        { "highLoad", highLoad },
+        { "lowLoad", lowLoad },
+        { "changes", changes },
+    };
+}
+
+void LoadGovernor::evaluate(const Sample &s)
+{
+    last = s;
+
+    // our own decoding is not a reason to yield.
+    const qreal load = qMax(qMax<qreal>(s.system - s.self, 0), s.pressure);
+    if (load > highLoad) {
+        lowCount = 0;
+        ++highCount;
+    } else if (load < lowLoad) {
+        highCount = 0;
+        ++lowCount;
+    } else {
+        highCount = lowCount = 0;
+    }
+
+    QualityLevel next = current;
+    if (highCount >= kStepDownSamples) {
+        next = lowerQuality(current);
+        highCount = 0;
+    } else if (lowCount >= kStepUpSamples) {
+        next = higherQuality(current);
+        lowCount = 0;
+    }
+
+    if (next == current)
+        return;
+
+    fmInfo() << "cpu load" << load << "(system" << s.system << "self" << s.self
+             << "pressure" << s.pressure << "), quality" << qualityName(current)
+             << "->" << qualityName(next);
+    current = next;
+    ++changes;
+    emit levelChanged(current);
+}
+
+void LoadGovernor::sample()
+{
+    qint64 busy = 0;
+    qint64 total = 0;
+    qint64 self = 0;
+    if (!readStat(&busy, &total) || !readSelf(&self))
+        return;
+
+    Sample s;
+    if (lastTotal >= 0 && total > lastTotal) {
+        const qreal delta = total - lastTotal;
+        s.system = qBound<qreal>(0, (busy - lastBusy) / delta, 1);
+        s.self = qBound<qreal>(0, (self - lastSelf) / delta, 1);
+    }
+
+    lastBusy = busy;
+    lastTotal = total;
+    lastSelf = self;
+
+    qreal avg10 = 0;
+    // not every kernel has psi.
+    if (readPressure(&avg10))
+        s.pressure = avg10;
+
+    evaluate(s);
+}
+
+bool LoadGovernor::readStat(qint64 *busy, qint64 *total) const
+{
+    QFile file(root + "/stat");
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    // cpu  user nice system idle iowait irq softirq steal guest guest_nice
+    const QList<QByteArray> fields = file.readLine().simplified().split(' ');
+    if (fields.size() < 5 || fields.first() != "cpu")
+        return false;
+
+    qint64 sum = 0;
+    qint64 idle = 0;
+    // guest time is already in user and nice.
+    for (int i = 1; i < qMin(fields.size(), 9); ++i) {
+        const qint64 v = fields.at(i).toLongLong();
+        sum += v;
+        if (i == 4 || i == 5)
+            idle += v;
+    }
+
+    *total = sum;
+    *busy = sum - idle;
+    return true;
+}
+
+bool LoadGovernor::readSelf(qint64 *ticks) const
+{
+    QFile file(root + "/self/stat");
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    // the command may contain spaces, count the fields after it.
+    const QByteArray line = file.readAll();
+    const int end = line.lastIndexOf(')');
+    if (end < 0)
+        return false;
+
+    // state is field 3, utime and stime are 14 and 15.
+    const QList<QByteArray> fields = line.mid(end + 2).simplified().split(' ');
+    if (fields.size() < 13)
+        return false;
+
+    *ticks = fields.at(11).toLongLong() + fields.at(12).toLongLong();
+    return true;
+}
+
+bool LoadGovernor::readPressure(qreal *avg10) const
+{
+    QFile file(root + "/pressure/cpu");
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    // some avg10=1.23 avg60=0.50 avg300=0.10 total=12345
+    const QList<QByteArray> fields = file.readLine().simplified().split(' ');
+    for (const QByteArray &f : fields) {
+        if (f.startsWith("avg10=")) {
+            *avg10 = f.mid(6).toDouble() / 100;
+            return true;
+        }
+    }
+
+    return false;
+}
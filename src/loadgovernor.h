@@ -0,0 +1,77 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef LOADGOVERNOR_H
+#define LOADGOVERNOR_H
+
+#include "ddplugin_videowallpaper_global.h"
+#include "qualitylevel.h"
+
+#include <QObject>
+#include <QTimer>
+#include <QVariantMap>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Steps the quality down while other processes keep the CPUs busy, and
+ * back up once the load subsides.
+ *
+ * The load is the CPU time of the system minus ours from /proc/stat and
+ * /proc/self/stat, or the "some" avg10 of /proc/pressure/cpu if higher.
+ * The procfs root can be replaced to replay recorded traces.
+ */
+class LoadGovernor : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Sample
+    {
+        qreal system = 0; // busy share of all cpus, 0 - 1
+        qreal self = 0; // our share of all cpus, 0 - 1
+        qreal pressure = 0; // cpu some avg10, 0 - 1
+    };
+
+    explicit LoadGovernor(const QString &procRoot = "/proc", QObject *parent = nullptr);
+
+    void start();
+    void stop();
+    QualityLevel level() const;
+    // load shares of all cpus to step down above and up below
+    void setThresholds(qreal high, qreal low);
+    QVariantMap stats() const;
+
+    // applies the policy to one sample, the timer feeds it from procfs
+    void evaluate(const Sample &sample);
+
+signals:
+    void levelChanged(QualityLevel level);
+
+private slots:
+    void sample();
+
+private:
+    bool readStat(qint64 *busy, qint64 *total) const;
+    bool readSelf(qint64 *ticks) const;
+    bool readPressure(qreal *avg10) const;
+
+private:
+    QString root;
+    QTimer timer;
+    QualityLevel current = QualityLevel::kFull;
+    qreal highLoad = 0.85;
+    qreal lowLoad = 0.5;
+    Sample last;
+    qint64 lastBusy = -1;
+    qint64 lastTotal = -1;
+    qint64 lastSelf = -1;
+    int highCount = 0;
+    int lowCount = 0;
+    int changes = 0;
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // LOADGOVERNOR_H
@@ -0,0 +1,158 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "memorypressuremonitor.h"
+
+#include <QFile>
+#include <QSocketNotifier>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr int kTickInterval = 2000; // ms
+// 150ms stall in 2s, unprivileged triggers need a window of whole 2s
+static constexpr char kTrigger[] = "some 150000 2000000";
+static constexpr qreal kHighPressure = 10.0; // avg10 %, for polling
+static constexpr qreal kLowPressure = 1.0; // avg10 %
+static constexpr int kQuietTicks = 5; // 10s without stall to step back
+
+MemoryPressureMonitor::MemoryPressureMonitor(const QString &procRoot, QObject *parent)
+    : QObject(parent)
+    , root(procRoot)
+{
+    timer.setInterval(kTickInterval);
+    connect(&timer, &QTimer::timeout, this, &MemoryPressureMonitor::tick);
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor()
+{
+    stop();
+}
+
+void MemoryPressureMonitor::start()
+{
+    if (timer.isActive())
+        return;
+
+    if (!registerTrigger())
+        fmInfo() << "no psi trigger on" << root << ", poll memory pressure.";
+
+    quietTicks = 0;
+    triggered = false;
+    timer.start();
+}
+
+void MemoryPressureMonitor::stop()
+{
+    timer.stop();
+    delete notifier;
+    notifier = nullptr;
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+
+    setLevel(kNone);
+}
+
+MemoryPressureMonitor::Level MemoryPressureMonitor::level() const
+{
+    return current;
+}
+
+QVariantMap MemoryPressureMonitor::stats() const
+{
+    return QVariantMap {
+        { "level", static_cast<int>(current) },
+        { "avg10", lastAvg10 },
+        { "stalls", stalls },
+        { "trigger", fd >= 0 },
+    };
+}
+
+bool MemoryPressureMonitor::registerTrigger()
+{
+    const QByteArray path = QFile::encodeName(root + "/pressure/memory");
+    fd = open(path.constData(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    // only psi files accept a trigger, a plain file would just be overwritten.
+    if (lseek(fd, 0, SEEK_END) > 0 || write(fd, kTrigger, sizeof(kTrigger)) < 0) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    notifier = new QSocketNotifier(fd, QSocketNotifier::Exception, this);
+    connect(notifier, &QSocketNotifier::activated, this, &MemoryPressureMonitor::onTriggered);
+    return true;
+}
+
+void MemoryPressureMonitor::onTriggered()
+{
+    ++stalls;
+    // act on the tick, a stall is reported every window while it lasts.
+    if (!triggered) {
+        triggered = true;
+        QMetaObject::invokeMethod(this, &MemoryPressureMonitor::tick, Qt::QueuedConnection);
+    }
+}
+
+void MemoryPressureMonitor::tick()
+{
+    qreal avg10 = 0;
+    readPressure(&avg10);
+    lastAvg10 = avg10;
+
+    const bool high = triggered || (fd < 0 && avg10 >= kHighPressure);
+    triggered = false;
+    if (high) {
+        quietTicks = 0;
+        if (current < kFrozen)
+            setLevel(static_cast<Level>(current + 1));
+        return;
+    }
+
+    // the quiet ticks must follow each other, some stall starts the period over.
+    if (avg10 >= kLowPressure || current == kNone) {
+        quietTicks = 0;
+        return;
+    }
+
+    if (++quietTicks >= kQuietTicks) {
+        quietTicks = 0;
+        setLevel(static_cast<Level>(current - 1));
+    }
+}
+
+bool MemoryPressureMonitor::readPressure(qreal *avg10) const
+{
+    QFile file(root + "/pressure/memory");
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    // some avg10=1.23 avg60=0.50 avg300=0.10 total=12345
+    const QList<QByteArray> fields = file.readLine().simplified().split(' ');
+    for (const QByteArray &f : fields) {
+        if (f.startsWith("avg10=")) {
+            *avg10 = f.mid(6).toDouble();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void MemoryPressureMonitor::setLevel(Level level)
+{
+    if (current == level)
+        return;
+
+    fmInfo() << "memory pressure level" << current << "->" << level << "avg10" << lastAvg10;
+    current = level;
+    emit levelChanged(current);
+}
@@ -0,0 +1,74 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef MEMORYPRESSUREMONITOR_H
+#define MEMORYPRESSUREMONITOR_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QObject>
+#include <QTimer>
+#include <QVariantMap>
+
+class QSocketNotifier;
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Watches /proc/pressure/memory and tells how much to shed.
+ *
+ * A PSI trigger wakes it up as soon as tasks stall on memory, the level
+ * rises one step per stall and drops one step after a quiet period.
+ * Where no trigger can be registered, e.g. a synthetic feed under an
+ * injected procfs root, avg10 is polled instead.
+ */
+class MemoryPressureMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Level {
+        kNone = 0,
+        kCaches, // drop read-ahead caches
+        kPools, // shrink frame pools
+        kShared, // one decode for all screens
+        kFrozen // pause on the last frame
+    };
+    Q_ENUM(Level)
+
+    explicit MemoryPressureMonitor(const QString &procRoot = "/proc", QObject *parent = nullptr);
+    ~MemoryPressureMonitor() override;
+
+    void start();
+    void stop();
+    Level level() const;
+    QVariantMap stats() const;
+
+signals:
+    void levelChanged(Level level);
+
+private slots:
+    void onTriggered();
+    void tick();
+
+private:
+    bool registerTrigger();
+    bool readPressure(qreal *avg10) const;
+    void setLevel(Level level);
+
+private:
+    QString root;
+    int fd = -1;
+    QSocketNotifier *notifier = nullptr;
+    QTimer timer;
+    Level current = kNone;
+    bool triggered = false;
+    int quietTicks = 0;
+    qreal lastAvg10 = 0;
+    int stalls = 0;
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // MEMORYPRESSUREMONITOR_H
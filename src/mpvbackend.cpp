@@ -0,0 +1,506 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "mpvbackend.h"
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr qint64 kSeamlessSlack = 1024 * 1024;
+
+// mpv has no value before the first frames, QDBus can not marshal an invalid variant.
+static QVariant propertyOr(const VideoProxyPointer &bwp, const char *name, const QVariant &fallback)
+{
+    const QVariant value = bwp->mpvProperty(name);
+    return value.isValid() ? value : fallback;
+}
+
+MpvBackend::MpvBackend(QObject *parent)
+    : PlaybackBackend(parent)
+    , sync(new PlaybackSync(this))
+{
+}
+
+QString MpvBackend::name() const
+{
+    return BackendName::kMpv;
+}
+
+bool MpvBackend::pushesFrames() const
+{
+    return spanSource != nullptr;
+}
+
+void MpvBackend::setWidgets(const QMap<QString, VideoProxyPointer> &widgets)
+{
+    players.clear();
+    for (auto itor = widgets.begin(); itor != widgets.end(); ++itor)
+        players.insert(itor.key(), itor.value().toWeakRef());
+
+    updateSync();
+    // the audible screen might be gone.
+    applyAudio();
+}
+
+void MpvBackend::updateSync()
+{
+    QMap<QString, VideoProxyPointer> synced;
+    for (auto itor = players.begin(); itor != players.end(); ++itor) {
+        VideoProxyPointer bwp = itor.value().toStrongRef();
+        if (bwp && !screenSources.contains(itor.key()))
+            synced.insert(itor.key(), bwp);
+    }
+    sync->setPlayers(synced);
+}
+
+void MpvBackend::setSpan(bool s)
+{
+    span = s;
+    updateSource();
+}
+
+void MpvBackend::setShared(bool s)
+{
+    shared = s;
+    updateSource();
+}
+
+void MpvBackend::updateSource()
+{
+    const bool single = span || shared;
+    if (single && !spanSource) {
+        // one decoder for all screens, each of them crops its own part.
+        sync->stop();
+        spanSource = new MpvFrameSource(this);
+        connect(spanSource, &MpvFrameSource::frameReady, this, &MpvBackend::frameReady);
+        spanSource->setPixelFormat(pixelFormat);
+        applyAudio();
+        applyFps();
+        applyCache();
+        applyHwdec();
+    } else if (!single && spanSource) {
+        delete spanSource;
+        spanSource = nullptr;
+    }
+}
+
+void MpvBackend::setFrameSize(const QSize &size, qreal ratio, bool cover)
+{
+    if (spanSource) {
+        spanSource->setFrameSize(size, ratio);
+        spanSource->setMpvProperty("panscan", cover ? 1.0 : 0.0);
+    }
+}
+
+static QString fileOf(const QUrl &url)
+{
+    return url.isLocalFile() ? url.toLocalFile() : url.toString();
+}
+
+template<typename Player>
+static void loadFile(Player *player, const QString &file, qreal start, bool primed)
+{
+    // a keyframe seek shows the first frame without decoding up to the exact position.
+    player->setMpvProperty("hr-seek", "no");
+    // the players reset it once the file is loaded, the next rounds start at the beginning.
+    player->setMpvProperty("start", start > 0 ? QString::number(start, 'f', 3) : QString("none"));
+    player->command(QVariantList { "loadfile", file });
+    if (primed)
+        player->command(QVariantList { "loadfile", file, "append" });
+}
+
+// enqueues the next round of a playing file, or drops it
+template<typename Player>
+static void primeFile(Player *player, const QString &file, bool primed)
+{
+    if (file.isEmpty() || player->mpvProperty("idle-active").toBool())
+        return;
+
+    const int count = player->mpvProperty("playlist-count").toInt();
+    if (primed && count < 2)
+        player->command(QVariantList { "loadfile", file, "append" });
+    else if (!primed && count > 1)
+        player->command(QVariantList { "playlist-clear" });
+}
+
+void MpvBackend::load(const QUrl &s, bool reload, qreal start)
+{
+    source = s;
+    const QString file = fileOf(source);
+    // the players of new screens have not got it yet.
+    applyFps();
+    applyCache();
+    applyHwdec();
+
+    // players that survived a rebuild of the root windows keep going.
+    if (spanSource) {
+        sync->stop();
+        if (reload || spanSource->mpvProperty("idle-active").toBool())
+            loadFile(spanSource, file, start, primed());
+        return;
+    }
+
+    for (auto itor = players.begin(); itor != players.end(); ++itor) {
+        VideoProxyPointer bwp = itor.value().toStrongRef();
+        if (bwp && (reload || bwp->mpvProperty("idle-active").toBool())) {
+            const QUrl own = screenSources.value(itor.key());
+            if (own.isEmpty())
+                loadFile(bwp.get(), file, start, primed());
+            else
+                loadFile(bwp.get(), fileOf(own), 0, primed());
+        }
+    }
+
+    // players are started one by one, keep them on the same frame.
+    sync->start();
+}
+
+bool MpvBackend::setScreenSource(const QString &screen, const QUrl &own, qreal start)
+{
+    if (own.isEmpty())
+        screenSources.remove(screen);
+    else
+        screenSources.insert(screen, own);
+    updateSync();
+
+    // kept for when the screens decode by themselves again.
+    if (spanSource)
+        return false;
+
+    VideoProxyPointer bwp = players.value(screen).toStrongRef();
+    const QUrl file = own.isEmpty() ? source : own;
+    if (bwp && !file.isEmpty()) {
+        // back to the common source, the sync aligns it with the master.
+        loadFile(bwp.get(), fileOf(file), own.isEmpty() ? 0 : start, primed());
+        sync->start();
+    }
+    return true;
+}
+
+void MpvBackend::stop()
+{
+    sync->stop();
+    if (spanSource)
+        spanSource->command(QVariantList { "stop" });
+
+    for (auto itor = players.begin(); itor != players.end(); ++itor) {
+        VideoProxyPointer bwp = itor.value().toStrongRef();
+        if (bwp)
+            bwp->command(QVariantList { "stop" });
+    }
+}
+
+qreal MpvBackend::position(const QString &screen) const
+{
+    QVariant pos;
+    if (spanSource) {
+        pos = spanSource->mpvProperty("time-pos");
+    } else if (VideoProxyPointer bwp = players.value(screen).toStrongRef()) {
+        pos = bwp->mpvProperty("time-pos");
+    }
+    return pos.isValid() ? pos.toDouble() : -1;
+}
+
+void MpvBackend::setPaused(bool pause)
+{
+    if (spanSource)
+        spanSource->setMpvProperty("pause", pause);
+
+    for (auto itor = players.begin(); itor != players.end(); ++itor) {
+        VideoProxyPointer bwp = itor.value().toStrongRef();
+        if (bwp)
+            bwp->setMpvProperty("pause", pause);
+    }
+}
+
+void MpvBackend::setAudible(bool a)
+{
+    audible = a;
+    applyAudio();
+}
+
+void MpvBackend::applyAudio()
+{
+    // a track that is not selected is neither demuxed nor decoded,
+    // and one screen is enough to be heard.
+    if (spanSource)
+        spanSource->setMpvProperty("aid", audible ? "auto" : "no");
+
+    const QString audioScreen = spanSource ? QString() : sync->master();
+    for (auto itor = players.begin(); itor != players.end(); ++itor) {
+        VideoProxyPointer bwp = itor.value().toStrongRef();
+        if (bwp)
+            bwp->setMpvProperty("aid", audible && itor.key() == audioScreen ? "auto" : "no");
+    }
+}
+
+void MpvBackend::setMaxFps(int fps)
+{
+    if (maxFps == fps)
+        return;
+
+    maxFps = fps;
+    applyFps();
+}
+
+QVariantMap MpvBackend::fpsProperties(int fps, qreal refreshRate)
+{
+    if (fps > 0) {
+        // pretend a display of that rate and let mpv drop what does not fit it.
+        return QVariantMap {
+            { "video-sync", "display-vdrop" },
+            { "display-fps-override", refreshRate > 0 ? qMin<qreal>(fps, refreshRate) : fps },
+            { "framedrop", "decoder+vo" },
+        };
+    }
+
+    if (refreshRate > 0) {
+        // each screen repeats frames in the cadence of its own output,
+        // the playback speed is resampled to fit it.
+        return QVariantMap {
+            { "video-sync", "display-resample" },
+            { "display-fps-override", refreshRate },
+            { "framedrop", "vo" },
+        };
+    }
+
+    return QVariantMap {
+        { "video-sync", "audio" },
+        { "display-fps-override", 0 },
+        { "framedrop", "vo" },
+    };
+}
+
+void MpvBackend::setRefreshRates(const QMap<QString, qreal> &rates)
+{
+    if (refreshRates == rates)
+        return;
+
+    fmInfo() << "refresh rates of the screens" << rates;
+    refreshRates = rates;
+    applyFps();
+}
+
+QVariantMap MpvBackend::screenStats() const
+{
+    QVariantMap ret;
+    for (auto itor = players.begin(); itor != players.end(); ++itor) {
+        VideoProxyPointer bwp = itor.value().toStrongRef();
+        if (!bwp || bwp->frameMode())
+            continue;
+
+        ret.insert(itor.key(), QVariantMap {
+                                       { "refreshRate", refreshRates.value(itor.key()) },
+                                       // relative deviation of the vsync intervals
+                                       { "vsyncJitter", propertyOr(bwp, "vsync-jitter", -1.0) },
+                                       { "mistimedFrames", propertyOr(bwp, "mistimed-frame-count", -1) },
+                                       { "droppedFrames", propertyOr(bwp, "frame-drop-count", -1) },
+                                       { "seam", bwp->seamStats() },
+                                       // s against the master, 0 for the master and screens of their own file
+                                       { "drift", sync->drift(itor.key()) },
+                               });
+    }
+
+    if (spanSource)
+        ret.insert("span", QVariantMap { { "seam", spanSource->seamStats() } });
+    if (sync->isActive()) {
+        ret.insert("sync", QVariantMap {
+                                   { "master", sync->master() },
+                                   { "maxDrift", sync->maxDrift() },
+                           });
+    }
+    return ret;
+}
+
+void MpvBackend::setPixelFormat(QImage::Format format)
+{
+    pixelFormat = format;
+    if (spanSource)
+        spanSource->setPixelFormat(format);
+}
+
+void MpvBackend::setCacheLimited(bool limited)
+{
+    if (cacheLimited == limited)
+        return;
+
+    const bool was = primed();
+    cacheLimited = limited;
+    applyCache();
+    if (was != primed())
+        applyPriming();
+}
+
+void MpvBackend::setCacheSize(qint64 maxBytes, qint64 backBytes)
+{
+    if (cacheBytes == maxBytes && cacheBackBytes == backBytes)
+        return;
+
+    cacheBytes = maxBytes;
+    cacheBackBytes = backBytes;
+    applyCache();
+}
+
+void MpvBackend::setSeamlessLoop(bool s, qint64)
+{
+    if (seamless == s)
+        return;
+
+    const bool was = primed();
+    seamless = s;
+    applyCache();
+    if (was != primed())
+        applyPriming();
+}
+
+bool MpvBackend::fitsSeamless(qint64 clipBytes)
+{
+    return clipBytes > 0 && clipBytes <= kMaxSeamlessBytes;
+}
+
+QVariantMap MpvBackend::cacheProperties(bool limited, bool seamless, qint64 maxBytes, qint64 backBytes, qint64 clipBytes)
+{
+    if (seamless && !limited && fitsSeamless(clipBytes)) {
+        // loop-file wraps by seeking back to the start, served from the cache
+        // as the whole clip stays in the back buffer, the file is never reopened.
+        // The packets are no larger than the file, the slack is for the demuxer index.
+        return QVariantMap {
+            { "cache", "yes" },
+            { "demuxer-seekable-cache", "yes" },
+            { "demuxer-max-bytes", QString::number(maxBytes) },
+            { "demuxer-max-back-bytes", QString::number(clipBytes + kSeamlessSlack) },
+            { "demuxer-readahead-secs", 1 },
+        };
+    }
+
+    if (!limited) {
+        return QVariantMap {
+            { "cache", "auto" },
+            { "demuxer-max-bytes", QString::number(maxBytes) },
+            { "demuxer-max-back-bytes", QString::number(backBytes) },
+            { "demuxer-readahead-secs", 1 },
+            { "demuxer-seekable-cache", "auto" },
+        };
+    }
+
+    // local files are read fast enough to play from hand.
+    return QVariantMap {
+        { "cache", "no" },
+        { "demuxer-max-bytes", "4MiB" },
+        { "demuxer-max-back-bytes", 0 },
+        { "demuxer-readahead-secs", 0 },
+        { "demuxer-seekable-cache", "auto" },
+    };
+}
+
+QVariantMap MpvBackend::loopProperties(bool primed)
+{
+    // the demuxer of the next round is opened once the current one is read to
+    // its end, so the wrap neither seeks nor waits for the file to be opened.
+    if (primed) {
+        return QVariantMap {
+            { "loop-file", "no" },
+            { "loop-playlist", "inf" },
+            { "prefetch-playlist", "yes" },
+        };
+    }
+
+    return QVariantMap {
+        { "loop-file", "inf" },
+        { "loop-playlist", "no" },
+        { "prefetch-playlist", "no" },
+    };
+}
+
+QString MpvBackend::hwdecProperty(const QString &mode, bool copy)
+{
+    if (!copy || mode == "no" || mode.endsWith("-copy"))
+        return mode;
+    return mode + "-copy";
+}
+
+void MpvBackend::setHwdec(const QString &mode)
+{
+    if (hwdec == mode)
+        return;
+
+    fmInfo() << "hardware decoding" << hwdec << "->" << mode;
+    hwdec = mode;
+    applyHwdec();
+}
+
+void MpvBackend::applyHwdec()
+{
+    // mpv reinitializes the decoder at the current position.
+    if (spanSource)
+        spanSource->setMpvProperty("hwdec", hwdecProperty(hwdec, true));
+
+    for (auto itor = players.begin(); itor != players.end(); ++itor) {
+        VideoProxyPointer bwp = itor.value().toStrongRef();
+        if (bwp)
+            bwp->setMpvProperty("hwdec", hwdec);
+    }
+}
+
+void MpvBackend::applyFps()
+{
+    // frames of the span source are pushed to all screens, it has no display to pace to.
+    if (spanSource) {
+        const QVariantMap props = fpsProperties(maxFps);
+        for (auto prop = props.begin(); prop != props.end(); ++prop)
+            spanSource->setMpvProperty(prop.key(), prop.value());
+    }
+
+    for (auto itor = players.begin(); itor != players.end(); ++itor) {
+        VideoProxyPointer bwp = itor.value().toStrongRef();
+        if (!bwp)
+            continue;
+
+        const QVariantMap props = fpsProperties(maxFps, refreshRates.value(itor.key()));
+        for (auto prop = props.begin(); prop != props.end(); ++prop)
+            bwp->setMpvProperty(prop.key(), prop.value());
+    }
+}
+
+void MpvBackend::applyCache()
+{
+    // a primed loop does not seek back, the whole clip need not stay cached.
+    setProperties(cacheProperties(cacheLimited, false, cacheBytes, cacheBackBytes));
+    setProperties(loopProperties(primed()));
+}
+
+bool MpvBackend::primed() const
+{
+    // the second demuxer is a cache of its own.
+    return seamless && !cacheLimited;
+}
+
+void MpvBackend::applyPriming()
+{
+    const bool p = primed();
+    if (spanSource)
+        primeFile(spanSource, fileOf(source), p);
+
+    for (auto itor = players.begin(); itor != players.end(); ++itor) {
+        VideoProxyPointer bwp = itor.value().toStrongRef();
+        if (!bwp)
+            continue;
+
+        const QUrl own = screenSources.value(itor.key());
+        primeFile(bwp.get(), fileOf(own.isEmpty() ? source : own), p);
+    }
+}
+
+void MpvBackend::setProperties(const QVariantMap &props)
+{
+    for (auto prop = props.begin(); prop != props.end(); ++prop) {
+        if (spanSource)
+            spanSource->setMpvProperty(prop.key(), prop.value());
+
+        for (auto itor = players.begin(); itor != players.end(); ++itor) {
+            VideoProxyPointer bwp = itor.value().toStrongRef();
+            if (bwp)
+                bwp->setMpvProperty(prop.key(), prop.value());
+        }
+    }
+}
@@ -0,0 +1,101 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef MPVBACKEND_H
+#define MPVBACKEND_H
+
+#include "playbackbackend.h"
+#include "playbacksync.h"
+#include "mpvframesource.h"
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * libmpv rendering by OpenGL on each screen, kept in sync by PlaybackSync,
+ * or a single software rendered decoder in span layout.
+ */
+class MpvBackend : public PlaybackBackend
+{
+    Q_OBJECT
+
+public:
+    explicit MpvBackend(QObject *parent = nullptr);
+
+    QString name() const override;
+    bool pushesFrames() const override;
+
+    void setWidgets(const QMap<QString, VideoProxyPointer> &widgets) override;
+    void setSpan(bool span) override;
+    void setShared(bool shared) override;
+    void setFrameSize(const QSize &size, qreal ratio, bool cover) override;
+
+    void load(const QUrl &source, bool reload, qreal start = 0) override;
+    bool setScreenSource(const QString &screen, const QUrl &source, qreal start = 0) override;
+    void stop() override;
+    qreal position(const QString &screen) const override;
+    void setPaused(bool pause) override;
+    void setAudible(bool audible) override;
+    void setMaxFps(int fps) override;
+    void setRefreshRates(const QMap<QString, qreal> &rates) override;
+    void setPixelFormat(QImage::Format format) override;
+    void setCacheLimited(bool limited) override;
+    void setCacheSize(qint64 maxBytes, qint64 backBytes) override;
+    void setSeamlessLoop(bool seamless, qint64 clipBytes) override;
+    void setHwdec(const QString &mode) override;
+    QVariantMap screenStats() const override;
+
+    // presents at most fps frames per second, dropping the others before decoding when possible,
+    // otherwise paces to the refresh rate of the display if known
+    static QVariantMap fpsProperties(int fps, qreal refreshRate = 0);
+    // the demuxer cache, the given sizes unless limited,
+    // seamless keeps the whole clip cached for a loop by seeking if it fits kMaxSeamlessBytes
+    static QVariantMap cacheProperties(bool limited, bool seamless = false,
+                                       qint64 maxBytes = kDefaultCacheBytes,
+                                       qint64 backBytes = kDefaultCacheBackBytes,
+                                       qint64 clipBytes = -1);
+    static bool fitsSeamless(qint64 clipBytes);
+    // a primed loop plays the clip enqueued twice, the next round is opened before
+    // the current one ends; otherwise the file loops by seeking back to its start
+    static QVariantMap loopProperties(bool primed);
+    // the mode for decoders whose frames are read back by the cpu
+    static QString hwdecProperty(const QString &mode, bool copy);
+
+    static constexpr qint64 kDefaultCacheBytes = 150 * 1024 * 1024;
+    static constexpr qint64 kDefaultCacheBackBytes = 50 * 1024 * 1024;
+    // the back buffer of a seamless loop by seeking, held by the decoder process
+    static constexpr qint64 kMaxSeamlessBytes = 64 * 1024 * 1024;
+
+private:
+    void updateSource();
+    void updateSync();
+    void applyAudio();
+    void applyFps();
+    void applyCache();
+    bool primed() const;
+    void applyPriming();
+    void applyHwdec();
+    void setProperties(const QVariantMap &props);
+
+private:
+    PlaybackSync *sync = nullptr;
+    MpvFrameSource *spanSource = nullptr;
+    QMap<QString, QWeakPointer<VideoProxy>> players;
+    QMap<QString, QUrl> screenSources; // not in sync with the others
+    QUrl source;
+    bool span = false;
+    bool shared = false;
+    bool audible = false;
+    int maxFps = 0;
+    QMap<QString, qreal> refreshRates;
+    bool cacheLimited = false;
+    bool seamless = false;
+    qint64 cacheBytes = kDefaultCacheBytes;
+    qint64 cacheBackBytes = kDefaultCacheBackBytes;
+    QString hwdec = "auto";
+    QImage::Format pixelFormat = QImage::Format_RGB32;
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // MPVBACKEND_H
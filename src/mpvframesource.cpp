@@ -0,0 +1,243 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "mpvframesource.h"
+
+#include "third_party/common/qthelper.hpp"
+#include "tracer.h"
+#include "lifecyclestats.h"
+#include "frameconverter.h"
+
+#include <cstring>
+
+using namespace ddplugin_videowallpaper;
+
+MpvFrameSource::MpvFrameSource(QObject *parent)
+    : QObject(parent)
+{
+    VW_TRACE_SCOPE("MpvFrameSource::create");
+    LifecycleStats::track(this, LifecycleStats::kMpvContext);
+    mpv = mpv_create();
+    if (!mpv) {
+        fmCritical() << "could not create mpv context";
+        return;
+    }
+
+    mpv_set_option_string(mpv, "vo", "libmpv");
+    if (mpv_initialize(mpv) < 0) {
+        fmCritical() << "could not initialize mpv context";
+        mpv_terminate_destroy(mpv);
+        mpv = nullptr;
+        return;
+    }
+
+    // frames are read back to memory anyway.
+    mpv::qt::set_option_variant(mpv, "hwdec", "auto-copy");
+    // the audio track is only selected when it is audible, see WallpaperEnginePrivate::applyAudio
+    mpv::qt::set_option_variant(mpv, "aid", "no");
+    mpv::qt::set_option_variant(mpv, "loop", "inf");
+    // cover the frame instead of letterboxing it
+    mpv::qt::set_option_variant(mpv, "panscan", 1.0);
+
+    mpv_render_param params[] {
+        {MPV_RENDER_PARAM_API_TYPE, const_cast<char *>(MPV_RENDER_API_TYPE_SW)},
+        {MPV_RENDER_PARAM_INVALID, nullptr}};
+    if (mpv_render_context_create(&renderContext, mpv, params) < 0) {
+        fmCritical() << "failed to initialize mpv software render context";
+        renderContext = nullptr;
+        return;
+    }
+
+    // going back tells where the loop wraps.
+    mpv_observe_property(mpv, 0, "time-pos", MPV_FORMAT_DOUBLE);
+
+    renderer = new QObject;
+    renderer->moveToThread(&renderThread);
+    renderThread.setObjectName("MpvFrameSource");
+    renderThread.start();
+
+    mpv_render_context_set_update_callback(renderContext, MpvFrameSource::onUpdate, this);
+    mpv_set_wakeup_callback(mpv, MpvFrameSource::wakeup, this);
+}
+
+MpvFrameSource::~MpvFrameSource()
+{
+    if (renderContext)
+        mpv_render_context_set_update_callback(renderContext, nullptr, nullptr);
+
+    // nothing renders any more once the thread is gone.
+    renderThread.quit();
+    renderThread.wait();
+    delete renderer;
+
+    if (renderContext)
+        mpv_render_context_free(renderContext);
+    if (mpv)
+        mpv_terminate_destroy(mpv);
+}
+
+void MpvFrameSource::command(const QVariant &params)
+{
+    if (mpv)
+        mpv::qt::command_variant(mpv, params);
+}
+
+void MpvFrameSource::setMpvProperty(const QString &name, const QVariant &value)
+{
+    if (mpv)
+        mpv::qt::set_property_variant(mpv, name, value);
+}
+
+QVariant MpvFrameSource::mpvProperty(const QString &name) const
+{
+    return mpv ? mpv::qt::get_property_variant(mpv, name) : QVariant();
+}
+
+void MpvFrameSource::setFrameSize(const QSize &s, qreal ratio)
+{
+    QMutexLocker lk(&mutex);
+    size = s;
+    pixelRatio = ratio;
+}
+
+QSize MpvFrameSource::frameSize() const
+{
+    QMutexLocker lk(&mutex);
+    return size;
+}
+
+void MpvFrameSource::setPixelFormat(QImage::Format format)
+{
+    QMutexLocker lk(&mutex);
+    // rgb0 is the byte order of RGBX8888, not of RGB32.
+    pixelFormat = format == QImage::Format_RGB32 ? QImage::Format_RGBX8888 : format;
+}
+
+void MpvFrameSource::render()
+{
+    if (!(mpv_render_context_update(renderContext) & MPV_RENDER_UPDATE_FRAME))
+        return;
+
+    QSize frameSize;
+    qreal ratio = 1.0;
+    QImage::Format format = QImage::Format_RGBX8888;
+    {
+        QMutexLocker lk(&mutex);
+        frameSize = size;
+        ratio = pixelRatio;
+        format = pixelFormat;
+    }
+
+    if (frameSize.isEmpty())
+        return;
+
+    // screens hold the last frame until the next one arrives, so render
+    // into the other buffer, or a new one if it is still held.
+    current = 1 - current;
+    QImage &frame = buffers[current];
+    if (frame.size() != frameSize || frame.format() != format || !frame.isDetached()) {
+        frame = QImage(frameSize, format);
+        frame.setDevicePixelRatio(ratio);
+    } else if (!qFuzzyCompare(frame.devicePixelRatio(), ratio)) {
+        frame.setDevicePixelRatio(ratio);
+    }
+
+    int swSize[2] = { frameSize.width(), frameSize.height() };
+    size_t stride = static_cast<size_t>(frame.bytesPerLine());
+    mpv_render_param params[] {
+        {MPV_RENDER_PARAM_SW_SIZE, swSize},
+        {MPV_RENDER_PARAM_SW_FORMAT, const_cast<char *>(FrameConverter::mpvFormat(format))},
+        {MPV_RENDER_PARAM_SW_STRIDE, &stride},
+        {MPV_RENDER_PARAM_SW_POINTER, frame.bits()},
+        {MPV_RENDER_PARAM_INVALID, nullptr}};
+
+    if (mpv_render_context_render(renderContext, params) < 0) {
+        if (format != QImage::Format_RGBX8888) {
+            fmWarning() << "mpv can not render" << FrameConverter::mpvFormat(format) << ", use rgb0";
+            QMutexLocker lk(&mutex);
+            pixelFormat = QImage::Format_RGBX8888;
+        }
+        return;
+    }
+
+    // a main thread that does not keep up only gets the latest frame.
+    QMutexLocker lk(&mutex);
+    latest = frame;
+    if (!pending) {
+        pending = true;
+        QMetaObject::invokeMethod(this, &MpvFrameSource::deliver, Qt::QueuedConnection);
+    }
+}
+
+void MpvFrameSource::deliver()
+{
+    QImage frame;
+    {
+        QMutexLocker lk(&mutex);
+        frame = latest;
+        latest = QImage();
+        pending = false;
+    }
+
+    if (frame.isNull())
+        return;
+
+    if (!firstFrame) {
+        firstFrame = true;
+        VW_TRACE_INSTANT("first frame rendered");
+    }
+
+    seam.frame();
+    emit frameReady(frame);
+}
+
+QVariantMap MpvFrameSource::seamStats() const
+{
+    return seam.stats();
+}
+
+void MpvFrameSource::onMpvEvents()
+{
+    while (mpv) {
+        mpv_event *event = mpv_wait_event(mpv, 0);
+        if (event->event_id == MPV_EVENT_NONE)
+            break;
+
+        if (event->event_id == MPV_EVENT_END_FILE) {
+            // played to its end, the next round of a primed loop follows.
+            ended = reinterpret_cast<mpv_event_end_file *>(event->data)->reason == MPV_END_FILE_REASON_EOF;
+        } else if (event->event_id == MPV_EVENT_START_FILE) {
+            // a new file is no loop.
+            if (!ended)
+                lastPosition = -1;
+            ended = false;
+        } else if (event->event_id == MPV_EVENT_FILE_LOADED) {
+            // where to resume is for the first round only.
+            mpv::qt::set_property_variant(mpv, "start", "none");
+        } else if (event->event_id == MPV_EVENT_PROPERTY_CHANGE) {
+            mpv_event_property *prop = reinterpret_cast<mpv_event_property *>(event->data);
+            if (prop->format == MPV_FORMAT_DOUBLE && strcmp(prop->name, "time-pos") == 0) {
+                const double pos = *reinterpret_cast<double *>(prop->data);
+                if (pos < lastPosition)
+                    seam.wrap();
+                lastPosition = pos;
+            }
+        }
+    }
+}
+
+void MpvFrameSource::onUpdate(void *ctx)
+{
+    auto self = reinterpret_cast<MpvFrameSource *>(ctx);
+    QMetaObject::invokeMethod(self->renderer, [self]() {
+        self->render();
+    }, Qt::QueuedConnection);
+}
+
+void MpvFrameSource::wakeup(void *ctx)
+{
+    QMetaObject::invokeMethod(reinterpret_cast<MpvFrameSource *>(ctx),
+                              &MpvFrameSource::onMpvEvents,
+                              Qt::QueuedConnection);
+}
@@ -0,0 +1,87 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef MPVFRAMESOURCE_H
+#define MPVFRAMESOURCE_H
+
+#include "ddplugin_videowallpaper_global.h"
+#include "seammeter.h"
+
+#include <QObject>
+#include <QImage>
+#include <QMutex>
+#include <QThread>
+
+#include <mpv/client.h>
+#include <mpv/render.h>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * A single libmpv decoder rendering into CPU memory by the software render API,
+ * the frames can be shared by several VideoProxy in frame mode.
+ *
+ * A frame can cover the whole desktop in span layout, so it is rendered by a
+ * thread of its own, only the latest one is handed to the main thread.
+ */
+class MpvFrameSource : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MpvFrameSource(QObject *parent = nullptr);
+    ~MpvFrameSource() override;
+
+    void command(const QVariant &params);
+    void setMpvProperty(const QString &name, const QVariant &value);
+    QVariant mpvProperty(const QString &name) const;
+
+    void setFrameSize(const QSize &size, qreal ratio = 1.0);
+    QSize frameSize() const;
+    // rendered straight into this format, 32 bit if mpv can not
+    void setPixelFormat(QImage::Format format);
+    // frame time at the loop point
+    QVariantMap seamStats() const;
+
+signals:
+    void frameReady(const QImage &frame);
+
+private slots:
+    void onMpvEvents();
+
+private:
+    // in the render thread
+    void render();
+    // in the main thread
+    void deliver();
+    static void onUpdate(void *ctx);
+    static void wakeup(void *ctx);
+
+private:
+    mpv_handle *mpv = nullptr;
+    mpv_render_context *renderContext = nullptr;
+    QThread renderThread;
+    QObject *renderer = nullptr; // lives in renderThread
+
+    // shared with the render thread
+    mutable QMutex mutex;
+    QSize size;
+    qreal pixelRatio = 1.0;
+    QImage::Format pixelFormat = QImage::Format_RGBX8888;
+    QImage latest;
+    bool pending = false; // latest is yet to be delivered
+
+    // the render thread only
+    QImage buffers[2];
+    int current = 0;
+
+    bool firstFrame = false;
+    SeamMeter seam;
+    double lastPosition = -1; // s
+    bool ended = false; // the last file played to its end
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // MPVFRAMESOURCE_H
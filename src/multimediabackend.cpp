@@ -0,0 +1,331 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "multimediabackend.h"
+#include "tracer.h"
+#include "frameconverter.h"
+#include "backendprobe.h"
+
+#include <QMediaDevices>
+#include <QMediaMetaData>
+#include <QAudioDevice>
+
+using namespace ddplugin_videowallpaper;
+
+MultimediaBackend::MultimediaBackend(QObject *parent)
+    : PlaybackBackend(parent)
+{
+    player = createPlayer();
+    player->setLoops(QMediaPlayer::Infinite);
+}
+
+MultimediaBackend::~MultimediaBackend()
+{
+    player->setSource(QUrl());
+    if (standby)
+        standby->setSource(QUrl());
+}
+
+QMediaPlayer *MultimediaBackend::createPlayer()
+{
+    QMediaPlayer *ret = new QMediaPlayer(this);
+    ret->setVideoSink(new QVideoSink(ret));
+    // the standby player shows its first frame while primed, not on the screens.
+    connect(ret->videoSink(), &QVideoSink::videoFrameChanged, this, [this, ret](const QVideoFrame &frame) {
+        if (ret == player)
+            catchImage(frame);
+    });
+    connect(ret, &QMediaPlayer::mediaStatusChanged, this, [this, ret](QMediaPlayer::MediaStatus status) {
+        if (ret == player && status == QMediaPlayer::LoadedMedia)
+            checkCodec();
+        if (ret == player && standby && status == QMediaPlayer::EndOfMedia)
+            wrap();
+    });
+    connect(ret, &QMediaPlayer::errorOccurred, this, [this, ret](QMediaPlayer::Error error, const QString &text) {
+        if (ret != player || error == QMediaPlayer::NoError)
+            return;
+
+        fmWarning() << "multimedia can not play" << player->source() << ":" << text;
+        BackendProbe::markUnsupported(player->source());
+        emit unsupported(player->source());
+    });
+    return ret;
+}
+
+void MultimediaBackend::checkCodec()
+{
+    const QVariant value = player->metaData().value(QMediaMetaData::VideoCodec);
+    if (!value.isValid())
+        return;
+
+    const auto codec = value.value<QMediaFormat::VideoCodec>();
+    if (BackendProbe::multimediaDecodes(codec))
+        return;
+
+    fmWarning() << "video codec" << QMediaFormat::videoCodecName(codec) << "of" << player->source()
+                << "is not decoded by multimedia";
+    BackendProbe::markUnsupported(player->source());
+    emit unsupported(player->source());
+}
+
+QString MultimediaBackend::name() const
+{
+    return BackendName::kMultimedia;
+}
+
+bool MultimediaBackend::pushesFrames() const
+{
+    return true;
+}
+
+void MultimediaBackend::setWidgets(const QMap<QString, VideoProxyPointer> &)
+{
+    // frames are pushed to the proxies by the engine.
+}
+
+void MultimediaBackend::setSpan(bool)
+{
+    // the same frame serves both layouts, see setFrameSize.
+}
+
+void MultimediaBackend::setShared(bool)
+{
+    // always shared.
+}
+
+void MultimediaBackend::setFrameSize(const QSize &size, qreal ratio, bool cover)
+{
+    // out of span layout the proxies scale the frames of the video size.
+    spanFrame = cover ? size : QSize();
+    spanRatio = ratio;
+}
+
+void MultimediaBackend::load(const QUrl &source, bool reload, qreal start)
+{
+    if (reload || player->source() != source
+        || player->playbackState() == QMediaPlayer::StoppedState) {
+        player->setSource(source);
+        if (start > 0)
+            player->setPosition(qRound64(start * 1000));
+        player->play();
+        lastPosition = -1;
+        prime();
+    }
+}
+
+qreal MultimediaBackend::position(const QString &) const
+{
+    if (player->playbackState() == QMediaPlayer::StoppedState)
+        return -1;
+    return player->position() / 1000.0;
+}
+
+bool MultimediaBackend::setScreenSource(const QString &, const QUrl &, qreal)
+{
+    // one player for all screens.
+    return false;
+}
+
+void MultimediaBackend::stop()
+{
+    player->setSource(QUrl());
+    if (standby)
+        standby->setSource(QUrl());
+}
+
+void MultimediaBackend::setPaused(bool pause)
+{
+    if (player->source().isEmpty())
+        return;
+
+    if (pause)
+        player->pause();
+    else
+        player->play();
+}
+
+void MultimediaBackend::setAudible(bool a)
+{
+    audible = a;
+    applyAudio();
+}
+
+void MultimediaBackend::applyAudio()
+{
+    // the output can only be attached to one player.
+    if (standby) {
+        standby->setAudioOutput(nullptr);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+        standby->setActiveAudioTrack(-1);
+#endif
+    }
+
+    if (audible) {
+        if (!audioOutput)
+            audioOutput = new QAudioOutput(QMediaDevices::defaultAudioOutput(), this);
+        player->setAudioOutput(audioOutput);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+        player->setActiveAudioTrack(0);
+#endif
+    } else {
+        player->setAudioOutput(nullptr);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+        player->setActiveAudioTrack(-1);
+#endif
+    }
+}
+
+void MultimediaBackend::setMaxFps(int fps)
+{
+    minInterval = fps > 0 ? 1000 / fps : 0;
+}
+
+void MultimediaBackend::setRefreshRates(const QMap<QString, qreal> &)
+{
+    // frames are painted by the screens as they arrive.
+}
+
+QVariantMap MultimediaBackend::screenStats() const
+{
+    // all screens share the frames, so does the cost of converting them.
+    return QVariantMap {
+        { "convertUs", converted > 0 ? convertTime / converted : 0 },
+        { "seam", seam.stats() },
+        { "seamless", standby != nullptr },
+    };
+}
+
+void MultimediaBackend::setPixelFormat(QImage::Format format)
+{
+    pixelFormat = format;
+}
+
+void MultimediaBackend::setCacheLimited(bool limited)
+{
+    // the buffering of QMediaPlayer is not configurable, but the standby player is a second decoder.
+    cacheLimited = limited;
+    updateStandby();
+}
+
+void MultimediaBackend::setCacheSize(qint64, qint64)
+{
+    // see setCacheLimited.
+}
+
+void MultimediaBackend::setSeamlessLoop(bool s, qint64)
+{
+    // the cost is the standby decoder, whatever the size of the clip.
+    seamless = s;
+    updateStandby();
+}
+
+void MultimediaBackend::setHwdec(const QString &)
+{
+    // the ffmpeg backend of Qt picks the hardware decoder by itself.
+}
+
+void MultimediaBackend::updateStandby()
+{
+    const bool want = seamless && !cacheLimited;
+    if (want == (standby != nullptr))
+        return;
+
+    if (want) {
+        standby = createPlayer();
+        // the players hand over at the end instead of looping by themselves.
+        player->setLoops(1);
+        standby->setLoops(1);
+        applyAudio();
+        prime();
+    } else {
+        standby->setSource(QUrl());
+        delete standby;
+        standby = nullptr;
+        player->setLoops(QMediaPlayer::Infinite);
+    }
+}
+
+void MultimediaBackend::prime()
+{
+    if (!standby)
+        return;
+
+    // opened, decoded up to the first frame and held there until the active one ends.
+    if (standby->source() != player->source())
+        standby->setSource(player->source());
+    if (standby->source().isEmpty())
+        return;
+
+    standby->setPosition(0);
+    standby->pause();
+}
+
+void MultimediaBackend::wrap()
+{
+    std::swap(player, standby);
+    player->play();
+    applyAudio();
+    // the one that just ended is the next to take over.
+    prime();
+}
+
+void MultimediaBackend::catchImage(const QVideoFrame &frame)
+{
+    // decoded frames, whether shown or not, tell the seam. Frame timestamps
+    // of a looping player may keep growing, its position goes back.
+    const qint64 pos = player->position();
+    if (pos < lastPosition)
+        seam.wrap();
+    lastPosition = pos;
+    seam.frame();
+
+    // the conversion costs more than the decoding, skip it for dropped frames.
+    if (minInterval > 0 && lastFrame.isValid() && lastFrame.elapsed() < minInterval) {
+        return;
+    }
+    lastFrame.start();
+
+    /**
+     * FIXME: QVideoFrame::toImage might cause SIGSEGV
+     * in Qt6, seems to be QVideoFrame mapped failed
+     * so try to map manually first
+     *
+     * (related to vdpau/vaapi?)
+     */
+    QVideoFrame tmp(frame);
+    bool ret = tmp.map(QVideoFrame::ReadOnly);
+    if (!ret) {
+        return;
+    }
+    // release memcpy
+    tmp.unmap();
+
+    if (!firstFrame) {
+        firstFrame = true;
+        VW_TRACE_INSTANT("first frame rendered");
+    }
+
+    // convert once, all screens share the same image.
+    QElapsedTimer elapsed;
+    elapsed.start();
+    QImage img;
+    if (pixelFormat == QImage::Format_RGB32) {
+        img = frame.toImage();
+        if (spanFrame.isValid()) {
+            img = img.scaled(spanFrame, Qt::KeepAspectRatioByExpanding, Qt::FastTransformation);
+            img.setDevicePixelRatio(spanRatio);
+        }
+    } else {
+        // straight from the yuv planes to the size the screens show, no 32 bit copy in between.
+        const QSize fill = frame.size().scaled(frame.size().boundedTo(QSize(1920, 1280)) * spanRatio,
+                                               Qt::KeepAspectRatio);
+        img = FrameConverter::fromVideoFrame(frame, pixelFormat, spanFrame.isValid() ? spanFrame : fill,
+                                             spanFrame.isValid());
+        img.setDevicePixelRatio(spanRatio);
+    }
+    convertTime += elapsed.nsecsElapsed() / 1000;
+    ++converted;
+
+    emit frameReady(img);
+}
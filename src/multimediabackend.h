@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef MULTIMEDIABACKEND_H
+#define MULTIMEDIABACKEND_H
+
+#include "playbackbackend.h"
+#include "seammeter.h"
+
+#include <QMediaPlayer>
+#include <QVideoSink>
+#include <QVideoFrame>
+#include <QAudioOutput>
+#include <QElapsedTimer>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * One Qt Multimedia player whose frames are shared by all screens.
+ *
+ * QMediaPlayer loops by seeking back and flushing its decoder, in seamless
+ * mode a second player waits primed at the first frame and takes over when
+ * the active one reaches the end.
+ */
+class MultimediaBackend : public PlaybackBackend
+{
+    Q_OBJECT
+
+public:
+    explicit MultimediaBackend(QObject *parent = nullptr);
+    ~MultimediaBackend() override;
+
+    QString name() const override;
+    bool pushesFrames() const override;
+
+    void setWidgets(const QMap<QString, VideoProxyPointer> &widgets) override;
+    void setSpan(bool span) override;
+    void setShared(bool shared) override;
+    void setFrameSize(const QSize &size, qreal ratio, bool cover) override;
+
+    void load(const QUrl &source, bool reload, qreal start = 0) override;
+    bool setScreenSource(const QString &screen, const QUrl &source, qreal start = 0) override;
+    void stop() override;
+    qreal position(const QString &screen) const override;
+    void setPaused(bool pause) override;
+    void setAudible(bool audible) override;
+    void setMaxFps(int fps) override;
+    void setRefreshRates(const QMap<QString, qreal> &rates) override;
+    void setPixelFormat(QImage::Format format) override;
+    void setCacheLimited(bool limited) override;
+    void setCacheSize(qint64 maxBytes, qint64 backBytes) override;
+    void setSeamlessLoop(bool seamless, qint64 clipBytes) override;
+    void setHwdec(const QString &mode) override;
+    QVariantMap screenStats() const override;
+
+private slots:
+    void catchImage(const QVideoFrame &frame);
+
+private:
+    QMediaPlayer *createPlayer();
+    void checkCodec();
+    void updateStandby();
+    void prime();
+    void wrap();
+    void applyAudio();
+
+private:
+    QMediaPlayer *player = nullptr;
+    QMediaPlayer *standby = nullptr; // seamless only
+    QAudioOutput *audioOutput = nullptr; // only attached when audible
+    bool audible = false;
+    bool seamless = false;
+    bool cacheLimited = false;
+    SeamMeter seam;
+    qint64 lastPosition = -1; // ms, at the latest frame
+    bool firstFrame = false;
+    QSize spanFrame;
+    qreal spanRatio = 1.0;
+    QImage::Format pixelFormat = QImage::Format_RGB32;
+    qint64 convertTime = 0; // us, of all frames
+    qint64 converted = 0;
+    int minInterval = 0; // ms
+    QElapsedTimer lastFrame;
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // MULTIMEDIABACKEND_H
@@ -0,0 +1,69 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "paintcounter.h"
+#include "videoproxy.h"
+
+#include <QEvent>
+#include <QWidget>
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr int kReportInterval = 10; // s
+
+PaintCounter::PaintCounter(std::function<bool()> playing, QObject *parent)
+    : QObject(parent)
+    , isPlaying(playing)
+{
+    timer.setInterval(1000);
+    connect(&timer, &QTimer::timeout, this, &PaintCounter::sample);
+    timer.start();
+}
+
+void PaintCounter::watch(QWidget *root)
+{
+    if (!root)
+        return;
+
+    for (QWidget *wid : root->findChildren<QWidget *>()) {
+        bool video = false;
+        for (QWidget *p = wid; p && p != root; p = p->parentWidget()) {
+            if (qobject_cast<VideoProxy *>(p)) {
+                video = true;
+                break;
+            }
+        }
+
+        // installing twice is harmless, the filter moves to the front.
+        if (!video)
+            wid->installEventFilter(this);
+    }
+}
+
+qreal PaintCounter::rate(bool playing) const
+{
+    const Total &t = totals[playing ? 1 : 0];
+    return t.seconds > 0 ? qreal(t.paints) / t.seconds : 0;
+}
+
+bool PaintCounter::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::Paint)
+        ++current;
+
+    return QObject::eventFilter(watched, event);
+}
+
+void PaintCounter::sample()
+{
+    Total &t = totals[isPlaying() ? 1 : 0];
+    t.paints += current;
+    ++t.seconds;
+    current = 0;
+
+    if ((totals[0].seconds + totals[1].seconds) % kReportInterval == 0) {
+        fmInfo() << "canvas paints per second, video playing:" << rate(true)
+                 << "stopped:" << rate(false);
+    }
+}
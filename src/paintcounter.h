@@ -0,0 +1,57 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PAINTCOUNTER_H
+#define PAINTCOUNTER_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+#include <functional>
+
+class QWidget;
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Counts the paint events of the widgets sharing the desktop windows with
+ * the video, i.e. the canvas and its icon views, and reports the rate with
+ * the video playing and not.
+ */
+class PaintCounter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PaintCounter(std::function<bool()> playing, QObject *parent = nullptr);
+
+    // every descendant of root except the video wallpaper itself
+    void watch(QWidget *root);
+    qreal rate(bool playing) const; // paints per second
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void sample();
+
+private:
+    struct Total
+    {
+        qint64 paints = 0;
+        int seconds = 0;
+    };
+
+    std::function<bool()> isPlaying;
+    QTimer timer;
+    int current = 0; // paints in this second
+    Total totals[2]; // not playing, playing
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // PAINTCOUNTER_H
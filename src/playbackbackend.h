@@ -0,0 +1,87 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PLAYBACKBACKEND_H
+#define PLAYBACKBACKEND_H
+
+#include "ddplugin_videowallpaper_global.h"
+#include "videoproxy.h"
+
+#include <QObject>
+#include <QImage>
+#include <QMap>
+#include <QUrl>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+namespace BackendName {
+inline constexpr char kAuto[] = "auto";
+inline constexpr char kMpv[] = "mpv";
+inline constexpr char kMultimedia[] = "multimedia";
+}
+
+/**
+ * Decodes the video for the screens.
+ *
+ * A backend either lets each VideoProxy decode by itself, or pushes frames
+ * shared by all of them through frameReady, see pushesFrames.
+ */
+class PlaybackBackend : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PlaybackBackend(QObject *parent = nullptr)
+        : QObject(parent) { }
+
+    virtual QString name() const = 0;
+    // the proxies are to be in frame mode
+    virtual bool pushesFrames() const = 0;
+
+    virtual void setWidgets(const QMap<QString, VideoProxyPointer> &widgets) = 0;
+    // one frame covering the whole desktop instead of one per screen
+    virtual void setSpan(bool span) = 0;
+    // one decode pushed to all screens out of span layout as well, to save memory
+    virtual void setShared(bool shared) = 0;
+    // the size of pushed frames, cropped to it when covering the desktop
+    virtual void setFrameSize(const QSize &size, qreal ratio, bool cover) = 0;
+
+    // start in seconds, from a keyframe at or before it
+    virtual void load(const QUrl &source, bool reload, qreal start = 0) = 0;
+    // another file on one screen from start in seconds, an empty one to play the
+    // common source again; false if the screens share the frames
+    virtual bool setScreenSource(const QString &screen, const QUrl &source, qreal start = 0) = 0;
+    virtual void stop() = 0;
+    // in seconds, negative if nothing is playing on the screen
+    virtual qreal position(const QString &screen) const = 0;
+    virtual void setPaused(bool pause) = 0;
+    virtual void setAudible(bool audible) = 0;
+    // frames beyond the rate are dropped, 0 for the rate of the video
+    virtual void setMaxFps(int fps) = 0;
+    // Hz of the output of each screen, to pace the frames to
+    virtual void setRefreshRates(const QMap<QString, qreal> &rates) = 0;
+    // of the pushed frames
+    virtual void setPixelFormat(QImage::Format format) = 0;
+    // keep as little read ahead as possible
+    virtual void setCacheLimited(bool limited) = 0;
+    // the demuxer cache in bytes unless limited
+    virtual void setCacheSize(qint64 maxBytes, qint64 backBytes) = 0;
+    // wrap around the loop without waiting for the file to be read again,
+    // the clip is of clipBytes, -1 if unknown
+    virtual void setSeamlessLoop(bool seamless, qint64 clipBytes) = 0;
+    // the mpv hwdec mode, copied back to memory for pushed frames
+    virtual void setHwdec(const QString &mode) = 0;
+
+    // pacing of each screen
+    virtual QVariantMap screenStats() const = 0;
+
+signals:
+    void frameReady(const QImage &frame);
+    // the codec of the loaded source turned out not to be decodable by this backend
+    void unsupported(const QUrl &source);
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // PLAYBACKBACKEND_H
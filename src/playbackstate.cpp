@@ -0,0 +1,135 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "playbackstate.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr qreal kMinMove = 1.0; // s, less is not worth a write
+
+PlaybackState::PlaybackState(const QString &p)
+    : path(p)
+{
+    // one after another, the last one wins.
+    writer.setMaxThreadCount(1);
+}
+
+QString PlaybackState::defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+            + "/dde-desktop/video-wallpaper/playback.json";
+}
+
+bool PlaybackState::read()
+{
+    // not older than what was saved last.
+    flush();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    // { "screens": { "HDMI-1": { "file": "file:///...", "position": 12.3, "own": false } } }
+    const QJsonObject screens = QJsonDocument::fromJson(file.readAll()).object().value("screens").toObject();
+    entries.clear();
+    for (auto itor = screens.begin(); itor != screens.end(); ++itor) {
+        const QJsonObject obj = itor.value().toObject();
+        Entry e;
+        e.file = QUrl(obj.value("file").toString());
+        e.position = obj.value("position").toDouble();
+        e.own = obj.value("own").toBool();
+        if (e.file.isValid())
+            entries.insert(itor.key(), e);
+    }
+
+    dirty = false;
+    return true;
+}
+
+bool PlaybackState::save()
+{
+    if (!dirty)
+        return false;
+
+    QJsonObject screens;
+    for (auto itor = entries.begin(); itor != entries.end(); ++itor) {
+        screens.insert(itor.key(), QJsonObject {
+                                           { "file", itor.value().file.toString() },
+                                           { "position", itor.value().position },
+                                           { "own", itor.value().own },
+                                   });
+    }
+
+    // the commit syncs the file to disk, which may take a while.
+    const QByteArray data = QJsonDocument(QJsonObject { { "screens", screens } }).toJson(QJsonDocument::Compact);
+    const QString target = path;
+    writer.start([target, data]() {
+        QDir().mkpath(QFileInfo(target).absolutePath());
+        // never leave a truncated file behind when the session ends meanwhile.
+        QSaveFile file(target);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) < 0 || !file.commit())
+            fmWarning() << "can not save playback state to" << target << file.errorString();
+    });
+
+    dirty = false;
+    ++writeCount;
+    return true;
+}
+
+void PlaybackState::flush()
+{
+    writer.waitForDone();
+}
+
+QStringList PlaybackState::screens() const
+{
+    return entries.keys();
+}
+
+PlaybackState::Entry PlaybackState::entry(const QString &screen) const
+{
+    return entries.value(screen);
+}
+
+qreal PlaybackState::position(const QUrl &file, const QString &screen) const
+{
+    auto itor = entries.constFind(screen);
+    if (itor != entries.constEnd() && itor.value().file == file)
+        return itor.value().position;
+
+    for (const Entry &e : entries) {
+        if (e.file == file)
+            return e.position;
+    }
+    return 0;
+}
+
+void PlaybackState::setEntry(const QString &screen, const Entry &e)
+{
+    auto itor = entries.find(screen);
+    if (itor != entries.end() && itor.value().file == e.file && itor.value().own == e.own
+        && qAbs(itor.value().position - e.position) < kMinMove)
+        return;
+
+    entries.insert(screen, e);
+    dirty = true;
+}
+
+void PlaybackState::removeEntry(const QString &screen)
+{
+    if (entries.remove(screen) > 0)
+        dirty = true;
+}
+
+int PlaybackState::writes() const
+{
+    return writeCount;
+}
@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PLAYBACKSTATE_H
+#define PLAYBACKSTATE_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QMap>
+#include <QStringList>
+#include <QThreadPool>
+#include <QUrl>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * What each screen was playing, kept in a small json file so that the
+ * next start resumes there instead of at the beginning of the clip.
+ *
+ * Entries are only written out by save(), and only if they changed by
+ * more than a moment of playback. The file is written by a thread of its
+ * own, flush() waits for it.
+ */
+class PlaybackState
+{
+public:
+    struct Entry
+    {
+        QUrl file;
+        qreal position = 0; // s
+        bool own = false; // the file was set for this screen only
+    };
+
+    explicit PlaybackState(const QString &path = defaultPath());
+    static QString defaultPath();
+
+    bool read();
+    // queues the write, false if there was nothing to write
+    bool save();
+    void flush();
+
+    QStringList screens() const;
+    Entry entry(const QString &screen) const;
+    // the position of the file on any screen, the given one preferred
+    qreal position(const QUrl &file, const QString &screen = QString()) const;
+    void setEntry(const QString &screen, const Entry &entry);
+    void removeEntry(const QString &screen);
+    int writes() const;
+
+private:
+    QString path;
+    QThreadPool writer;
+    QMap<QString, Entry> entries;
+    bool dirty = false;
+    int writeCount = 0;
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // PLAYBACKSTATE_H
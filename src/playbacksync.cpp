@@ -0,0 +1,179 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "playbacksync.h"
+
+#include <desktoputils/ddpugin_eventinterface_helper.h>
+
+#include <QtMath>
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr int kSyncInterval = 250; // ms
+static constexpr qreal kGain = 0.5; // speed offset per second of drift
+static constexpr qreal kMaxNudge = 0.05; // never play more than 5% off
+static constexpr qreal kResyncThreshold = 1.0; // s, only hit right after loadfile
+static constexpr qreal kDefaultFrameTime = 1.0 / 30;
+
+PlaybackSync::PlaybackSync(QObject *parent)
+    : QObject(parent)
+{
+    timer.setInterval(kSyncInterval);
+    connect(&timer, &QTimer::timeout, this, &PlaybackSync::synchronize);
+}
+
+void PlaybackSync::setPlayers(const QMap<QString, VideoProxyPointer> &ps)
+{
+    players.clear();
+    for (auto itor = ps.begin(); itor != ps.end(); ++itor)
+        players.insert(itor.key(), itor.value().toWeakRef());
+
+    for (const QString &sp : drifts.keys()) {
+        if (!players.contains(sp)) {
+            drifts.remove(sp);
+            speeds.remove(sp);
+        }
+    }
+
+    if (!players.contains(masterScreen))
+        masterScreen = electMaster();
+}
+
+void PlaybackSync::setMaster(const QString &screen)
+{
+    if (masterScreen == screen)
+        return;
+
+    masterScreen = screen;
+    resetSpeed();
+}
+
+QString PlaybackSync::master() const
+{
+    return masterScreen;
+}
+
+void PlaybackSync::start()
+{
+    if (players.size() < 2) {
+        stop();
+        return;
+    }
+
+    if (!timer.isActive()) {
+        fmInfo() << "start playback sync, master:" << masterScreen;
+        timer.start();
+    }
+}
+
+void PlaybackSync::stop()
+{
+    timer.stop();
+    resetSpeed();
+    drifts.clear();
+}
+
+bool PlaybackSync::isActive() const
+{
+    return timer.isActive();
+}
+
+qreal PlaybackSync::drift(const QString &screen) const
+{
+    return drifts.value(screen, 0);
+}
+
+qreal PlaybackSync::maxDrift() const
+{
+    qreal ret = 0;
+    for (qreal d : drifts.values())
+        ret = qMax(ret, qAbs(d));
+    return ret;
+}
+
+void PlaybackSync::synchronize()
+{
+    VideoProxyPointer master = players.value(masterScreen).toStrongRef();
+    if (master.isNull()) {
+        masterScreen = electMaster();
+        return;
+    }
+
+    const QVariant masterPos = master->mpvProperty("time-pos");
+    if (!masterPos.isValid())
+        return;
+
+    const qreal duration = master->mpvProperty("duration").toDouble();
+    qreal fps = master->mpvProperty("container-fps").toDouble();
+    const qreal frameTime = fps > 0 ? 1.0 / fps : kDefaultFrameTime;
+
+    for (auto itor = players.begin(); itor != players.end(); ++itor) {
+        if (itor.key() == masterScreen)
+            continue;
+
+        VideoProxyPointer follower = itor.value().toStrongRef();
+        if (follower.isNull())
+            continue;
+
+        const QVariant pos = follower->mpvProperty("time-pos");
+        if (!pos.isValid())
+            continue;
+
+        qreal diff = pos.toDouble() - masterPos.toDouble();
+        // the shortest way round the loop point
+        if (duration > 0) {
+            if (diff > duration / 2)
+                diff -= duration;
+            else if (diff < -duration / 2)
+                diff += duration;
+        }
+
+        if (!qFuzzyCompare(drifts.value(itor.key(), 0) + 1, diff + 1)) {
+            drifts.insert(itor.key(), diff);
+            emit driftChanged(itor.key(), diff);
+        }
+
+        qreal speed = 1.0;
+        if (qAbs(diff) > kResyncThreshold) {
+            // far too off to be nudged back, that only happens when the files
+            // were loaded at different times, so align once. The players seek
+            // to keyframes for resuming, this one has to be exact.
+            fmDebug() << "resync" << itor.key() << "drift" << diff;
+            follower->command(QVariantList { "seek", masterPos.toDouble(), "absolute+exact" });
+        } else if (qAbs(diff) > frameTime / 2) {
+            speed = 1.0 - qBound(-kMaxNudge, diff * kGain, kMaxNudge);
+        }
+
+        if (qAbs(speeds.value(itor.key(), 1.0) - speed) > 0.001) {
+            follower->setMpvProperty("speed", speed);
+            speeds.insert(itor.key(), speed);
+        }
+    }
+}
+
+QString PlaybackSync::electMaster() const
+{
+    if (players.isEmpty())
+        return QString();
+
+    // the primary screen is the one the user looks at most.
+    auto primary = ddplugin_desktop_util::screenProxyPrimaryScreen();
+    if (primary && players.contains(primary->name()))
+        return primary->name();
+
+    return players.firstKey();
+}
+
+void PlaybackSync::resetSpeed()
+{
+    for (auto itor = speeds.begin(); itor != speeds.end(); ++itor) {
+        if (qFuzzyCompare(itor.value(), 1.0))
+            continue;
+
+        VideoProxyPointer player = players.value(itor.key()).toStrongRef();
+        if (!player.isNull())
+            player->setMpvProperty("speed", 1.0);
+    }
+    speeds.clear();
+}
@@ -0,0 +1,63 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PLAYBACKSYNC_H
+#define PLAYBACKSYNC_H
+
+#include "ddplugin_videowallpaper_global.h"
+#include "videoproxy.h"
+
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QTimer>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Keeps the per-screen players locked to one clock master.
+ *
+ * Followers are pulled towards the master by nudging their playback speed,
+ * so that no seek (and no visible hitch) is needed once they are close.
+ */
+class PlaybackSync : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PlaybackSync(QObject *parent = nullptr);
+
+    void setPlayers(const QMap<QString, VideoProxyPointer> &players);
+    void setMaster(const QString &screen);
+    QString master() const;
+
+    void start();
+    void stop();
+    bool isActive() const;
+
+    // drift of each follower against the master in seconds
+    qreal drift(const QString &screen) const;
+    qreal maxDrift() const;
+
+signals:
+    void driftChanged(const QString &screen, qreal drift);
+
+private slots:
+    void synchronize();
+
+private:
+    QString electMaster() const;
+    void resetSpeed();
+
+private:
+    QTimer timer;
+    QString masterScreen;
+    QMap<QString, QWeakPointer<VideoProxy>> players;
+    QHash<QString, qreal> drifts;
+    QHash<QString, qreal> speeds;
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // PLAYBACKSYNC_H
@@ -0,0 +1,84 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef QUALITYLEVEL_H
+#define QUALITYLEVEL_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QString>
+#include <QtGlobal>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * The steps the policies (load, memory, thermal) degrade playback through,
+ * the worst level requested by any of them is applied.
+ */
+enum class QualityLevel {
+    kFull = 0,
+    kReduced,
+    kLow,
+    kPaused
+};
+
+struct QualityProfile
+{
+    int maxFps = 0; // 0 for the rate of the video
+    qreal renderScale = 1.0; // of the frames pushed to the screens
+    bool paused = false;
+
+    static inline QualityProfile of(QualityLevel level)
+    {
+        switch (level) {
+        case QualityLevel::kReduced:
+            return { 30, 0.75, false };
+        case QualityLevel::kLow:
+            return { 15, 0.5, false };
+        case QualityLevel::kPaused:
+            return { 0, 0.5, true };
+        default:
+            return {};
+        }
+    }
+};
+
+inline QString qualityName(QualityLevel level)
+{
+    switch (level) {
+    case QualityLevel::kReduced:
+        return "reduced";
+    case QualityLevel::kLow:
+        return "low";
+    case QualityLevel::kPaused:
+        return "paused";
+    default:
+        return "full";
+    }
+}
+
+inline bool qualityFromName(const QString &name, QualityLevel *level)
+{
+    for (QualityLevel l : { QualityLevel::kFull, QualityLevel::kReduced, QualityLevel::kLow, QualityLevel::kPaused }) {
+        if (qualityName(l) == name) {
+            *level = l;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline QualityLevel lowerQuality(QualityLevel level)
+{
+    return level == QualityLevel::kPaused ? level : static_cast<QualityLevel>(static_cast<int>(level) + 1);
+}
+
+inline QualityLevel higherQuality(QualityLevel level)
+{
+    return level == QualityLevel::kFull ? level : static_cast<QualityLevel>(static_cast<int>(level) - 1);
+}
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // QUALITYLEVEL_H
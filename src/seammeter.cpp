@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "seammeter.h"
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr qint64 kMaxInterval = 1000; // ms, longer ones were paused
+static constexpr qreal kSmoothing = 0.05;
+
+void SeamMeter::frame()
+{
+    if (!timer.isValid()) {
+        timer.start();
+        return;
+    }
+
+    const qint64 interval = timer.restart();
+    if (interval > kMaxInterval) {
+        candidate = -1;
+        last = 0;
+        return;
+    }
+
+    if (candidate >= 0) {
+        lastSeam = qMax(candidate, interval);
+        maxSeam = qMax(maxSeam, lastSeam);
+        ++seams;
+        candidate = -1;
+        fmDebug() << "loop seam" << lastSeam << "ms, frames take" << average << "ms";
+    } else {
+        average = average > 0 ? average + (interval - average) * kSmoothing : interval;
+    }
+    last = interval;
+}
+
+void SeamMeter::wrap()
+{
+    candidate = last;
+}
+
+QVariantMap SeamMeter::stats() const
+{
+    return QVariantMap {
+        { "frameMs", average },
+        { "seams", seams },
+        { "lastSeamMs", lastSeam },
+        { "maxSeamMs", maxSeam },
+        // how many frame times the latest seam took, 1 is seamless
+        { "spike", average > 0 ? lastSeam / average : 0 },
+    };
+}
@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef SEAMMETER_H
+#define SEAMMETER_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QElapsedTimer>
+#include <QVariantMap>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Measures the frame time spike where a clip loops.
+ *
+ * The wrap is seen by the position going back, which may be reported
+ * just before or just after the first frame of the new round, so the
+ * seam is the longer of the two frame intervals around it.
+ */
+class SeamMeter
+{
+public:
+    // a frame was shown
+    void frame();
+    // the position went back to the start
+    void wrap();
+    // frameMs is the average interval off the seams
+    QVariantMap stats() const;
+
+private:
+    QElapsedTimer timer;
+    qreal average = 0; // ms
+    qint64 last = 0; // ms, the latest interval
+    qint64 candidate = -1; // ms, the interval before the pending wrap
+    int seams = 0;
+    qint64 lastSeam = 0; // ms
+    qint64 maxSeam = 0; // ms
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // SEAMMETER_H
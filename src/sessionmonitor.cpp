@@ -0,0 +1,189 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "sessionmonitor.h"
+
+#include <dfm-base/utils/windowutils.h>
+
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusVariant>
+#include <QGuiApplication>
+
+#include <xcb/dpms.h>
+
+using namespace ddplugin_videowallpaper;
+DFMBASE_USE_NAMESPACE
+
+static constexpr char kScreenSaverService[] = "org.freedesktop.ScreenSaver";
+static constexpr char kScreenSaverPath[] = "/org/freedesktop/ScreenSaver";
+static constexpr char kScreenSaverInterface[] = "org.freedesktop.ScreenSaver";
+
+static constexpr char kSessionService[] = "org.deepin.dde.SessionManager1";
+static constexpr char kSessionPath[] = "/org/deepin/dde/SessionManager1";
+static constexpr char kSessionInterface[] = "org.deepin.dde.SessionManager1";
+
+static constexpr char kPropertiesInterface[] = "org.freedesktop.DBus.Properties";
+
+// DPMS before 1.2 has no event, poll it. Each tick reads the reply to the
+// request of the tick before, the gui thread never waits for the server.
+static constexpr int kDpmsInterval = 3000;
+
+SessionMonitor::SessionMonitor(const QDBusConnection &b, QObject *parent)
+    : QObject(parent)
+    , bus(b)
+{
+    dpmsTimer.setInterval(kDpmsInterval);
+    connect(&dpmsTimer, &QTimer::timeout, this, &SessionMonitor::checkDpms);
+}
+
+SessionMonitor::~SessionMonitor()
+{
+    discardDpms();
+}
+
+void SessionMonitor::start()
+{
+    if (started)
+        return;
+    started = true;
+
+    if (!bus.isConnected()) {
+        fmWarning() << "session bus is not connected, can not watch lock and screensaver.";
+    } else {
+        bus.connect(kScreenSaverService, kScreenSaverPath, kScreenSaverInterface, "ActiveChanged",
+                    this, SLOT(onScreenSaverActiveChanged(bool)));
+        bus.connect(kSessionService, kSessionPath, kPropertiesInterface, "PropertiesChanged",
+                    this, SLOT(onSessionPropertiesChanged(QString, QVariantMap, QStringList)));
+
+        // the initial state, unless stopped before the replies came
+        const unsigned int gen = generation;
+        auto msg = QDBusMessage::createMethodCall(kScreenSaverService, kScreenSaverPath,
+                                                  kScreenSaverInterface, "GetActive");
+        auto watcher = new QDBusPendingCallWatcher(bus.asyncCall(msg), this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, gen](QDBusPendingCallWatcher *call) {
+            QDBusPendingReply<bool> reply = *call;
+            if (gen == generation && !reply.isError())
+                setReason(kScreenSaver, reply.value());
+            call->deleteLater();
+        });
+
+        msg = QDBusMessage::createMethodCall(kSessionService, kSessionPath, kPropertiesInterface, "Get");
+        msg << QString(kSessionInterface) << QString("Locked");
+        watcher = new QDBusPendingCallWatcher(bus.asyncCall(msg), this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, gen](QDBusPendingCallWatcher *call) {
+            QDBusPendingReply<QDBusVariant> reply = *call;
+            if (gen == generation && !reply.isError())
+                setReason(kLocked, reply.value().variant().toBool());
+            call->deleteLater();
+        });
+    }
+
+    if (!WindowUtils::isWayLand()) {
+        dpmsTimer.start();
+        // only sends the request, the state is known by the first tick.
+        checkDpms();
+    }
+}
+
+void SessionMonitor::stop()
+{
+    if (!started)
+        return;
+    started = false;
+    ++generation;
+
+    bus.disconnect(kScreenSaverService, kScreenSaverPath, kScreenSaverInterface, "ActiveChanged",
+                   this, SLOT(onScreenSaverActiveChanged(bool)));
+    bus.disconnect(kSessionService, kSessionPath, kPropertiesInterface, "PropertiesChanged",
+                   this, SLOT(onSessionPropertiesChanged(QString, QVariantMap, QStringList)));
+    dpmsTimer.stop();
+    discardDpms();
+
+    // nothing is known any more, the owner resets its own state.
+    state = kNone;
+}
+
+SessionMonitor::Reasons SessionMonitor::reasons() const
+{
+    return state;
+}
+
+bool SessionMonitor::isSuspended() const
+{
+    return state != kNone;
+}
+
+void SessionMonitor::onScreenSaverActiveChanged(bool active)
+{
+    setReason(kScreenSaver, active);
+}
+
+void SessionMonitor::onSessionPropertiesChanged(const QString &interface, const QVariantMap &changed, const QStringList &invalidated)
+{
+    Q_UNUSED(invalidated)
+    if (interface != kSessionInterface || !changed.contains("Locked"))
+        return;
+
+    setReason(kLocked, changed.value("Locked").toBool());
+}
+
+void SessionMonitor::checkDpms()
+{
+    auto x11 = qGuiApp->nativeInterface<QNativeInterface::QX11Application>();
+    xcb_connection_t *conn = x11 ? x11->connection() : nullptr;
+    if (!conn) {
+        dpmsTimer.stop();
+        return;
+    }
+
+    const xcb_query_extension_reply_t *ext = xcb_get_extension_data(conn, &xcb_dpms_id);
+    if (!ext || !ext->present) {
+        // the server has no DPMS
+        dpmsTimer.stop();
+        return;
+    }
+
+    if (dpmsSequence) {
+        void *reply = nullptr;
+        xcb_generic_error_t *error = nullptr;
+        if (!xcb_poll_for_reply(conn, dpmsSequence, &reply, &error))
+            return; // still on its way, no new request meanwhile
+
+        dpmsSequence = 0;
+        free(error);
+        if (reply) {
+            auto info = static_cast<xcb_dpms_info_reply_t *>(reply);
+            const bool off = info->state && info->power_level != XCB_DPMS_DPMS_MODE_ON;
+            free(reply);
+            setReason(kDpmsOff, off);
+        }
+    }
+
+    dpmsSequence = xcb_dpms_info(conn).sequence;
+    xcb_flush(conn);
+}
+
+void SessionMonitor::discardDpms()
+{
+    if (!dpmsSequence)
+        return;
+
+    auto x11 = qGuiApp ? qGuiApp->nativeInterface<QNativeInterface::QX11Application>() : nullptr;
+    if (xcb_connection_t *conn = x11 ? x11->connection() : nullptr)
+        xcb_discard_reply(conn, dpmsSequence);
+    dpmsSequence = 0;
+}
+
+void SessionMonitor::setReason(Reason reason, bool on)
+{
+    const bool was = isSuspended();
+    state.setFlag(reason, on);
+
+    if (was != isSuspended()) {
+        fmInfo() << "session state changed:" << state;
+        emit suspendChanged(isSuspended());
+    }
+}
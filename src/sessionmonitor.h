@@ -0,0 +1,67 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef SESSIONMONITOR_H
+#define SESSIONMONITOR_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QObject>
+#include <QDBusConnection>
+#include <QTimer>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Watches whether anybody can see the wallpaper: session lock and screensaver
+ * over D-Bus, DPMS state of X11. All of them are of the whole session, so is
+ * the suspension.
+ */
+class SessionMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Reason {
+        kNone = 0,
+        kLocked = 0x1,
+        kScreenSaver = 0x2,
+        kDpmsOff = 0x4,
+    };
+    Q_DECLARE_FLAGS(Reasons, Reason)
+
+    explicit SessionMonitor(const QDBusConnection &bus = QDBusConnection::sessionBus(), QObject *parent = nullptr);
+    ~SessionMonitor() override;
+    void start();
+    void stop();
+
+    Reasons reasons() const;
+    bool isSuspended() const;
+
+signals:
+    void suspendChanged(bool suspend);
+
+private slots:
+    void onScreenSaverActiveChanged(bool active);
+    void onSessionPropertiesChanged(const QString &interface, const QVariantMap &changed, const QStringList &invalidated);
+    void checkDpms();
+
+private:
+    void setReason(Reason reason, bool on);
+    void discardDpms();
+
+private:
+    QDBusConnection bus;
+    QTimer dpmsTimer;
+    unsigned int dpmsSequence = 0; // of the request whose reply is not read yet, 0 if none
+    Reasons state = kNone;
+    bool started = false;
+    unsigned int generation = 0; // of start, replies to an earlier one are stale
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(DDP_VIDEOWALLPAPER_NAMESPACE::SessionMonitor::Reasons)
+
+#endif // SESSIONMONITOR_H
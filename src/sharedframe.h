@@ -0,0 +1,184 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef SHAREDFRAME_H
+#define SHAREDFRAME_H
+
+#include <QByteArray>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * Frame transport between the plugin and the out-of-process decoder.
+ *
+ * The decoder owns a memfd holding a Header followed by kSlots frames of
+ * RGBX8888. A frame is published by writing a slot that is neither the latest
+ * one nor the one being read, then storing its index to latest and bumping
+ * sequence. The consumer stores the slot it reads to reading, and checks that
+ * it is still the latest, so that the decoder never writes to it; that is a
+ * store then load on both sides, so all of it is seq_cst. The consumer shows
+ * the slot in place and resets reading to kNoSlot once no frame of it is left.
+ * The size fields are only trusted as read when the buffer is attached.
+ *
+ * Control messages are json objects, one per SOCK_SEQPACKET datagram, the
+ * memfd is passed along with the "buffer" event by SCM_RIGHTS.
+ *
+ * The per-host decoder listens on kHostSocket and shares one buffer among
+ * all sessions playing the same clip at the same size. None of them may hold
+ * back the decoder or write to the buffer, so it is sealed read only, has a
+ * HostHeader, and frames are copied out: each slot has a sequence that is odd
+ * while the slot is written, a copy is only good if it did not change. The
+ * sessions pass the file to play along with "load" by SCM_RIGHTS, so that
+ * nobody gets a clip played that they can not read themselves.
+ */
+namespace ddplugin_videowallpaper {
+namespace SharedFrame {
+
+inline constexpr uint32_t kMagic = 0x46535756; // "VWSF"
+inline constexpr uint32_t kVersion = 1;
+inline constexpr uint32_t kSlots = 3;
+inline constexpr uint32_t kNoSlot = UINT32_MAX;
+inline constexpr int kMaxMessage = 4096;
+inline constexpr int kMaxFds = 4; // received per message, all but the first are closed
+
+inline constexpr uint32_t kHostVersion = 2;
+inline constexpr uint32_t kHostSlots = 4;
+inline constexpr char kHostSocket[] = "/run/dde-videowallpaper/decoder.sock";
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t slots;
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint32_t> latest;
+    std::atomic<uint32_t> reading;
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared atomics must be lock free");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared atomics must be lock free");
+
+// starts like Header, so that the size fields are read the same way
+struct HostHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t slots;
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint32_t> latest;
+    std::atomic<uint32_t> reserved;
+    std::atomic<uint64_t> slotSequence[kHostSlots];
+};
+static_assert(sizeof(HostHeader) <= 4096, "the host header must fit the header page");
+
+inline size_t headerSize()
+{
+    return (sizeof(Header) + 4095) & ~size_t(4095);
+}
+
+inline size_t slotSize(uint32_t stride, uint32_t height)
+{
+    return size_t(stride) * height;
+}
+
+inline size_t bufferSize(uint32_t stride, uint32_t height)
+{
+    return headerSize() + slotSize(stride, height) * kSlots;
+}
+
+inline size_t hostBufferSize(uint32_t stride, uint32_t height)
+{
+    return headerSize() + slotSize(stride, height) * kHostSlots;
+}
+
+// the size is the one the buffer was created or checked with, never the
+// header of a mapping the other side can still write to.
+inline uchar *slotData(void *base, uint32_t stride, uint32_t height, uint32_t slot)
+{
+    return static_cast<uchar *>(base) + headerSize() + slotSize(stride, height) * slot;
+}
+
+inline bool sendMessage(int sock, const QByteArray &msg, int fd = -1)
+{
+    iovec iov { const_cast<char *>(msg.constData()), static_cast<size_t>(msg.size()) };
+    msghdr hdr {};
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    if (fd >= 0) {
+        memset(control, 0, sizeof(control));
+        hdr.msg_control = control;
+        hdr.msg_controllen = sizeof(control);
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    return sendmsg(sock, &hdr, MSG_NOSIGNAL) == msg.size();
+}
+
+// returns false when the peer is gone, msg is left empty if nothing is pending,
+// fd is the first descriptor passed along, -1 if none or the control data was truncated
+inline bool receiveMessage(int sock, QByteArray *msg, int *fd)
+{
+    msg->clear();
+    *fd = -1;
+
+    char buf[kMaxMessage];
+    iovec iov { buf, sizeof(buf) };
+    char control[CMSG_SPACE(sizeof(int) * kMaxFds)];
+    msghdr hdr {};
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control;
+    hdr.msg_controllen = sizeof(control);
+
+    ssize_t n = recvmsg(sock, &hdr, MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+    if (n <= 0)
+        return n < 0 && (errno == EAGAIN || errno == EINTR);
+
+    // a peer can pass any number of descriptors, none of them may be leaked.
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+
+        const size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; ++i) {
+            int received = -1;
+            memcpy(&received, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            if (*fd < 0)
+                *fd = received;
+            else
+                close(received);
+        }
+    }
+
+    // the descriptors that did not fit are dropped by the kernel, the message is incomplete.
+    if ((hdr.msg_flags & MSG_CTRUNC) && *fd >= 0) {
+        close(*fd);
+        *fd = -1;
+    }
+
+    *msg = QByteArray(buf, static_cast<int>(n));
+    return true;
+}
+
+} // namespace SharedFrame
+} // namespace ddplugin_videowallpaper
+
+#endif // SHAREDFRAME_H
@@ -0,0 +1,617 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "sourcecache.h"
+#include "animatedimagesource.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QStandardPaths>
+#include <QThread>
+#include <QTimer>
+
+#include <sys/stat.h>
+#include <sys/vfs.h>
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr qint64 kDefaultQuota = 2LL * 1024 * 1024 * 1024;
+static constexpr int kTransferTimeout = 30000; // ms
+static constexpr int kMinBackoff = 5000; // ms
+static constexpr int kMaxBackoff = 10 * 60 * 1000; // ms
+static constexpr char kPartSuffix[] = ".part";
+static constexpr qint64 kCopyChunk = 1024 * 1024;
+
+// statfs f_type of the filesystems whose files are not on a local disk
+static constexpr quint32 kNetworkFilesystems[] = {
+    0x6969, // nfs
+    0x517b, // smb
+    0xff534d42, // cifs
+    0xfe534d42, // smb2
+    0x65735546, // fuse, gvfs and sshfs among others
+    0x01021997, // 9p
+    0x5346414f, // afs
+    0x00c36400, // ceph
+    0x73757245, // coda
+    0x0bd00bd0, // lustre
+};
+
+SourceCache::SourceCache(QObject *parent)
+    : QObject(parent)
+    , limit(kDefaultQuota)
+{
+    // copying must not take the io of the players.
+    pool.setMaxThreadCount(1);
+    pool.setThreadPriority(QThread::LowestPriority);
+    // the chunks of all fetches are written in the order they arrive.
+    writer.setMaxThreadCount(1);
+    // one hung mount blocks one thread.
+    inspector.setMaxThreadCount(1);
+}
+
+SourceCache::~SourceCache()
+{
+    canceled = true;
+    pool.clear();
+    pool.waitForDone();
+    inspector.clear();
+    inspector.waitForDone();
+    writer.waitForDone();
+
+    for (const Fetching &f : fetching.values()) {
+        f.reply->disconnect(this);
+        f.reply->abort();
+        f.reply->deleteLater();
+        f.file->remove();
+        delete f.file;
+    }
+}
+
+bool SourceCache::isSourceList(const QString &file)
+{
+    const QString suffix = QFileInfo(file).suffix().toLower();
+    return suffix == "m3u" || suffix == "urls";
+}
+
+QList<QUrl> SourceCache::readSourceList(const QString &file)
+{
+    QList<QUrl> ret;
+    QFile list(file);
+    if (!list.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        fmWarning() << "can not open source list" << file;
+        return ret;
+    }
+
+    while (!list.atEnd()) {
+        const QString line = QString::fromUtf8(list.readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        QUrl url = QUrl::fromUserInput(line, QFileInfo(file).absolutePath());
+        if (url.isValid())
+            ret << url;
+    }
+
+    return ret;
+}
+
+QList<QUrl> SourceCache::listDirectory(const QString &path)
+{
+    QList<QUrl> ret;
+    QDir dir(path);
+    for (const QFileInfo &file : dir.entryInfoList(QDir::Files)) {
+        if (isSourceList(file.absoluteFilePath())) {
+            ret << readSourceList(file.absoluteFilePath());
+            continue;
+        }
+        ret << QUrl::fromLocalFile(file.absoluteFilePath());
+    }
+
+    return ret;
+}
+
+bool SourceCache::isStream(const QUrl &url)
+{
+    const QString suffix = QFileInfo(url.path()).suffix().toLower();
+    return suffix == "m3u8" || suffix == "mpd"
+            || (url.scheme() != "http" && url.scheme() != "https");
+}
+
+bool SourceCache::isNetworkFile(const QString &file)
+{
+    struct statfs fs;
+    if (statfs(QFile::encodeName(file).constData(), &fs) != 0)
+        return false;
+
+    const quint32 type = static_cast<quint32>(fs.f_type);
+    for (quint32 network : kNetworkFilesystems) {
+        if (type == network)
+            return true;
+    }
+    return false;
+}
+
+QUrl SourceCache::resolve(const QUrl &url)
+{
+    if (url.isLocalFile())
+        return mirror(url.toLocalFile());
+
+    if (isStream(url) || rejected.contains(url))
+        return url;
+
+    const QString path = cachePath(url);
+    if (QFileInfo::exists(path)) {
+        // the cache is evicted by the least recent use.
+        QFile file(path);
+        if (file.open(QIODevice::ReadWrite))
+            file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        return QUrl::fromLocalFile(path);
+    }
+
+    if (!fetching.contains(url) && !waiting.contains(url))
+        fetch(url);
+
+    return QUrl();
+}
+
+qint64 SourceCache::clipSize(const QUrl &url) const
+{
+    if (url.isLocalFile())
+        return sizes.value(url.toLocalFile(), -1);
+
+    // the cache is on a local disk.
+    const QFileInfo cached(cachePath(url));
+    return cached.isFile() ? cached.size() : -1;
+}
+
+void SourceCache::validate(const QUrl &url)
+{
+    if (url.isLocalFile())
+        startInspection(url.toLocalFile());
+}
+
+bool SourceCache::isMissing(const QUrl &url) const
+{
+    return url.isLocalFile() && missing.contains(url.toLocalFile());
+}
+
+bool SourceCache::isAnimated(const QUrl &url) const
+{
+    return url.isLocalFile() && animated.contains(url.toLocalFile());
+}
+
+void SourceCache::requestListing(const QString &path)
+{
+    if (listing.contains(path))
+        return;
+
+    listing.insert(path);
+    inspector.start([this, path]() {
+        const QList<QUrl> urls = listDirectory(path);
+        QMetaObject::invokeMethod(this, [this, path, urls]() {
+            listing.remove(path);
+            emit listed(path, urls);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void SourceCache::setQuota(qint64 bytes)
+{
+    limit = bytes;
+    evict(limit);
+}
+
+qint64 SourceCache::quota() const
+{
+    return limit;
+}
+
+QString SourceCache::cacheDir() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+            + "/dde-desktop/video-wallpaper/sources";
+}
+
+QVariantMap SourceCache::stats() const
+{
+    return QVariantMap {
+        { "quota", limit },
+        { "fetching", fetching.size() },
+        { "rejected", rejected.size() },
+        { "mirroring", mirroring.size() },
+        { "inspecting", inspecting.size() },
+        { "unmirrored", unmirrored.size() },
+        { "mirroredBytes", mirroredBytes },
+    };
+}
+
+QUrl SourceCache::mirror(const QString &file)
+{
+    const QUrl local = QUrl::fromLocalFile(file);
+    if (unmirrored.contains(file))
+        return local;
+
+    // the last known mirror is played until the inspection tells otherwise.
+    if (!mirroring.contains(file))
+        startInspection(file);
+
+    // the cache is on a local disk, but its mirror may have been evicted meanwhile.
+    const QString path = mirrors.value(file);
+    if (path.isEmpty() || !QFileInfo::exists(path))
+        return local;
+    return QUrl::fromLocalFile(path);
+}
+
+void SourceCache::startInspection(const QString &file)
+{
+    if (inspecting.contains(file))
+        return;
+
+    inspecting.insert(file);
+    inspector.start([this, file]() {
+        const Inspection result = inspect(file);
+        QMetaObject::invokeMethod(this, [this, file, result]() {
+            onInspected(file, result);
+        }, Qt::QueuedConnection);
+    });
+}
+
+SourceCache::Inspection SourceCache::inspect(const QString &file)
+{
+    Inspection ret;
+    struct stat st;
+    if (::stat(QFile::encodeName(file).constData(), &st) != 0 || !S_ISREG(st.st_mode))
+        return ret;
+
+    ret.exists = true;
+    // a gif is parsed to the end to count its frames.
+    ret.animated = AnimatedImageSource::isAnimatedImage(file);
+    ret.size = static_cast<qint64>(st.st_size);
+    const quint64 mount = static_cast<quint64>(st.st_dev);
+    auto itor = networkMounts.constFind(mount);
+    if (itor == networkMounts.constEnd())
+        itor = networkMounts.insert(mount, isNetworkFile(file));
+    if (!itor.value())
+        return ret;
+
+    const QFileInfo info(file);
+    ret.network = true;
+    ret.size = info.size();
+    ret.modified = info.lastModified();
+    ret.path = mirrorPath(file, ret.size, ret.modified);
+
+    QFile cached(ret.path);
+    if (cached.exists()) {
+        // a truncated copy is never played.
+        if (cached.size() == ret.size) {
+            if (cached.open(QIODevice::ReadWrite))
+                cached.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+            ret.cached = true;
+            return ret;
+        }
+
+        fmWarning() << "mirror of" << file << "is broken, copy it again";
+        cached.remove();
+    }
+
+    return ret;
+}
+
+void SourceCache::onInspected(const QString &file, const Inspection &result)
+{
+    inspecting.remove(file);
+    const bool wasMissing = missing.contains(file);
+    const bool wasAnimated = animated.contains(file);
+    if (result.exists)
+        missing.remove(file);
+    else
+        missing.insert(file);
+    if (result.animated)
+        animated.insert(file);
+    else
+        animated.remove(file);
+    if (wasMissing != !result.exists || wasAnimated != result.animated)
+        emit kindChanged(QUrl::fromLocalFile(file));
+
+    if (sizes.value(file, -1) != result.size) {
+        sizes.insert(file, result.size);
+        emit sized(QUrl::fromLocalFile(file));
+    }
+
+    const QString last = mirrors.value(file);
+    if (result.cached) {
+        mirrors.insert(file, result.path);
+        if (last != result.path)
+            emit ready(QUrl::fromLocalFile(file));
+        return;
+    }
+
+    // the source changed or is no longer on a network filesystem, play it in place.
+    if (!last.isEmpty()) {
+        mirrors.remove(file);
+        emit ready(QUrl::fromLocalFile(file));
+    }
+
+    if (!result.network || mirroring.contains(file))
+        return;
+
+    if (result.size > limit) {
+        fmWarning() << "source" << file << "is larger than the cache quota" << limit << ", play it in place";
+        unmirrored.insert(file);
+        return;
+    }
+
+    mirroring.insert(file);
+    QDir().mkpath(cacheDir());
+    fmInfo() << "mirror source" << file << "from a network filesystem," << result.size << "bytes";
+
+    const QString path = result.path;
+    const qint64 size = result.size;
+    const QDateTime modified = result.modified;
+    pool.start([this, file, path, size, modified]() {
+        const QString part = path + kPartSuffix;
+        bool ok = copyFile(file, part, canceled);
+        // the source must not have changed while it was copied.
+        const QFileInfo after(file);
+        ok = ok && after.size() == size && after.lastModified() == modified
+                && QFileInfo(part).size() == size;
+        if (!ok)
+            QFile::remove(part);
+
+        QMetaObject::invokeMethod(this, [this, file, path, size, ok]() {
+            onMirrored(file, ok ? path : QString(), size);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void SourceCache::onMirrored(const QString &file, const QString &path, qint64 size)
+{
+    mirroring.remove(file);
+    if (path.isEmpty()) {
+        fmWarning() << "can not mirror" << file << ", play it in place";
+        unmirrored.insert(file);
+        return;
+    }
+
+    evict(limit - size);
+    QFile::remove(path);
+    if (!QFile::rename(path + kPartSuffix, path)) {
+        fmWarning() << "can not move the mirror of" << file << "into place";
+        QFile::remove(path + kPartSuffix);
+        unmirrored.insert(file);
+        return;
+    }
+
+    mirroredBytes += size;
+    mirrors.insert(file, path);
+    fmInfo() << "source" << file << "is mirrored to" << path;
+    emit ready(QUrl::fromLocalFile(file));
+}
+
+bool SourceCache::copyFile(const QString &file, const QString &part, const std::atomic_bool &cancel)
+{
+    QFile in(file);
+    QFile out(part);
+    if (!in.open(QIODevice::ReadOnly) || !out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    QByteArray buffer(kCopyChunk, Qt::Uninitialized);
+    while (!cancel) {
+        const qint64 n = in.read(buffer.data(), buffer.size());
+        if (n < 0)
+            return false;
+        if (n == 0)
+            return true;
+        if (out.write(buffer.constData(), n) != n)
+            return false;
+    }
+
+    return false;
+}
+
+void SourceCache::fetch(const QUrl &url)
+{
+    QDir().mkpath(cacheDir());
+    QFile *file = new QFile(cachePath(url) + kPartSuffix);
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        fmWarning() << "can not write cache" << file->fileName();
+        delete file;
+        return;
+    }
+
+    if (!manager)
+        manager = new QNetworkAccessManager(this);
+
+    QNetworkRequest request(url);
+    request.setTransferTimeout(kTransferTimeout);
+    QNetworkReply *reply = manager->get(request);
+    fetching.insert(url, { reply, file });
+    fmInfo() << "fetch source" << url;
+
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, url]() {
+        checkLength(url);
+    });
+    connect(reply, &QNetworkReply::readyRead, this, [this, url]() {
+        onReadyRead(url);
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, url]() {
+        onFinished(url);
+    });
+}
+
+void SourceCache::checkLength(const QUrl &url)
+{
+    auto itor = fetching.constFind(url);
+    if (itor == fetching.constEnd())
+        return;
+
+    // no need to download what does not fit.
+    bool ok = false;
+    const qint64 length = itor->reply->header(QNetworkRequest::ContentLengthHeader).toLongLong(&ok);
+    if (ok && length > limit) {
+        fmWarning() << "source" << url << "has" << length << "bytes, more than the cache quota" << limit;
+        reject(url);
+    }
+}
+
+void SourceCache::onReadyRead(const QUrl &url)
+{
+    auto itor = fetching.find(url);
+    if (itor == fetching.end() || itor->tooLarge)
+        return;
+
+    const QByteArray data = itor->reply->readAll();
+    itor->received += data.size();
+    if (itor->received > limit) {
+        fmWarning() << "source" << url << "exceeds the cache quota" << limit << "while it is fetched";
+        reject(url);
+        return;
+    }
+
+    QFile *file = itor->file;
+    writer.start([file, data]() {
+        file->write(data);
+    });
+}
+
+void SourceCache::reject(const QUrl &url)
+{
+    auto itor = fetching.find(url);
+    if (itor == fetching.end())
+        return;
+
+    itor->tooLarge = true;
+    // finished is emitted from within abort.
+    QNetworkReply *reply = itor->reply;
+    reply->abort();
+}
+
+void SourceCache::onFinished(const QUrl &url)
+{
+    Fetching f = fetching.take(url);
+    if (!f.reply)
+        return;
+
+    f.reply->deleteLater();
+    QByteArray rest;
+    bool failed = false;
+    if (f.tooLarge) {
+        rejected.insert(url);
+    } else if (f.reply->error() != QNetworkReply::NoError) {
+        fmWarning() << "fetch source" << url << "failed:" << f.reply->errorString();
+        failed = true;
+    } else {
+        rest = f.reply->readAll();
+        if (f.received + rest.size() > limit) {
+            fmWarning() << "source" << url << "is larger than the cache quota" << limit;
+            rejected.insert(url);
+            f.tooLarge = true;
+        }
+    }
+
+    if (f.tooLarge)
+        fmInfo() << "play" << url << "from the network";
+
+    // after the chunks still queued for the file.
+    const bool keep = !f.tooLarge && !failed;
+    QFile *file = f.file;
+    writer.start([this, url, file, rest, keep, failed]() {
+        if (keep)
+            file->write(rest);
+        file->close();
+        if (!keep)
+            file->remove();
+
+        QMetaObject::invokeMethod(this, [this, url, file, keep, failed]() {
+            onWritten(url, file, keep, failed);
+        }, Qt::QueuedConnection);
+    });
+
+    // the players take it from the network now.
+    if (f.tooLarge)
+        emit ready(url);
+}
+
+void SourceCache::onWritten(const QUrl &url, QFile *file, bool keep, bool failed)
+{
+    if (!keep) {
+        delete file;
+        // the part file is gone, a new fetch can not clash with it.
+        if (failed)
+            retry(url);
+        return;
+    }
+
+    const qint64 size = file->size();
+    evict(limit - size);
+    const QString path = cachePath(url);
+    QFile::remove(path);
+    file->rename(path);
+    delete file;
+
+    failures.remove(url);
+    fmInfo() << "source" << url << "is cached," << size << "bytes";
+    emit ready(url);
+}
+
+void SourceCache::retry(const QUrl &url)
+{
+    const int n = failures.value(url) + 1;
+    failures.insert(url, n);
+
+    const int delay = static_cast<int>(qMin<qint64>(static_cast<qint64>(kMinBackoff) << qMin(n - 1, 16), kMaxBackoff));
+    fmInfo() << "retry" << url << "in" << delay << "ms";
+    waiting.insert(url);
+    QTimer::singleShot(delay, this, [this, url]() {
+        waiting.remove(url);
+        if (!fetching.contains(url))
+            fetch(url);
+    });
+}
+
+void SourceCache::evict(qint64 keep)
+{
+    QDir dir(cacheDir());
+    // the least recently used first
+    QFileInfoList files = dir.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+
+    qint64 total = 0;
+    for (const QFileInfo &info : files)
+        total += info.size();
+
+    for (const QFileInfo &info : files) {
+        if (total <= keep)
+            break;
+
+        if (info.fileName().endsWith(kPartSuffix))
+            continue;
+
+        fmInfo() << "evict cached source" << info.fileName();
+        total -= info.size();
+        QFile::remove(info.absoluteFilePath());
+    }
+}
+
+QString SourceCache::mirrorPath(const QString &file, qint64 size, const QDateTime &modified) const
+{
+    const QByteArray id = QFileInfo(file).absoluteFilePath().toUtf8() + '\n'
+            + QByteArray::number(size) + '\n'
+            + QByteArray::number(modified.toMSecsSinceEpoch());
+    const QByteArray hash = QCryptographicHash::hash(id, QCryptographicHash::Sha1).toHex();
+    const QString suffix = QFileInfo(file).suffix();
+    return cacheDir() + "/" + hash + (suffix.isEmpty() ? QString() : "." + suffix);
+}
+
+QString SourceCache::cachePath(const QUrl &url) const
+{
+    const QByteArray hash = QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex();
+    const QString suffix = QFileInfo(url.path()).suffix();
+    return cacheDir() + "/" + hash + (suffix.isEmpty() ? QString() : "." + suffix);
+}
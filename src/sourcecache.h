@@ -0,0 +1,148 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef SOURCECACHE_H
+#define SOURCECACHE_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QThreadPool>
+#include <QUrl>
+#include <QVariantMap>
+
+#include <atomic>
+
+class QFile;
+class QNetworkAccessManager;
+class QNetworkReply;
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Fetches remote sources once into a bounded disk cache, so that they are
+ * looped from the local copy.
+ *
+ * All network io is asynchronous and written to disk by a thread of its own,
+ * failed fetches are retried with an exponential backoff. A fetch is aborted
+ * as soon as it is known to exceed the quota, such a source is played from
+ * the network.
+ *
+ * Local files on network filesystems (NFS, SMB, FUSE...) are mirrored into
+ * the same cache by a low priority thread and played from there once
+ * copied. Mirrors are keyed by path, size and modification time, so an
+ * edited source is copied again and the stale copy ages out by LRU.
+ * Nothing of a local file is touched by the gui thread: whether it is on a
+ * network filesystem, its size and time are looked up by a thread of its
+ * own, so a hung mount never freezes the desktop. The kind of filesystem is
+ * cached per mount. The same thread tells whether a local file is still
+ * there and whether it is an animated image, the engine asks for it here.
+ */
+class SourceCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SourceCache(QObject *parent = nullptr);
+    ~SourceCache() override;
+
+    // a text file listing one url per line, lines starting with '#' are comments
+    static bool isSourceList(const QString &file);
+    static QList<QUrl> readSourceList(const QString &file);
+    // the files of a directory, with the urls of its source lists in their place
+    static QList<QUrl> listDirectory(const QString &path);
+    // live or segmented streams are played directly, they can not be cached as a file
+    static bool isStream(const QUrl &url);
+    // by the statfs type of the filesystem holding it
+    static bool isNetworkFile(const QString &file);
+
+    // the url to play, or an empty one if it is still being fetched
+    QUrl resolve(const QUrl &url);
+    // bytes of the file played for the url, -1 until known
+    qint64 clipSize(const QUrl &url) const;
+    // looks a local file up off the gui thread, kindChanged tells what changed
+    void validate(const QUrl &url);
+    // as of the last look up, false until known
+    bool isMissing(const QUrl &url) const;
+    bool isAnimated(const QUrl &url) const;
+    // lists a directory off the gui thread, listed tells what is in it
+    void requestListing(const QString &path);
+    void setQuota(qint64 bytes);
+    qint64 quota() const;
+    QString cacheDir() const;
+    QVariantMap stats() const;
+
+signals:
+    void ready(const QUrl &url);
+    void sized(const QUrl &url);
+    // a local file was found gone or back, or to be an animated image or not
+    void kindChanged(const QUrl &url);
+    void listed(const QString &path, const QList<QUrl> &urls);
+
+private:
+    void fetch(const QUrl &url);
+    void onReadyRead(const QUrl &url);
+    void checkLength(const QUrl &url);
+    void reject(const QUrl &url);
+    void onFinished(const QUrl &url);
+    void onWritten(const QUrl &url, QFile *file, bool keep, bool failed);
+    void retry(const QUrl &url);
+    QUrl mirror(const QString &file);
+    void startInspection(const QString &file);
+    struct Inspection
+    {
+        bool exists = false; // a regular file
+        bool animated = false;
+        bool network = false;
+        QString path; // of the mirror
+        bool cached = false; // the mirror is complete
+        qint64 size = -1;
+        QDateTime modified;
+    };
+    Inspection inspect(const QString &file);
+    void onInspected(const QString &file, const Inspection &result);
+    void onMirrored(const QString &file, const QString &path, qint64 size);
+    static bool copyFile(const QString &file, const QString &part, const std::atomic_bool &cancel);
+    void evict(qint64 keep);
+    QString cachePath(const QUrl &url) const;
+    QString mirrorPath(const QString &file, qint64 size, const QDateTime &modified) const;
+
+private:
+    struct Fetching
+    {
+        QNetworkReply *reply = nullptr;
+        QFile *file = nullptr; // written by the writer only once opened
+        qint64 received = 0;
+        bool tooLarge = false;
+    };
+
+    QNetworkAccessManager *manager = nullptr;
+    QHash<QUrl, Fetching> fetching;
+    QHash<QUrl, int> failures;
+    QSet<QUrl> waiting; // fetch is scheduled by backoff
+    QSet<QUrl> rejected; // larger than the quota
+    QThreadPool writer;
+    qint64 limit;
+
+    QThreadPool pool;
+    std::atomic_bool canceled { false };
+    QSet<QString> mirroring;
+    QSet<QString> unmirrored; // too large or failed, played in place
+    qint64 mirroredBytes = 0;
+    QHash<QString, QString> mirrors; // by source, as of the last inspection
+    QHash<QString, qint64> sizes; // of local sources, as of the last inspection
+    QSet<QString> inspecting;
+    QSet<QString> listing; // directories
+    QSet<QString> missing; // as of the last inspection
+    QSet<QString> animated;
+    QThreadPool inspector;
+    QHash<quint64, bool> networkMounts; // by st_dev, used by the inspector only
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // SOURCECACHE_H
@@ -0,0 +1,189 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "thermalmonitor.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <limits>
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr int kSampleInterval = 5000; // ms, temperatures change slowly
+static constexpr qreal kPausedHeadroom = 5; // celsius below the critical trip
+static constexpr qreal kHysteresis = 3; // to be cooler than that to step up
+static constexpr int kStepUpSamples = 6; // cool for 30s
+
+static qreal readCelsius(const QString &path, bool *ok)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *ok = false;
+        return 0;
+    }
+
+    // millidegree celsius
+    return file.readAll().trimmed().toLongLong(ok) / 1000.0;
+}
+
+ThermalMonitor::ThermalMonitor(const QString &sysRoot, QObject *parent)
+    : QObject(parent)
+    , root(sysRoot)
+{
+    timer.setInterval(kSampleInterval);
+    connect(&timer, &QTimer::timeout, this, &ThermalMonitor::sample);
+}
+
+void ThermalMonitor::start()
+{
+    if (timer.isActive())
+        return;
+
+    coolCount = 0;
+    timer.start();
+    sample();
+}
+
+void ThermalMonitor::stop()
+{
+    timer.stop();
+    if (current != QualityLevel::kFull) {
+        current = QualityLevel::kFull;
+        emit levelChanged(current);
+    }
+}
+
+QualityLevel ThermalMonitor::level() const
+{
+    return current;
+}
+
+void ThermalMonitor::setHeadroom(qreal reduced)
+{
+    reducedHeadroom = reduced;
+    lowHeadroom = reduced / 2;
+}
+
+QVariantMap ThermalMonitor::stats() const
+{
+    return QVariantMap {
+        { "level", qualityName(current) },
+        { "zones", zoneCount },
+        { "zone", hottest.name },
+        { "temp", hottest.temp },
+        { "passive", hottest.passive },
+        { "critical", hottest.critical },
+        { "headroom", reducedHeadroom },
+        { "changes", changes },
+    };
+}
+
+QualityLevel ThermalMonitor::levelOf(const Zone &zone, qreal margin) const
+{
+    if (zone.critical > 0 && zone.temp + margin >= zone.critical - kPausedHeadroom)
+        return QualityLevel::kPaused;
+
+    if (zone.passive <= 0)
+        return QualityLevel::kFull;
+
+    const qreal headroom = zone.passive - zone.temp - margin;
+    if (headroom < lowHeadroom)
+        return QualityLevel::kLow;
+    if (headroom < reducedHeadroom)
+        return QualityLevel::kReduced;
+    return QualityLevel::kFull;
+}
+
+void ThermalMonitor::evaluate(const QList<Zone> &zones)
+{
+    zoneCount = zones.size();
+    QualityLevel target = QualityLevel::kFull;
+    QualityLevel cooled = QualityLevel::kFull;
+    qreal least = std::numeric_limits<qreal>::max();
+    for (const Zone &zone : zones) {
+        target = qMax(target, levelOf(zone, 0));
+        cooled = qMax(cooled, levelOf(zone, kHysteresis));
+
+        // the zone closest to a trip point is the one to report.
+        const qreal trip = zone.passive > 0 ? zone.passive : zone.critical;
+        if (trip > 0 && trip - zone.temp < least) {
+            least = trip - zone.temp;
+            hottest = zone;
+        }
+    }
+
+    QualityLevel next = current;
+    if (target > current) {
+        // heat builds up fast, no need to wait.
+        next = target;
+        coolCount = 0;
+    } else if (cooled < current) {
+        if (++coolCount >= kStepUpSamples) {
+            next = higherQuality(current);
+            coolCount = 0;
+        }
+    } else {
+        coolCount = 0;
+    }
+
+    if (next == current)
+        return;
+
+    fmInfo() << "thermal zone" << hottest.name << hottest.temp << "C (passive" << hottest.passive
+             << "critical" << hottest.critical << "), quality" << qualityName(current)
+             << "->" << qualityName(next);
+    current = next;
+    ++changes;
+    emit levelChanged(current);
+}
+
+void ThermalMonitor::sample()
+{
+    evaluate(readZones());
+}
+
+QList<ThermalMonitor::Zone> ThermalMonitor::readZones() const
+{
+    QList<Zone> zones;
+    const QDir dir(root);
+    for (const QString &name : dir.entryList({ "thermal_zone*" }, QDir::Dirs | QDir::NoDotAndDotDot)) {
+        const QString path = dir.filePath(name);
+        bool ok = false;
+        Zone zone;
+        zone.temp = readCelsius(path + "/temp", &ok);
+        if (!ok)
+            continue;
+
+        QFile type(path + "/type");
+        zone.name = type.open(QIODevice::ReadOnly) ? QString::fromLatin1(type.readAll().trimmed()) : name;
+
+        // trip_point_0_type and trip_point_0_temp, ...
+        const QDir zoneDir(path);
+        for (const QString &trip : zoneDir.entryList({ "trip_point_*_type" }, QDir::Files)) {
+            QFile tripType(zoneDir.filePath(trip));
+            if (!tripType.open(QIODevice::ReadOnly))
+                continue;
+
+            const QByteArray kind = tripType.readAll().trimmed();
+            QString tempFile = trip;
+            tempFile.replace("_type", "_temp");
+            const qreal temp = readCelsius(zoneDir.filePath(tempFile), &ok);
+            // disabled trip points read as 0 or below.
+            if (!ok || temp <= 0)
+                continue;
+
+            if (kind == "passive" || kind == "hot") {
+                zone.passive = zone.passive > 0 ? qMin(zone.passive, temp) : temp;
+            } else if (kind == "critical") {
+                zone.critical = zone.critical > 0 ? qMin(zone.critical, temp) : temp;
+            }
+        }
+
+        if (zone.passive > 0 || zone.critical > 0)
+            zones.append(zone);
+    }
+
+    return zones;
+}
@@ -0,0 +1,74 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef THERMALMONITOR_H
+#define THERMALMONITOR_H
+
+#include "ddplugin_videowallpaper_global.h"
+#include "qualitylevel.h"
+
+#include <QObject>
+#include <QTimer>
+#include <QVariantMap>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Steps the quality down as a thermal zone gets close to the temperature
+ * at which the kernel starts throttling, and back up one step at a time
+ * once it has cooled down.
+ *
+ * Zones and their trip points are read from /sys/class/thermal, the root
+ * can be replaced to replay recorded readings.
+ */
+class ThermalMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Zone
+    {
+        QString name;
+        qreal temp = 0; // celsius
+        qreal passive = 0; // throttling starts, 0 if unknown
+        qreal critical = 0; // shutdown, 0 if unknown
+    };
+
+    explicit ThermalMonitor(const QString &sysRoot = "/sys/class/thermal", QObject *parent = nullptr);
+
+    void start();
+    void stop();
+    QualityLevel level() const;
+    // celsius below the passive trip to step down at, low quality at half of it
+    void setHeadroom(qreal reduced);
+    QVariantMap stats() const;
+
+    // applies the policy to one reading of all zones, the timer feeds it from sysfs
+    void evaluate(const QList<Zone> &zones);
+
+signals:
+    void levelChanged(QualityLevel level);
+
+private slots:
+    void sample();
+
+private:
+    QList<Zone> readZones() const;
+    QualityLevel levelOf(const Zone &zone, qreal margin) const;
+
+private:
+    QString root;
+    QTimer timer;
+    QualityLevel current = QualityLevel::kFull;
+    qreal reducedHeadroom = 10;
+    qreal lowHeadroom = 5;
+    Zone hottest;
+    int zoneCount = 0;
+    int coolCount = 0;
+    int changes = 0;
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // THERMALMONITOR_H
@@ -1,5 +1,6 @@
 ﻿#include "third_party/mpvwidget.h"
 #include "third_party/common/qthelper.hpp"
+#include "tracer.h"
 
 #include <QOpenGLContext>
 
@@ -8,6 +9,7 @@
 MpvWidget::MpvWidget(QWidget *parent, Qt::WindowFlags f)
     : QOpenGLWidget(parent, f)
 {
+    VW_TRACE_SCOPE("MpvWidget::create");
     mpv = mpv_create();
     if (!mpv) {
         throw std::runtime_error("could not create mpv context");
@@ -22,9 +24,8 @@ MpvWidget::MpvWidget(QWidget *parent, Qt::WindowFlags f)
 
     // Request hw decoding, just for testing.
     mpv::qt::set_option_variant(mpv, "hwdec", "auto");
-#ifndef ENABLE_AUDIO_OUTPUT
-    mpv::qt::set_option_variant(mpv, "volume", 0);
-#endif
+    // the audio track is only selected when it is audible, see WallpaperEnginePrivate::applyAudio
+    mpv::qt::set_option_variant(mpv, "aid", "no");
     mpv::qt::set_option_variant(mpv, "loop", "inf");
 
     mpv_observe_property(mpv, 0, "duration", MPV_FORMAT_DOUBLE);
@@ -34,10 +35,7 @@ MpvWidget::MpvWidget(QWidget *parent, Qt::WindowFlags f)
 
 MpvWidget::~MpvWidget()
 {
-    makeCurrent();
-    if (mpv_gl) {
-        mpv_render_context_free(mpv_gl);
-    }
+    releaseGL();
     mpv_terminate_destroy(mpv);
 }
 
@@ -58,6 +56,7 @@ QVariant MpvWidget::getProperty(const QString &name) const
 
 void MpvWidget::initializeGL()
 {
+    VW_TRACE_SCOPE("MpvWidget::initializeGL");
     mpv_opengl_init_params gl_init_params[1] = {{MpvWidget::get_proc_address, nullptr}};
     mpv_render_param params[] {
         {MPV_RENDER_PARAM_API_TYPE, const_cast<char *>(MPV_RENDER_API_TYPE_OPENGL)},
@@ -68,10 +67,30 @@ void MpvWidget::initializeGL()
         throw std::runtime_error("failed to initialize mpv GL context");
     }
     mpv_render_context_set_update_callback(mpv_gl, MpvWidget::on_update, reinterpret_cast<void *>(this));
+
+    // QOpenGLWidget recreates its context when moved to another top-level window,
+    // only the render context goes with it, the decoder keeps its state.
+    connect(context(), &QOpenGLContext::aboutToBeDestroyed, this, &MpvWidget::releaseGL, Qt::DirectConnection);
+}
+
+void MpvWidget::releaseGL()
+{
+    if (!mpv_gl) {
+        return;
+    }
+
+    makeCurrent();
+    mpv_render_context_free(mpv_gl);
+    mpv_gl = nullptr;
+    doneCurrent();
 }
 
 void MpvWidget::paintGL()
 {
+    if (!mpv_gl) {
+        return;
+    }
+
     mpv_opengl_fbo mpfbo {static_cast<int>(defaultFramebufferObject()), width(), height(), 0};
     int flip_y = 1;
 
@@ -82,6 +101,11 @@ void MpvWidget::paintGL()
     // See render_gl.h on what OpenGL environment mpv expects, and
     // other API details.
     mpv_render_context_render(mpv_gl, params);
+
+    if (!first_frame) {
+        first_frame = true;
+        VW_TRACE_INSTANT("first frame rendered");
+    }
 }
 
 void MpvWidget::on_mpv_events()
@@ -114,6 +138,10 @@ void MpvWidget::handle_mpv_event(mpv_event *event)
         }
         break;
     }
+    case MPV_EVENT_FILE_LOADED:
+        // where to resume is for the first round of a looped playlist only.
+        mpv::qt::set_property_variant(mpv, "start", "none");
+        break;
     default: // Ignore uninteresting or unknown events.
         break;
     }
@@ -37,10 +37,12 @@ signals:
 private slots:
     void on_mpv_events();
     void maybeUpdate();
+    void releaseGL();
 
 private:
-    mpv_handle *mpv;
-    mpv_render_context *mpv_gl;
+    mpv_handle *mpv = nullptr;
+    mpv_render_context *mpv_gl = nullptr;
+    bool first_frame = false;
 };
 
 #endif // PLAYERWINDOW_H
@@ -0,0 +1,209 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "thumbnailcache.h"
+#include "animatedimagesource.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QFile>
+#include <QStandardPaths>
+#include <QThread>
+
+#include <mpv/client.h>
+#include <mpv/render.h>
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr int kThumbnailWidth = 160;
+static constexpr int kThumbnailHeight = 90;
+static constexpr int kGrabTimeout = 5000; // ms
+
+class ThumbnailCacheGlobal : public ThumbnailCache
+{
+};
+Q_GLOBAL_STATIC(ThumbnailCacheGlobal, thumbnailCache)
+
+ThumbnailCache *ThumbnailCache::instance()
+{
+    return thumbnailCache;
+}
+
+ThumbnailCache::ThumbnailCache(QObject *parent)
+    : QObject(parent)
+{
+    // one at a time, the menu is not worth more.
+    pool.setMaxThreadCount(1);
+    pool.setThreadPriority(QThread::LowestPriority);
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    pool.clear();
+    pool.waitForDone();
+}
+
+QSize ThumbnailCache::thumbnailSize()
+{
+    return QSize(kThumbnailWidth, kThumbnailHeight);
+}
+
+QImage ThumbnailCache::thumbnail(const QString &file)
+{
+    // the last one is shown while the thread looks whether the clip changed.
+    if (!pending.contains(file)) {
+        pending.insert(file);
+        const QString known = keys.value(file);
+        pool.start([this, file, known]() {
+            const QString key = cachePath(file);
+            const QImage image = key.isEmpty() || key == known ? QImage() : generate(file, key);
+            QMetaObject::invokeMethod(this, [this, file, key, image]() {
+                finished(file, key, image);
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    return images.value(file);
+}
+
+QString ThumbnailCache::cacheDir()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+            + "/dde-desktop/video-wallpaper/thumbnails";
+}
+
+QString ThumbnailCache::cachePath(const QString &file)
+{
+    const QFileInfo info(file);
+    if (!info.isFile())
+        return QString();
+
+    // a replaced or edited clip gets a new thumbnail.
+    const QByteArray id = info.absoluteFilePath().toUtf8() + '\n'
+            + QByteArray::number(info.size()) + '\n'
+            + QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+    const QString hash = QCryptographicHash::hash(id, QCryptographicHash::Sha1).toHex();
+    return cacheDir() + "/" + hash + ".png";
+}
+
+void ThumbnailCache::finished(const QString &file, const QString &key, const QImage &image)
+{
+    pending.remove(file);
+    if (key.isEmpty()) {
+        keys.remove(file);
+        images.remove(file);
+        return;
+    }
+
+    // unchanged, nothing was loaded.
+    if (keys.value(file) == key)
+        return;
+
+    // not tried again until the clip changes.
+    keys.insert(file, key);
+    if (image.isNull()) {
+        fmDebug() << "no thumbnail for" << file;
+        images.remove(file);
+        return;
+    }
+
+    images.insert(file, image);
+    emit thumbnailReady(file, image);
+}
+
+QImage ThumbnailCache::generate(const QString &file, const QString &cached)
+{
+    QImage image(cached);
+    if (!image.isNull())
+        return image;
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    if (AnimatedImageSource::isAnimatedImage(file)) {
+        QImageReader reader(file);
+        image = reader.read();
+    } else {
+        image = grabVideo(file);
+    }
+
+    if (image.isNull())
+        return image;
+
+    image = image.scaled(thumbnailSize(), Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+    image = image.copy(QRect(QPoint((image.width() - kThumbnailWidth) / 2, (image.height() - kThumbnailHeight) / 2),
+                             thumbnailSize()));
+
+    QDir().mkpath(QFileInfo(cached).absolutePath());
+    if (!image.save(cached, "PNG"))
+        fmWarning() << "can not write thumbnail" << cached;
+
+    fmDebug() << "thumbnail of" << file << "generated in" << elapsed.elapsed() << "ms";
+    return image;
+}
+
+QImage ThumbnailCache::grabVideo(const QString &file)
+{
+    mpv_handle *mpv = mpv_create();
+    if (!mpv)
+        return QImage();
+
+    // one still frame a bit into the clip, the first one is often black.
+    mpv_set_option_string(mpv, "vo", "libmpv");
+    mpv_set_option_string(mpv, "aid", "no");
+    mpv_set_option_string(mpv, "sid", "no");
+    mpv_set_option_string(mpv, "hwdec", "no");
+    mpv_set_option_string(mpv, "pause", "yes");
+    mpv_set_option_string(mpv, "start", "10%");
+    mpv_set_option_string(mpv, "panscan", "1.0");
+    mpv_render_context *render = nullptr;
+    mpv_render_param params[] {
+        {MPV_RENDER_PARAM_API_TYPE, const_cast<char *>(MPV_RENDER_API_TYPE_SW)},
+        {MPV_RENDER_PARAM_INVALID, nullptr}};
+    if (mpv_initialize(mpv) < 0 || mpv_render_context_create(&render, mpv, params) < 0) {
+        mpv_terminate_destroy(mpv);
+        return QImage();
+    }
+
+    const QByteArray path = QFile::encodeName(file);
+    const char *cmd[] = { "loadfile", path.constData(), nullptr };
+    mpv_command(mpv, cmd);
+
+    QImage image;
+    QElapsedTimer elapsed;
+    elapsed.start();
+    bool loaded = false;
+    while (elapsed.elapsed() < kGrabTimeout) {
+        mpv_event *event = mpv_wait_event(mpv, 0.05);
+        if (event->event_id == MPV_EVENT_END_FILE)
+            break;
+        if (event->event_id == MPV_EVENT_PLAYBACK_RESTART)
+            loaded = true;
+
+        if (!loaded || !(mpv_render_context_update(render) & MPV_RENDER_UPDATE_FRAME))
+            continue;
+
+        // twice the thumbnail, for a sharper scaling.
+        image = QImage(thumbnailSize() * 2, QImage::Format_RGBX8888);
+        int size[2] = { image.width(), image.height() };
+        size_t stride = static_cast<size_t>(image.bytesPerLine());
+        mpv_render_param sw[] {
+            {MPV_RENDER_PARAM_SW_SIZE, size},
+            {MPV_RENDER_PARAM_SW_FORMAT, const_cast<char *>("rgb0")},
+            {MPV_RENDER_PARAM_SW_STRIDE, &stride},
+            {MPV_RENDER_PARAM_SW_POINTER, image.bits()},
+            {MPV_RENDER_PARAM_INVALID, nullptr}};
+        if (mpv_render_context_render(render, sw) < 0)
+            image = QImage();
+        break;
+    }
+
+    mpv_render_context_free(render);
+    mpv_terminate_destroy(mpv);
+    return image;
+}
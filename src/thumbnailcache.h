@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QObject>
+#include <QHash>
+#include <QImage>
+#include <QSet>
+#include <QThreadPool>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Thumbnails of the wallpaper clips for the menu.
+ *
+ * They are kept on disk keyed by path, size and modification time, and
+ * are loaded or generated by a single low priority thread. Lookups never
+ * block, thumbnailReady tells when a missing or changed one is there. In
+ * memory they are kept by path, the clip is looked at by the thread only.
+ */
+class ThumbnailCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ThumbnailCache *instance();
+    ~ThumbnailCache() override;
+
+    static QSize thumbnailSize();
+    // null if not ready yet, it is requested then
+    QImage thumbnail(const QString &file);
+    static QString cacheDir();
+
+signals:
+    void thumbnailReady(const QString &file, const QImage &image);
+
+protected:
+    explicit ThumbnailCache(QObject *parent = nullptr);
+
+private:
+    static QString cachePath(const QString &file);
+    void finished(const QString &file, const QString &key, const QImage &image);
+    static QImage generate(const QString &file, const QString &cached);
+    static QImage grabVideo(const QString &file);
+
+private:
+    QThreadPool pool;
+    QHash<QString, QImage> images; // by file
+    QHash<QString, QString> keys; // cache path by file, as of the last look
+    QSet<QString> pending; // files
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // THUMBNAILCACHE_H
@@ -0,0 +1,130 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "tracer.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+#include <chrono>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr char kTraceEnv[] = "DDP_VIDEOWALLPAPER_TRACE";
+static constexpr int kMaxEvents = 100000;
+static constexpr int kFlushDelay = 2000; // ms
+
+class TracerGlobal : public Tracer
+{
+};
+Q_GLOBAL_STATIC(TracerGlobal, tracer)
+
+std::atomic_bool Tracer::enabled { qEnvironmentVariableIsSet(kTraceEnv) };
+
+Tracer *Tracer::instance()
+{
+    return tracer;
+}
+
+qint64 Tracer::now()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+Tracer::Tracer(QObject *parent)
+    : QObject(parent)
+{
+    // write out a while after the last event, startup is over by then.
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(kFlushDelay);
+    connect(&flushTimer, &QTimer::timeout, this, &Tracer::flush);
+
+    if (qEnvironmentVariableIsSet(kTraceEnv))
+        setOutput(qEnvironmentVariable(kTraceEnv));
+}
+
+Tracer::~Tracer()
+{
+    flush();
+}
+
+void Tracer::setOutput(const QString &f)
+{
+    QMutexLocker lk(&mutex);
+    file = f;
+    enabled.store(!file.isEmpty(), std::memory_order_relaxed);
+    if (!file.isEmpty())
+        fmInfo() << "trace events are written to" << file;
+}
+
+QString Tracer::output() const
+{
+    QMutexLocker lk(&mutex);
+    return file;
+}
+
+void Tracer::complete(const QString &name, qint64 begin, qint64 end)
+{
+    append({ name, 'X', begin, end - begin, static_cast<qint64>(syscall(SYS_gettid)) });
+}
+
+void Tracer::instant(const QString &name)
+{
+    append({ name, 'i', now(), 0, static_cast<qint64>(syscall(SYS_gettid)) });
+}
+
+void Tracer::append(Event &&event)
+{
+    {
+        QMutexLocker lk(&mutex);
+        if (events.size() >= kMaxEvents)
+            return;
+        events.append(std::move(event));
+    }
+
+    // the timer belongs to the main thread.
+    QMetaObject::invokeMethod(&flushTimer, qOverload<>(&QTimer::start), Qt::QueuedConnection);
+}
+
+void Tracer::flush()
+{
+    QMutexLocker lk(&mutex);
+    if (file.isEmpty() || events.isEmpty())
+        return;
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray array;
+    for (const Event &e : events) {
+        QJsonObject obj {
+            { "name", e.name },
+            { "cat", "videowallpaper" },
+            { "ph", QString(QLatin1Char(e.phase)) },
+            { "ts", e.ts },
+            { "pid", pid },
+            { "tid", e.tid },
+        };
+        if (e.phase == 'X')
+            obj.insert("dur", e.dur);
+        else
+            obj.insert("s", "p"); // instant events are drawn across the process
+        array.append(obj);
+    }
+
+    QFile out(file);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        fmWarning() << "can not write trace file" << file;
+        return;
+    }
+
+    QJsonObject root { { "traceEvents", array }, { "displayTimeUnit", "ms" } };
+    out.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+}
@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QObject>
+#include <QMutex>
+#include <QTimer>
+#include <QVector>
+
+#include <atomic>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+/**
+ * Records Chrome trace events (chrome://tracing, ui.perfetto.dev).
+ *
+ * Enabled by the environment variable DDP_VIDEOWALLPAPER_TRACE or the
+ * "traceFile" config key, both giving the json file to write. When disabled
+ * every probe costs one relaxed atomic load.
+ */
+class Tracer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static Tracer *instance();
+    static inline bool isEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+    static qint64 now(); // us
+
+    void setOutput(const QString &file);
+    QString output() const;
+
+    void complete(const QString &name, qint64 begin, qint64 end);
+    void instant(const QString &name);
+
+public slots:
+    void flush();
+
+protected:
+    explicit Tracer(QObject *parent = nullptr);
+    ~Tracer() override;
+
+private:
+    struct Event
+    {
+        QString name;
+        char phase;
+        qint64 ts;
+        qint64 dur;
+        qint64 tid;
+    };
+    void append(Event &&event);
+
+private:
+    static std::atomic_bool enabled;
+    mutable QMutex mutex;
+    QVector<Event> events;
+    QString file;
+    QTimer flushTimer;
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *n)
+        : name(n)
+        , begin(Tracer::isEnabled() ? Tracer::now() : -1)
+    {
+    }
+    ~TraceScope()
+    {
+        if (begin >= 0 && Tracer::isEnabled())
+            Tracer::instance()->complete(QString::fromLatin1(name), begin, Tracer::now());
+    }
+
+private:
+    Q_DISABLE_COPY(TraceScope)
+    const char *name;
+    qint64 begin;
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#define VW_TRACE_CONCAT_IMPL(a, b) a##b
+#define VW_TRACE_CONCAT(a, b) VW_TRACE_CONCAT_IMPL(a, b)
+
+#define VW_TRACE_SCOPE(name) \
+    DDP_VIDEOWALLPAPER_NAMESPACE::TraceScope VW_TRACE_CONCAT(__vwTraceScope, __LINE__)(name)
+
+#define VW_TRACE_INSTANT(name)                                            \
+    do {                                                                  \
+        if (DDP_VIDEOWALLPAPER_NAMESPACE::Tracer::isEnabled())            \
+            DDP_VIDEOWALLPAPER_NAMESPACE::Tracer::instance()->instant(name); \
+    } while (0)
+
+#endif // TRACER_H
@@ -8,6 +8,11 @@
         <source>Video wallpaper</source>
         <translation type="unfinished"></translation>
     </message>
+    <message>
+        <location filename="../videowallpapermenuscene.cpp" line="38"/>
+        <source>Choose video</source>
+        <translation type="unfinished"></translation>
+    </message>
 </context>
 <context>
     <name>ddplugin_videowallpaper::WallpaperEngine</name>
@@ -8,6 +8,11 @@
         <source>Video wallpaper</source>
         <translation>视频壁纸</translation>
     </message>
+    <message>
+        <location filename="../videowallpapermenuscene.cpp" line="38"/>
+        <source>Choose video</source>
+        <translation>选择视频</translation>
+    </message>
 </context>
 <context>
     <name>ddplugin_videowallpaper::WallpaperEngine</name>
@@ -3,84 +3,278 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "videoproxy.h"
+#include "framelayer.h"
+#include "tracer.h"
+#include "lifecyclestats.h"
+#include "frameconverter.h"
 
-#ifdef USE_LIBMPV
-#include <DPlatformWindowHandle>
+#include <dfm-base/dfm_desktop_defines.h>
 
 #include <third_party/mpvwidget.h>
 
-#include <QEvent>
 #include <QLayout>
-#else
 #include <QPainter>
-#endif
 
 using namespace ddplugin_videowallpaper;
 
-#ifdef USE_LIBMPV
 VideoProxy::VideoProxy(QWidget *parent)
     : QWidget(parent)
-    , widget(new MpvWidget(this, Qt::FramelessWindowHint))
+    , layer(new FrameLayer(this))
 {
+    LifecycleStats::track(this, LifecycleStats::kVideoProxy);
     initUI();
 }
 
+VideoProxy::~VideoProxy()
+{
+}
+
 void VideoProxy::command(const QVariant &params)
 {
-    widget->command(params);
+    if (widget)
+        widget->command(params);
 }
 
-void VideoProxy::initUI()
+void VideoProxy::setMpvProperty(const QString &name, const QVariant &value)
 {
-    QVBoxLayout *layout = new QVBoxLayout(this);
-    layout->setContentsMargins(0, 0, 0, 0);
-    layout->addWidget(widget);
+    if (widget)
+        widget->setProperty(name, value);
 }
-#else
-VideoProxy::VideoProxy(QWidget *parent)
-    : QWidget(parent)
+
+QVariant VideoProxy::mpvProperty(const QString &name) const
+{
+    return widget ? widget->getProperty(name) : QVariant();
+}
+
+void VideoProxy::setFrameMode(bool frame)
+{
+    if (frames == frame)
+        return;
+
+    frames = frame;
+    if (frames) {
+        // the decoder of this screen is not needed any more.
+        delete widget;
+        widget = nullptr;
+        layer->show();
+    } else {
+        image = QImage();
+        layer->hide();
+
+        // only the mpv backend decodes per screen, create its player on demand.
+        widget = new MpvWidget(this, Qt::FramelessWindowHint);
+        LifecycleStats::track(widget, LifecycleStats::kMpvContext);
+        if (Tracer::isEnabled()) {
+            connect(widget, &MpvWidget::frameSwapped, this, &VideoProxy::tracePresent);
+        }
+        seam = SeamMeter();
+        lastPosition = -1;
+        connect(widget, &MpvWidget::frameSwapped, this, [this]() {
+            seam.frame();
+        });
+        connect(widget, &MpvWidget::positionChanged, this, [this](int pos) {
+            if (pos < lastPosition) {
+                seam.wrap();
+            }
+            lastPosition = pos;
+        });
+        layout()->addWidget(widget);
+        widget->show();
+    }
+}
+
+bool VideoProxy::frameMode() const
+{
+    return frames;
+}
+
+void VideoProxy::initUI()
 {
     auto pal = palette();
     pal.setColor(backgroundRole(), Qt::black);
     setPalette(pal);
     setAutoFillBackground(false);
+
+    // only one of the layer and the mpv widget exists at a time.
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(layer);
 }
 
-VideoProxy::~VideoProxy()
+void VideoProxy::present()
 {
+    // never update() the proxy itself, that repaints the canvas above it.
+    if (layer->isVisible()) {
+        bytesPresented += image.sizeInBytes();
+        layer->update();
+    }
 }
 
 void VideoProxy::updateImage(const QImage &img)
 {
-    image = img.scaled(img.size().boundedTo(QSize(1920, 1280)) * devicePixelRatioF(),
-                       Qt::KeepAspectRatio, Qt::FastTransformation);
-    image.setDevicePixelRatio(devicePixelRatioF());
-    update();
+    if (spanDesktop.isValid()) {
+        // the frame is shared by all screens and has already been scaled
+        // to the desktop, only keep a reference to it.
+        image = img;
+        present();
+        return;
+    }
+
+    const qreal ratio = devicePixelRatioF() * renderScale;
+    if (qFuzzyCompare(img.devicePixelRatio(), ratio)
+        && img.width() <= 1920 * ratio && img.height() <= 1280 * ratio
+        && img.depth() <= FrameConverter::depth(pixelFormat)) {
+        // already scaled by the source for this ratio, share it.
+        image = img;
+        present();
+        return;
+    }
+
+    const QSize target = img.size().scaled(img.size().boundedTo(QSize(1920, 1280)) * ratio,
+                                           Qt::KeepAspectRatio);
+    if (target.isEmpty()) {
+        return;
+    }
+
+    // scale into the reused buffer rather than allocating a new image per frame.
+    reserveImage(target, ratio);
+    QPainter painter(&image);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(QRectF(QPointF(0, 0), QSizeF(target) / ratio), img);
+    painter.end();
+
+    present();
 }
 
 void VideoProxy::clear()
 {
     image.fill(palette().window().color());
-    update();
+    present();
 }
 
-void VideoProxy::paintEvent(QPaintEvent *e)
+void VideoProxy::tracePresent()
 {
-    QPainter painter(this);
-    painter.fillRect(rect(), palette().window());
+    if (presented) {
+        return;
+    }
+
+    presented = true;
+    VW_TRACE_INSTANT("first present " + property(DFMBASE_NAMESPACE::DesktopFrameProperty::kPropScreenName).toString());
+}
+
+int VideoProxy::bufferAllocations() const
+{
+    return allocations;
+}
+
+void VideoProxy::trimBuffer()
+{
+    if (canvas.isNull() || image.constBits() != canvas.constBits() || canvas.size() == image.size()) {
+        return;
+    }
+
+    // the next larger frame allocates the headroom again.
+    const qreal ratio = image.devicePixelRatio();
+    canvas = image.copy();
+    image = QImage(canvas.bits(), canvas.width(), canvas.height(), canvas.bytesPerLine(), canvas.format());
+    image.setDevicePixelRatio(ratio);
+    ++allocations;
+}
+
+void VideoProxy::reserveImage(const QSize &size, qreal ratio)
+{
+    if (image.size() == size && image.constBits() == canvas.constBits()) {
+        if (!qFuzzyCompare(image.devicePixelRatio(), ratio))
+            image.setDevicePixelRatio(ratio);
+        return;
+    }
+
+    if (canvas.width() < size.width() || canvas.height() < size.height() || canvas.format() != pixelFormat) {
+        // leave some headroom, so that small changes of geometry or scale
+        // do not need a new buffer.
+        const QSize capacity(((size.width() * 9 / 8) + 63) & ~63,
+                             ((size.height() * 9 / 8) + 63) & ~63);
+        canvas = QImage(capacity, pixelFormat);
+        ++allocations;
+    }
+
+    image = QImage(canvas.bits(), size.width(), size.height(), canvas.bytesPerLine(), canvas.format());
+    image.setDevicePixelRatio(ratio);
+}
+
+void VideoProxy::setSpanGeometry(const QRect &screen, const QRect &desktop)
+{
+    if (spanScreen == screen && spanDesktop == desktop)
+        return;
+
+    spanScreen = screen;
+    spanDesktop = desktop;
+    present();
+}
+
+void VideoProxy::setRenderScale(qreal scale)
+{
+    renderScale = scale;
+}
+
+void VideoProxy::setPixelFormat(QImage::Format format)
+{
+    // the canvas is replaced by the next frame.
+    pixelFormat = format;
+}
+
+qint64 VideoProxy::presentedBytes() const
+{
+    return bytesPresented;
+}
+
+QVariantMap VideoProxy::seamStats() const
+{
+    return seam.stats();
+}
+
+void VideoProxy::clearSpanGeometry()
+{
+    setSpanGeometry(QRect(), QRect());
+}
+
+void VideoProxy::paintFrame(QPainter *painter)
+{
+    painter->fillRect(rect(), palette().window());
 
     if (image.isNull()) {
         return;
     }
 
-    QSize tar = image.size() / devicePixelRatioF();
+    if (spanDesktop.isValid()) {
+        // the frame covers the desktop and is centered on it.
+        const qreal ratio = image.devicePixelRatio();
+        const QSizeF desktop = QSizeF(spanDesktop.size()) * ratio;
+        const QPointF offset((image.width() - desktop.width()) / 2.0,
+                             (image.height() - desktop.height()) / 2.0);
+        const QRectF source(QPointF(spanScreen.topLeft() - spanDesktop.topLeft()) * ratio + offset,
+                            QSizeF(spanScreen.size()) * ratio);
+
+        // the texture is made of the image drawn, so only this screen's part
+        // of the desktop is uploaded: a view on the same pixels, no copy.
+        const QRect part = source.toAlignedRect() & image.rect();
+        if (part.isEmpty()) {
+            return;
+        }
+        const QImage view(image.constBits() + part.y() * image.bytesPerLine() + part.x() * (image.depth() / 8),
+                          part.width(), part.height(), image.bytesPerLine(), image.format());
+        painter->drawImage(QRectF(rect()), view, source.translated(-part.topLeft()));
+        tracePresent();
+        return;
+    }
+
+    // scaled up by the texture if the frame was rendered smaller.
+    QSize tar = image.size() / image.devicePixelRatio();
     int x = (rect().width() - tar.width()) / 2.0;
     int y = (rect().height() - tar.height()) / 2.0;
     // x = x < 0 ? 0 : x;
     // y = y < 0 ? 0 : y;
 
-    painter.drawImage(x, y, image);
-
-    QWidget::paintEvent(e);
+    painter->drawImage(x, y, image);
+    tracePresent();
 }
-#endif
@@ -6,50 +6,77 @@
 #define VIDEOPROXY_H
 
 #include "ddplugin_videowallpaper_global.h"
+#include "seammeter.h"
 
 #include <QWidget>
+#include <QImage>
 
-#ifdef USE_LIBMPV
+class QPainter;
 class MpvWidget;
-#endif
 
 DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
 
-#ifdef USE_LIBMPV
+class FrameLayer;
 class VideoProxy : public QWidget
 {
     Q_OBJECT
 
 public:
-    VideoProxy(QWidget *parent = nullptr);
+    explicit VideoProxy(QWidget *parent = nullptr);
+    ~VideoProxy();
 
+    // only valid out of frame mode, each screen decodes by itself then
     void command(const QVariant &params);
+    void setMpvProperty(const QString &name, const QVariant &value);
+    QVariant mpvProperty(const QString &name) const;
 
-private:
-    void initUI();
-
-private:
-    MpvWidget *widget = nullptr;
-};
-#else
-class VideoProxy : public QWidget
-{
-    Q_OBJECT
-
-public:
-    explicit VideoProxy(QWidget *parent = nullptr);
-    ~VideoProxy();
+    // show frames pushed by updateImage instead of decoding by itself
+    void setFrameMode(bool frame);
+    bool frameMode() const;
 
     void updateImage(const QImage &img);
     void clear();
+    int bufferAllocations() const;
+    // give back the headroom of the frame buffer
+    void trimBuffer();
+
+    // crop this screen out of a frame covering the whole desktop
+    void setSpanGeometry(const QRect &screen, const QRect &desktop);
+    void clearSpanGeometry();
+
+    // pushed frames are kept at this share of the screen resolution
+    void setRenderScale(qreal scale);
+    // of the buffer pushed frames are scaled into, deeper frames are converted
+    void setPixelFormat(QImage::Format format);
+    // bytes of the frames handed to the layer, to compare pixel formats
+    qint64 presentedBytes() const;
+    // frame time at the loop point of the own decoder
+    QVariantMap seamStats() const;
 
-protected:
-    void paintEvent(QPaintEvent *) override;
+private:
+    friend class FrameLayer;
+    void paintFrame(QPainter *painter);
+    void present();
+    void reserveImage(const QSize &size, qreal ratio);
+    void tracePresent();
+    void initUI();
 
 private:
+    MpvWidget *widget = nullptr;
+    bool frames = true;
+    FrameLayer *layer = nullptr;
     QImage image;
+    QImage canvas; // backing store of image in fill mode, with headroom
+    int allocations = 0;
+    bool presented = false;
+    QRect spanScreen;
+    QRect spanDesktop;
+    qreal renderScale = 1.0;
+    QImage::Format pixelFormat = QImage::Format_RGB32;
+    qint64 bytesPresented = 0;
+    SeamMeter seam;
+    int lastPosition = -1; // s
 };
-#endif
 
 typedef QSharedPointer<VideoProxy> VideoProxyPointer;
 
@@ -0,0 +1,75 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "videowallpaperdbus.h"
+#include "wallpaperengine.h"
+
+#include <QDBusConnection>
+#include <QDBusError>
+#include <QUrl>
+
+using namespace ddplugin_videowallpaper;
+
+static QUrl toUrl(const QString &file)
+{
+    return file.isEmpty() ? QUrl() : QUrl::fromUserInput(file, QString(), QUrl::AssumeLocalFile);
+}
+
+VideoWallpaperDBus::VideoWallpaperDBus(WallpaperEngine *e)
+    : QObject(e)
+    , engine(e)
+{
+}
+
+bool VideoWallpaperDBus::registerObject()
+{
+    // the desktop owns the bus name, only the object is ours.
+    if (!QDBusConnection::sessionBus().registerObject(VideoWallpaperDBusName::kPath, this,
+                                                      QDBusConnection::ExportAllSlots)) {
+        fmWarning() << "can not register" << VideoWallpaperDBusName::kPath
+                    << QDBusConnection::sessionBus().lastError().message();
+        return false;
+    }
+    return true;
+}
+
+void VideoWallpaperDBus::unregisterObject()
+{
+    QDBusConnection::sessionBus().unregisterObject(VideoWallpaperDBusName::kPath);
+}
+
+void VideoWallpaperDBus::Pause()
+{
+    engine->setPaused(true);
+}
+
+void VideoWallpaperDBus::Resume()
+{
+    engine->setPaused(false);
+}
+
+bool VideoWallpaperDBus::Next()
+{
+    return engine->next();
+}
+
+bool VideoWallpaperDBus::SetFile(const QString &file)
+{
+    return engine->setFile(toUrl(file));
+}
+
+bool VideoWallpaperDBus::SetScreenFile(const QString &screen, const QString &file)
+{
+    return engine->setScreenFile(screen, toUrl(file));
+}
+
+bool VideoWallpaperDBus::SetQualityLevel(const QString &level)
+{
+    return engine->setQualityLevel(level);
+}
+
+QVariantMap VideoWallpaperDBus::Stats() const
+{
+    return engine->stats();
+}
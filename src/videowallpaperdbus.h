@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef VIDEOWALLPAPERDBUS_H
+#define VIDEOWALLPAPERDBUS_H
+
+#include "ddplugin_videowallpaper_global.h"
+
+#include <QObject>
+#include <QVariantMap>
+
+DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
+
+namespace VideoWallpaperDBusName {
+inline constexpr char kPath[] = "/org/deepin/dde/desktop/VideoWallpaper";
+inline constexpr char kInterface[] = "org.deepin.dde.desktop.VideoWallpaper";
+}
+
+class WallpaperEngine;
+
+/**
+ * Playback control on the session bus, within the desktop process.
+ *
+ * Every call is applied to the running players, unlike the "enable"
+ * config key it never tears the engine down.
+ */
+class VideoWallpaperDBus : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.deepin.dde.desktop.VideoWallpaper")
+
+public:
+    explicit VideoWallpaperDBus(WallpaperEngine *engine);
+    bool registerObject();
+    void unregisterObject();
+
+public slots:
+    void Pause();
+    void Resume();
+    bool Next();
+    bool SetFile(const QString &file);
+    // an empty file to play the common one again
+    bool SetScreenFile(const QString &screen, const QString &file);
+    // full, reduced, low or paused
+    bool SetQualityLevel(const QString &level);
+    QVariantMap Stats() const;
+
+private:
+    WallpaperEngine *engine = nullptr;
+};
+
+DDP_VIDEOWALLPAPER_END_NAMESPACE
+
+#endif // VIDEOWALLPAPERDBUS_H
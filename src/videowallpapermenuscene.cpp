@@ -5,25 +5,38 @@
 #include "ddplugin_videowallpaper_global.h"
 #include "videowallpapermenuscene.h"
 #include "wallpaperconfig.h"
+#include "wallpaperengine.h"
+#include "thumbnailcache.h"
 
 #include "dfm-base/dfm_menu_defines.h"
 
 #include <QVariantHash>
+#include <QActionGroup>
+#include <QFileInfo>
+#include <QIcon>
 #include <QMenu>
+#include <QPixmap>
 #include <QDebug>
 
 using namespace ddplugin_videowallpaper;
 DFMBASE_USE_NAMESPACE
 
+VideoWallpaerMenuCreator::VideoWallpaerMenuCreator(WallpaperEngine *e)
+    : engine(e)
+{
+}
+
 AbstractMenuScene *VideoWallpaerMenuCreator::create()
 {
-    return new VideoWallpaperMenuScene();
+    return new VideoWallpaperMenuScene(engine);
 }
 
-VideoWallpaperMenuScene::VideoWallpaperMenuScene(QObject *parent)
+VideoWallpaperMenuScene::VideoWallpaperMenuScene(WallpaperEngine *e, QObject *parent)
     : AbstractMenuScene(parent)
+    , engine(e)
 {
     predicateName[ActionID::kVideoWallpaper] = tr("Video wallpaper");
+    predicateName[ActionID::kVideoPicker] = tr("Choose video");
 }
 
 QString VideoWallpaperMenuScene::name() const
@@ -36,6 +49,10 @@ bool VideoWallpaperMenuScene::initialize(const QVariantHash &params)
     turnOn = WpCfg->enable();
     isEmptyArea = params.value(MenuParamKey::kIsEmptyArea).toBool();
     onDesktop = params.value(MenuParamKey::kOnDesktop).toBool();
+    if (engine) {
+        videos = engine->videos();
+        current = engine->currentVideo();
+    }
 
     return isEmptyArea && onDesktop;
 }
@@ -59,9 +76,52 @@ bool VideoWallpaperMenuScene::create(QMenu *parent)
     tempAction->setCheckable(true);
     tempAction->setChecked(turnOn);
 
+    if (!videos.isEmpty()) {
+        QMenu *picker = createPicker(parent);
+        QAction *pickerAction = picker->menuAction();
+        pickerAction->setText(predicateName.value(ActionID::kVideoPicker));
+        pickerAction->setProperty(ActionPropertyKey::kActionID, QString(ActionID::kVideoPicker));
+        predicateAction[ActionID::kVideoPicker] = pickerAction;
+    }
+
     return true;
 }
 
+QMenu *VideoWallpaperMenuScene::createPicker(QMenu *parent)
+{
+    QMenu *picker = new QMenu(parent);
+    QActionGroup *group = new QActionGroup(picker);
+    const QIcon placeholder = QIcon::fromTheme("video-x-generic");
+    for (const QUrl &url : videos) {
+        const QString file = url.isLocalFile() ? url.toLocalFile() : QString();
+        QAction *action = picker->addAction(file.isEmpty() ? url.toString() : QFileInfo(file).fileName());
+        action->setProperty(ActionPropertyKey::kActionID, QString(ActionID::kVideoClip));
+        action->setData(url);
+        action->setCheckable(true);
+        action->setChecked(turnOn && url == current);
+        group->addAction(action);
+        predicateAction.insert(QString(ActionID::kVideoClip) + url.toString(), action);
+
+        // the menu must open at once, thumbnails not made yet show up when ready.
+        const QImage thumbnail = file.isEmpty() ? QImage() : ThumbnailCache::instance()->thumbnail(file);
+        if (!thumbnail.isNull()) {
+            action->setIcon(QIcon(QPixmap::fromImage(thumbnail)));
+            continue;
+        }
+
+        action->setIcon(placeholder);
+        if (!file.isEmpty()) {
+            connect(ThumbnailCache::instance(), &ThumbnailCache::thumbnailReady, action,
+                    [action, file](const QString &ready, const QImage &image) {
+                        if (ready == file)
+                            action->setIcon(QIcon(QPixmap::fromImage(image)));
+                    });
+        }
+    }
+
+    return picker;
+}
+
 void VideoWallpaperMenuScene::updateState(QMenu *parent)
 {
     auto actions = parent->actions();
@@ -77,6 +137,8 @@ void VideoWallpaperMenuScene::updateState(QMenu *parent)
 
     QAction *indexAction = *actionIter;
     parent->insertAction(indexAction, predicateAction[ActionID::kVideoWallpaper]);
+    if (QAction *picker = predicateAction.value(ActionID::kVideoPicker))
+        parent->insertAction(indexAction, picker);
 
     AbstractMenuScene::updateState(parent);
 }
@@ -87,6 +149,11 @@ bool VideoWallpaperMenuScene::triggered(QAction *action)
     if (predicateAction.values().contains(action)) {
         if (actionId == ActionID::kVideoWallpaper) {
             emit WpCfg->changeEnableState(action->isChecked());
+        } else if (actionId == ActionID::kVideoClip) {
+            // the running players switch to it, nothing is torn down.
+            WpCfg->setSource(action->data().toUrl().toString());
+            if (!WpCfg->enable())
+                emit WpCfg->changeEnableState(true);
         }
         return true;
     }
@@ -10,23 +10,33 @@
 #include "dfm-base/interfaces/abstractscenecreator.h"
 
 #include <QMap>
+#include <QPointer>
+#include <QUrl>
 
 DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
 
 namespace ActionID {
 inline constexpr char kVideoWallpaper[] = "video-wallpaper";
+inline constexpr char kVideoPicker[] = "video-wallpaper-picker";
+inline constexpr char kVideoClip[] = "video-wallpaper-clip";
 }
 
+class WallpaperEngine;
+
 class VideoWallpaerMenuCreator : public DFMBASE_NAMESPACE::AbstractSceneCreator
 {
     Q_OBJECT
 
 public:
+    explicit VideoWallpaerMenuCreator(WallpaperEngine *engine);
     static QString name()
     {
         return "VideoWallpaperMenu";
     }
     DFMBASE_NAMESPACE::AbstractMenuScene *create() override;
+
+private:
+    QPointer<WallpaperEngine> engine;
 };
 
 class VideoWallpaperMenuScene : public DFMBASE_NAMESPACE::AbstractMenuScene
@@ -34,7 +44,7 @@ class VideoWallpaperMenuScene : public DFMBASE_NAMESPACE::AbstractMenuScene
     Q_OBJECT
 
 public:
-    explicit VideoWallpaperMenuScene(QObject *parent = nullptr);
+    explicit VideoWallpaperMenuScene(WallpaperEngine *engine, QObject *parent = nullptr);
     QString name() const override;
     bool initialize(const QVariantHash &params) override;
     AbstractMenuScene *scene(QAction *action) const override;
@@ -43,6 +53,12 @@ public:
     bool triggered(QAction *action) override;
 
 private:
+    QMenu *createPicker(QMenu *parent);
+
+private:
+    QPointer<WallpaperEngine> engine;
+    QList<QUrl> videos;
+    QUrl current;
     bool turnOn = false;
     bool onDesktop = false;
     bool isEmptyArea = false;
@@ -4,6 +4,7 @@
 
 #include "videowallpaperplugin.h"
 #include "wallpaperengine.h"
+#include "tracer.h"
 
 #include <QTranslator>
 
@@ -20,10 +21,8 @@ VideoWallpaperPlugin::VideoWallpaperPlugin(QObject *parent)
 
 void ddplugin_videowallpaper::VideoWallpaperPlugin::initialize()
 {
-#ifdef USE_LIBMPV
     // for libmpv
     setlocale(LC_NUMERIC, "C");
-#endif
 
     // load translation
     auto trans = new QTranslator(this);
@@ -36,6 +35,9 @@ void ddplugin_videowallpaper::VideoWallpaperPlugin::initialize()
 
 bool VideoWallpaperPlugin::start()
 {
+    // a scope entered before the trace file is known is lost.
+    WallpaperEngine::loadConfig();
+    VW_TRACE_SCOPE("VideoWallpaperPlugin::start");
     engine = new WallpaperEngine();
     return engine->init();
 }
@@ -44,4 +46,7 @@ void VideoWallpaperPlugin::stop()
 {
     delete engine;
     engine = nullptr;
+
+    if (Tracer::isEnabled())
+        Tracer::instance()->flush();
 }
@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "wallpaperconfig_p.h"
+#include "playbackbackend.h"
 
 #include <QApplication>
 #include <QFileInfo>
@@ -22,40 +23,231 @@ class WallpaperConfigGlobal : public WallpaperConfig
 Q_GLOBAL_STATIC(WallpaperConfigGlobal, wallpaperConfig)
 
 static constexpr char kConfName[] = "org.deepin.dde.file-manager.desktop.videowallpaper";
-static constexpr char kKeyEnable[] = "enable";
+static constexpr qint64 kMiB = 1024 * 1024;
+static bool detached = false;
 
 WallpaperConfigPrivate::WallpaperConfigPrivate(WallpaperConfig *qq)
     : q(qq)
 {
 }
 
-bool WallpaperConfigPrivate::getEnable() const
+const QList<SettingSpec> &WallpaperConfigPrivate::schema()
 {
-    bool ret = false;
-    if (settings)
-        ret = settings->value(kKeyEnable, false).toBool();
+    using namespace SettingKey;
+    static const QList<SettingSpec> specs {
+        { kEnable, QMetaType::Bool, false, {}, {}, {} },
+        { kLayout, QMetaType::QString, QString(LayoutMode::kFill), {}, {}, { LayoutMode::kFill, LayoutMode::kSpan } },
+        { kSource, QMetaType::QString, QString(), {}, {}, {} },
+        { kMute, QMetaType::Bool, false, {}, {}, {} },
+        { kBackend, QMetaType::QString, QString(BackendName::kAuto), {}, {},
+          { BackendName::kAuto, BackendName::kMpv, BackendName::kMultimedia } },
+        { kTraceFile, QMetaType::QString, QString(), {}, {}, {} },
+        { kDecoder, QMetaType::QString, QString(DecoderMode::kInProcess), {}, {},
+          { DecoderMode::kInProcess, DecoderMode::kHelper, DecoderMode::kHost } },
+        { kDecoderMemoryMax, QMetaType::QString, QString(), {}, {}, {} },
+        { kDecoderCPUQuota, QMetaType::QString, QString(), {}, {}, {} },
+        { kPixelFormat, QMetaType::QString, QString(PixelFormat::kRgb32), {}, {},
+          { PixelFormat::kRgb32, PixelFormat::kRgb16, PixelFormat::kRgb888 } },
+        { kSourceCacheQuota, QMetaType::Int, 2048, 1, 1024 * 1024, {} }, // MiB
+        { kSeamlessLoop, QMetaType::Bool, false, {}, {}, {} },
+        { kHwdec, QMetaType::QString, QString("auto"), {}, {},
+          { "auto", "auto-safe", "no", "vaapi", "vdpau", "nvdec", "cuda", "drm" } },
+        { kMaxFps, QMetaType::Int, 0, 0, 240, {} },
+        { kRenderScale, QMetaType::Double, 1.0, 0.25, 1.0, {} },
+        { kDemuxerMaxBytes, QMetaType::Int, 150, 1, 1024, {} }, // MiB
+        { kDemuxerBackBytes, QMetaType::Int, 50, 0, 1024, {} }, // MiB
+        { kLoadHighThreshold, QMetaType::Double, 0.85, 0.1, 1.0, {} },
+        { kLoadLowThreshold, QMetaType::Double, 0.5, 0.0, 1.0, {} },
+        { kThermalHeadroom, QMetaType::Double, 10.0, 0.0, 30.0, {} },
+    };
+    return specs;
+}
+
+const SettingSpec *WallpaperConfigPrivate::spec(const QString &key)
+{
+    for (const SettingSpec &s : schema()) {
+        if (key == s.key)
+            return &s;
+    }
+    return nullptr;
+}
+
+QVariant WallpaperConfigPrivate::read(const SettingSpec &spec) const
+{
+    if (!settings)
+        return spec.fallback;
+
+    const QVariant raw = settings->value(spec.key, spec.fallback);
+    QVariant ret = raw;
+    bool ok = ret.convert(QMetaType(spec.type));
+    if (ok && spec.min.isValid())
+        ok = ret.toDouble() >= spec.min.toDouble() && ret.toDouble() <= spec.max.toDouble();
+    if (ok && !spec.choices.isEmpty())
+        ok = spec.choices.contains(ret.toString());
+
+    if (!ok) {
+        fmWarning() << "invalid value" << raw << "of" << spec.key << ", use" << spec.fallback;
+        return spec.fallback;
+    }
     return ret;
 }
 
+QVariant WallpaperConfigPrivate::get(const char *key) const
+{
+    auto itor = values.constFind(key);
+    if (itor != values.constEnd())
+        return itor.value();
+
+    // not initialized yet
+    const SettingSpec *s = spec(key);
+    return s ? read(*s) : QVariant();
+}
+
 WallpaperConfig *WallpaperConfig::instance()
 {
     return wallpaperConfig;
 }
 
+void WallpaperConfig::useDefaults()
+{
+    Q_ASSERT(!wallpaperConfig.exists());
+    detached = true;
+}
+
 bool WallpaperConfig::enable() const
 {
-    return d->enable;
+    return d->get(SettingKey::kEnable).toBool();
 }
 
 void WallpaperConfig::setEnable(bool e)
 {
-    if (d->enable == e)
+    if (enable() == e)
+        return;
+
+    d->values.insert(SettingKey::kEnable, e);
+
+    if (d->settings && d->read(*d->spec(SettingKey::kEnable)).toBool() != e)
+        d->settings->setValue(SettingKey::kEnable, e);
+}
+
+QString WallpaperConfig::layout() const
+{
+    return d->get(SettingKey::kLayout).toString();
+}
+
+QString WallpaperConfig::source() const
+{
+    return d->get(SettingKey::kSource).toString();
+}
+
+void WallpaperConfig::setSource(const QString &s)
+{
+    if (source() == s)
         return;
 
-    d->enable = e;
+    d->values.insert(SettingKey::kSource, s);
+    if (d->settings && d->read(*d->spec(SettingKey::kSource)).toString() != s)
+        d->settings->setValue(SettingKey::kSource, s);
+
+    emit changeSource(s);
+}
+
+bool WallpaperConfig::mute() const
+{
+    return d->get(SettingKey::kMute).toBool();
+}
+
+QString WallpaperConfig::backend() const
+{
+    return d->get(SettingKey::kBackend).toString();
+}
+
+QString WallpaperConfig::traceFile() const
+{
+    return d->get(SettingKey::kTraceFile).toString();
+}
+
+QString WallpaperConfig::decoder() const
+{
+    return d->get(SettingKey::kDecoder).toString();
+}
+
+QString WallpaperConfig::decoderMemoryMax() const
+{
+    return d->get(SettingKey::kDecoderMemoryMax).toString();
+}
+
+QString WallpaperConfig::decoderCPUQuota() const
+{
+    return d->get(SettingKey::kDecoderCPUQuota).toString();
+}
+
+QString WallpaperConfig::pixelFormat() const
+{
+    return d->get(SettingKey::kPixelFormat).toString();
+}
+
+qint64 WallpaperConfig::sourceCacheQuota() const
+{
+    return d->get(SettingKey::kSourceCacheQuota).toLongLong() * kMiB;
+}
+
+bool WallpaperConfig::seamlessLoop() const
+{
+    return d->get(SettingKey::kSeamlessLoop).toBool();
+}
+
+QString WallpaperConfig::hwdec() const
+{
+    return d->get(SettingKey::kHwdec).toString();
+}
+
+int WallpaperConfig::maxFps() const
+{
+    return d->get(SettingKey::kMaxFps).toInt();
+}
+
+qreal WallpaperConfig::renderScale() const
+{
+    return d->get(SettingKey::kRenderScale).toDouble();
+}
+
+qint64 WallpaperConfig::demuxerMaxBytes() const
+{
+    return d->get(SettingKey::kDemuxerMaxBytes).toLongLong() * kMiB;
+}
+
+qint64 WallpaperConfig::demuxerBackBytes() const
+{
+    return d->get(SettingKey::kDemuxerBackBytes).toLongLong() * kMiB;
+}
+
+qreal WallpaperConfig::loadHighThreshold() const
+{
+    return d->get(SettingKey::kLoadHighThreshold).toDouble();
+}
+
+qreal WallpaperConfig::loadLowThreshold() const
+{
+    return d->get(SettingKey::kLoadLowThreshold).toDouble();
+}
+
+qreal WallpaperConfig::thermalHeadroom() const
+{
+    return d->get(SettingKey::kThermalHeadroom).toDouble();
+}
+
+QVariant WallpaperConfig::value(const QString &key) const
+{
+    return d->get(key.toLatin1().constData());
+}
 
-    if (d->settings && d->getEnable() != e)
-        d->settings->setValue(kKeyEnable, e);
+QStringList WallpaperConfig::keys()
+{
+    QStringList ret;
+    for (const SettingSpec &s : WallpaperConfigPrivate::schema())
+        ret << s.key;
+    return ret;
 }
 
 WallpaperConfig::WallpaperConfig(QObject *parent)
@@ -64,6 +256,9 @@ WallpaperConfig::WallpaperConfig(QObject *parent)
 {
     // 只能在主线程创建
     Q_ASSERT(qApp->thread() == thread());
+    if (detached)
+        return;
+
     d->settings = DConfig::create("org.deepin.dde.file-manager", kConfName, "", this);
     if (!d->settings)
         qCritical() << "can not create dconfig for" << kConfName;
@@ -71,7 +266,9 @@ WallpaperConfig::WallpaperConfig(QObject *parent)
 
 void WallpaperConfig::initialize()
 {
-    d->enable = d->getEnable();
+    for (const SettingSpec &s : WallpaperConfigPrivate::schema())
+        d->values.insert(s.key, d->read(s));
+
     if (d->settings)
         connect(d->settings, &DConfig::valueChanged,
                 this, &WallpaperConfig::configChanged, Qt::UniqueConnection);
@@ -79,9 +276,30 @@ void WallpaperConfig::initialize()
 
 void WallpaperConfig::configChanged(const QString &key)
 {
-    if (key == kKeyEnable) {
-        bool e = d->getEnable();
-        if (e != d->enable)
-            emit changeEnableState(e);
+    const SettingSpec *s = d->spec(key);
+    if (!s)
+        return;
+
+    const QVariant v = d->read(*s);
+    if (key == SettingKey::kEnable) {
+        // the engine applies it by setEnable.
+        if (v.toBool() != enable())
+            emit changeEnableState(v.toBool());
+        return;
     }
+
+    if (v == d->values.value(key))
+        return;
+
+    d->values.insert(key, v);
+    if (key == SettingKey::kLayout)
+        emit changeLayout(v.toString());
+    else if (key == SettingKey::kSource)
+        emit changeSource(v.toString());
+    else if (key == SettingKey::kMute)
+        emit changeMute(v.toBool());
+    else if (key == SettingKey::kBackend)
+        emit changeBackend(v.toString());
+    else
+        emit changeSetting(key, v);
 }
@@ -8,9 +8,50 @@
 #include "ddplugin_videowallpaper_global.h"
 
 #include <QObject>
+#include <QVariant>
 
 DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
 
+namespace SettingKey {
+inline constexpr char kEnable[] = "enable";
+inline constexpr char kLayout[] = "layout";
+inline constexpr char kSource[] = "source";
+inline constexpr char kMute[] = "mute";
+inline constexpr char kBackend[] = "backend";
+inline constexpr char kTraceFile[] = "traceFile";
+inline constexpr char kDecoder[] = "decoder";
+inline constexpr char kDecoderMemoryMax[] = "decoderMemoryMax";
+inline constexpr char kDecoderCPUQuota[] = "decoderCPUQuota";
+inline constexpr char kPixelFormat[] = "pixelFormat";
+inline constexpr char kSourceCacheQuota[] = "sourceCacheQuota";
+inline constexpr char kSeamlessLoop[] = "seamlessLoop";
+inline constexpr char kHwdec[] = "hwdec";
+inline constexpr char kMaxFps[] = "maxFps";
+inline constexpr char kRenderScale[] = "renderScale";
+inline constexpr char kDemuxerMaxBytes[] = "demuxerMaxBytes";
+inline constexpr char kDemuxerBackBytes[] = "demuxerBackBytes";
+inline constexpr char kLoadHighThreshold[] = "loadHighThreshold";
+inline constexpr char kLoadLowThreshold[] = "loadLowThreshold";
+inline constexpr char kThermalHeadroom[] = "thermalHeadroom";
+}
+
+namespace LayoutMode {
+inline constexpr char kFill[] = "fill"; // every screen shows the whole video
+inline constexpr char kSpan[] = "span"; // one video across all screens
+}
+
+namespace DecoderMode {
+inline constexpr char kInProcess[] = "inprocess"; // decode in the desktop
+inline constexpr char kHelper[] = "helper"; // decode in a separate process
+inline constexpr char kHost[] = "host"; // decode once for all sessions of the host
+}
+
+namespace PixelFormat {
+inline constexpr char kRgb32[] = "rgb32";
+inline constexpr char kRgb16[] = "rgb16"; // low memory bandwidth
+inline constexpr char kRgb888[] = "rgb888";
+}
+
 class WallpaperConfigPrivate;
 class WallpaperConfig : public QObject
 {
@@ -18,12 +59,45 @@ class WallpaperConfig : public QObject
 
 public:
     static WallpaperConfig *instance();
+    // before the first instance(), dconfig is then neither read nor written:
+    // the values are the defaults and what is set, for the tests
+    static void useDefaults();
     void initialize();
     bool enable() const;
     void setEnable(bool);
+    QString layout() const;
+    QString source() const;
+    void setSource(const QString &source);
+    bool mute() const;
+    QString backend() const;
+    QString traceFile() const;
+    QString decoder() const;
+    QString decoderMemoryMax() const;
+    QString decoderCPUQuota() const;
+    QString pixelFormat() const;
+    qint64 sourceCacheQuota() const; // bytes
+    bool seamlessLoop() const;
+    QString hwdec() const;
+    int maxFps() const; // 0 for no cap
+    qreal renderScale() const;
+    qint64 demuxerMaxBytes() const;
+    qint64 demuxerBackBytes() const;
+    qreal loadHighThreshold() const;
+    qreal loadLowThreshold() const;
+    qreal thermalHeadroom() const; // celsius
+
+    // validated against the schema, invalid values read as the default
+    QVariant value(const QString &key) const;
+    static QStringList keys();
 
 signals:
     void changeEnableState(bool enable);
+    void changeLayout(const QString &layout);
+    void changeSource(const QString &source);
+    void changeMute(bool mute);
+    void changeBackend(const QString &backend);
+    // any other key of the schema
+    void changeSetting(const QString &key, const QVariant &value);
 
 private slots:
     void configChanged(const QString &key);
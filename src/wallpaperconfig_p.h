@@ -10,16 +10,33 @@
 
 #include <DConfig>
 
+#include <QStringList>
+#include <QVariantMap>
+
 DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
 
+struct SettingSpec
+{
+    const char *key;
+    QMetaType::Type type;
+    QVariant fallback;
+    QVariant min; // numbers only, inclusive
+    QVariant max;
+    QStringList choices; // strings only, any if empty
+};
+
 class WallpaperConfigPrivate
 {
 public:
     WallpaperConfigPrivate(WallpaperConfig *qq);
-    bool getEnable() const;
+    static const QList<SettingSpec> &schema();
+    static const SettingSpec *spec(const QString &key);
+    // from dconfig, the default if it does not fit the spec
+    QVariant read(const SettingSpec &spec) const;
+    QVariant get(const char *key) const;
 
 private:
-    bool enable = false;
+    QVariantMap values; // validated, enable only changes by setEnable
     DTK_CORE_NAMESPACE::DConfig *settings = nullptr;
 
     friend class WallpaperConfig;
@@ -6,6 +6,13 @@
 #include "wallpaperengine_p.h"
 #include "wallpaperconfig.h"
 #include "videowallpapermenuscene.h"
+#include "tracer.h"
+#include "backendprobe.h"
+#include "mpvbackend.h"
+#include "multimediabackend.h"
+#include "lifecyclestats.h"
+#include "frameconverter.h"
+#include "desktophost.h"
 
 #include <dfm-base/dfm_desktop_defines.h>
 #include <dfm-base/utils/universalutils.h>
@@ -14,29 +21,20 @@
 #include <desktoputils/widgetutil.h>
 
 #include <DPlatformWindowHandle>
-#include <DNotifySender>
 
+#include <QCoreApplication>
 #include <QDir>
-#include <QStandardPaths>
-#ifndef USE_LIBMPV
-#ifdef ENABLE_AUDIO_OUTPUT
-#include <QAudioOutput>
-#include <QAudioDevice>
-#include <QMediaDevices>
-#endif
-#endif
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QWindow>
+#include <QScreen>
 
 #include <malloc.h>
 
 using namespace ddplugin_videowallpaper;
 DFMBASE_USE_NAMESPACE
 
-#define CanvasCoreSubscribe(topic, func) \
-    dpfSignalDispatcher->subscribe("ddplugin_core", QT_STRINGIFY2(topic), this, func);
-
-#define CanvasCoreUnsubscribe(topic, func) \
-    dpfSignalDispatcher->unsubscribe("ddplugin_core", QT_STRINGIFY2(topic), this, func);
+static constexpr int kSaveInterval = 5 * 60 * 1000; // ms, of the playback state
 
 static QString getScreenName(QWidget *win)
 {
@@ -46,7 +44,7 @@ static QString getScreenName(QWidget *win)
 
 static QMap<QString, QWidget *> rootMap()
 {
-    QList<QWidget *> root = ddplugin_desktop_util::desktopFrameRootWindows();
+    QList<QWidget *> root = DesktopHost::instance()->rootWindows();
     QMap<QString, QWidget *> ret;
     for (QWidget *win : root) {
         QString name = getScreenName(win);
@@ -64,19 +62,130 @@ WallpaperEnginePrivate::WallpaperEnginePrivate(WallpaperEngine *qq)
 {
 }
 
-QList<QUrl> WallpaperEnginePrivate::getVideos(const QString &path)
+void WallpaperEnginePrivate::attachWidget(const QString &screenName, QWidget *root)
 {
-    QList<QUrl> ret;
-    QDir dir(path);
-    for (const QFileInfo &file : dir.entryInfoList(QDir::Files)) {
-        ret << QUrl::fromLocalFile(file.absoluteFilePath());
+    VideoProxyPointer bwp = widgets.value(screenName);
+    if (bwp.isNull() && !parked.isEmpty()) {
+        // prefer the one used by this screen before, its decoder is still alive.
+        bwp = parked.take(parked.contains(screenName) ? screenName : parked.firstKey());
+        fmInfo() << "screen:" << screenName << "added, reuse parked widget.";
+        bwp->setMpvProperty("pause", isPaused());
     }
 
-    return ret;
+    if (bwp.isNull()) {
+        // add new widget
+        fmInfo() << "screen:" << screenName << "added, create it.";
+        widgets.insert(screenName, createWidget(root));
+        return;
+    }
+
+    // update widget
+    if (bwp->parentWidget() != root) {
+        // see createWidget
+        root->windowHandle()->setSurfaceType(QSurface::OpenGLSurface);
+        bwp->setParent(root);
+    }
+    bwp->setProperty(DesktopFrameProperty::kPropScreenName, screenName);
+    QRect geometry = relativeGeometry(root->geometry()); // scaled area
+    bwp->setGeometry(geometry);
+    widgets.insert(screenName, bwp);
+}
+
+void WallpaperEnginePrivate::parkInvalidWidgets(const QMap<QString, QWidget *> &winMap)
+{
+    for (const QString &sp : widgets.keys()) {
+        if (winMap.contains(sp)) {
+            continue;
+        }
+
+        auto videoProxy = widgets.take(sp);
+        videoProxy->hide();
+        videoProxy->setParent(parkingWindow());
+        // keep the decoder and its position, but stop wasting cpu on it.
+        videoProxy->setMpvProperty("pause", true);
+        parked.insert(sp, videoProxy);
+        fmInfo() << "remove screen:" << sp << ", park its widget.";
+    }
+
+    if (!parked.isEmpty()) {
+        parkTimer.start();
+    }
+}
+
+QWidget *WallpaperEnginePrivate::parkingWindow()
+{
+    if (holder) {
+        return holder;
+    }
+
+    // never shown, the native window is of the same surface type as the roots, see createWidget.
+    holder = new QWidget;
+    holder->setAttribute(Qt::WA_DontShowOnScreen);
+    holder->winId();
+    holder->windowHandle()->setSurfaceType(QSurface::OpenGLSurface);
+    if (!QCoreApplication::testAttribute(Qt::AA_ShareOpenGLContexts)) {
+        fmWarning() << "the desktop does not share OpenGL contexts, GL resources are recreated on reattach.";
+    }
+    return holder;
+}
+
+void WallpaperEnginePrivate::releaseParkingWindow()
+{
+    if (!holder) {
+        return;
+    }
+
+    // a widget still referenced elsewhere is deleted by its last owner, not by the holder.
+    for (QWidget *child : holder->findChildren<QWidget *>(QString(), Qt::FindDirectChildrenOnly)) {
+        child->setParent(nullptr);
+    }
+    delete holder;
+    holder = nullptr;
+}
+
+void WallpaperEnginePrivate::releaseParked()
+{
+    if (parked.isEmpty()) {
+        return;
+    }
+
+    fmInfo() << "release" << parked.size() << "parked widgets.";
+    parked.clear();
+    q->releaseMemory();
+}
+
+void WallpaperEnginePrivate::applyGeometry()
+{
+    VW_LIFECYCLE_SCOPE("applyGeometry");
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    auto winMap = rootMap();
+    for (auto itor = widgets.begin(); itor != widgets.end(); ++itor) {
+        VideoProxyPointer bw = itor.value();
+        auto *win = winMap.value(itor.key());
+        if (win == nullptr) {
+            fmCritical() << "can not get root " << itor.key();
+            continue;
+        }
+
+        QRect geometry = relativeGeometry(win->geometry()); // scaled area
+        if (bw.get() != nullptr && bw->geometry() != geometry) {
+            bw->setGeometry(geometry);
+        }
+    }
+
+    // screens might be rearranged, crop again.
+    updateSpan();
+
+    geometryStallTime = elapsed.nsecsElapsed() / 1000;
+    fmDebug() << "apply geometry for" << geometryRequests << "requests in" << geometryStallTime << "us";
+    geometryRequests = 0;
 }
 
 VideoProxyPointer WallpaperEnginePrivate::createWidget(QWidget *root)
 {
+    VW_TRACE_SCOPE("WallpaperEnginePrivate::createWidget");
     /**
      * NOTE: https://doc.qt.io/qt-6/qopenglwidget.html
      *
@@ -111,7 +220,7 @@ VideoProxyPointer WallpaperEnginePrivate::createWidget(QWidget *root)
 
 void WallpaperEnginePrivate::setBackgroundVisible(bool v)
 {
-    QList<QWidget *> roots = ddplugin_desktop_util::desktopFrameRootWindows();
+    QList<QWidget *> roots = DesktopHost::instance()->rootWindows();
     for (QWidget *root : roots) {
         for (QObject *obj : root->children()) {
             if (QWidget *wid = dynamic_cast<QWidget *>(obj)) {
@@ -126,8 +235,22 @@ void WallpaperEnginePrivate::setBackgroundVisible(bool v)
 
 QString WallpaperEnginePrivate::sourcePath() const
 {
-    QString path = QStandardPaths::standardLocations(QStandardPaths::MoviesLocation).first() + "/video-wallpaper";
-    return path;
+    return DesktopHost::instance()->wallpaperDirectory();
+}
+
+QUrl WallpaperEnginePrivate::currentVideo() const
+{
+    if (videos.isEmpty()) {
+        return QUrl();
+    }
+
+    // the chosen one might have been removed meanwhile, as the source cache
+    // tells off the gui thread.
+    const QUrl chosen(WpCfg->source());
+    if (videos.contains(chosen) || (chosen.isLocalFile() && !sources->isMissing(chosen))) {
+        return chosen;
+    }
+    return videos.constFirst();
 }
 
 void WallpaperEnginePrivate::clearWidgets()
@@ -136,34 +259,710 @@ void WallpaperEnginePrivate::clearWidgets()
         videoProxy.clear();
     }
     widgets.clear();
+
+    parkTimer.stop();
+    parked.clear();
+    releaseParkingWindow();
+}
+
+bool WallpaperEnginePrivate::spanMode() const
+{
+    return WpCfg->layout() == LayoutMode::kSpan;
+}
+
+bool WallpaperEnginePrivate::useDecoder() const
+{
+    if (decoderFailed) {
+        return false;
+    }
+
+    const QString mode = WpCfg->decoder();
+    return (mode == DecoderMode::kHelper && DecoderClient::isAvailable())
+            || (mode == DecoderMode::kHost && DecoderClient::isHostAvailable());
+}
+
+void WallpaperEnginePrivate::applyLayout()
+{
+    if (animated && !imageSource) {
+        // animated images are cheap to decode, no video decoder is needed.
+        imageSource = new AnimatedImageSource(q);
+        LifecycleStats::track(imageSource, LifecycleStats::kImageSource);
+        QObject::connect(imageSource, &AnimatedImageSource::frameReady, q, [this](const QImage &frame) {
+            for (const VideoProxyPointer &bwp : widgets.values()) {
+                bwp->updateImage(frame);
+            }
+        });
+    } else if (!animated && imageSource) {
+        delete imageSource;
+        imageSource = nullptr;
+    }
+
+    const bool helper = !animated && useDecoder();
+    if (helper && !decoder) {
+        decoder = new DecoderClient(WpCfg->decoder() == DecoderMode::kHost, q);
+        LifecycleStats::track(decoder, LifecycleStats::kDecoderClient);
+        if (decoder->start()) {
+            QObject::connect(decoder, &DecoderClient::frameReady, q, [this](const QImage &frame) {
+                for (const VideoProxyPointer &bwp : widgets.values()) {
+                    bwp->updateImage(frame);
+                }
+            });
+            QObject::connect(decoder, &DecoderClient::failed, q, [this]() {
+                fmWarning() << "fall back to decode in process.";
+                decoderFailed = true;
+                decoder->deleteLater();
+                decoder = nullptr;
+                if (WpCfg->enable() && !videos.isEmpty()) {
+                    startPlayers(true);
+                }
+            });
+        } else {
+            decoderFailed = true;
+            delete decoder;
+            decoder = nullptr;
+        }
+    } else if (!helper && decoder) {
+        delete decoder;
+        decoder = nullptr;
+    }
+
+    // frames of animated images and of the helper are pushed to all screens.
+    const bool pushed = animated || decoder;
+    if (backend) {
+        backend->setSpan(spanMode() && !pushed);
+        backend->setShared(memoryLevel >= MemoryPressureMonitor::kShared && !pushed);
+    }
+
+    const bool frame = pushed || !backend || backend->pushesFrames();
+    for (const VideoProxyPointer &bwp : widgets.values()) {
+        bwp->setFrameMode(frame);
+    }
+    updateSpan();
+}
+
+void WallpaperEnginePrivate::updateSpan()
+{
+    auto winMap = rootMap();
+    QRect desktop;
+    QSize largest;
+    qreal ratio = 1.0;
+    QMap<QString, qreal> refreshRates;
+    for (auto itor = winMap.begin(); itor != winMap.end(); ++itor) {
+        QWidget *win = itor.value();
+        desktop |= win->geometry();
+        largest = largest.expandedTo(win->geometry().size());
+        ratio = qMax(ratio, win->devicePixelRatioF());
+        if (QScreen *screen = win->screen()) {
+            refreshRates.insert(itor.key(), screen->refreshRate());
+        }
+    }
+
+    if (backend) {
+        backend->setRefreshRates(refreshRates);
+    }
+
+    // frames are rendered smaller under load, the screens scale them up.
+    const qreal scale = profile().renderScale;
+    const bool span = spanMode() && desktop.isValid();
+    for (auto itor = widgets.begin(); itor != widgets.end(); ++itor) {
+        QWidget *win = winMap.value(itor.key());
+        if (span && win)
+            itor.value()->setSpanGeometry(win->geometry(), desktop);
+        else
+            itor.value()->clearSpanGeometry();
+        itor.value()->setRenderScale(scale);
+    }
+
+    ratio *= scale;
+    spanFrame = span ? desktop.size() * ratio : QSize();
+    spanRatio = ratio;
+    if (imageSource)
+        imageSource->setTarget(spanFrame, spanRatio);
+    // in fill mode, the frame fits the largest screen and is shared by all.
+    if (!largest.isEmpty()) {
+        const QSize frame = span ? spanFrame : largest * ratio;
+        if (backend)
+            backend->setFrameSize(frame, ratio, span);
+        if (decoder)
+            decoder->setFrameSize(frame, ratio, span);
+    }
+}
+
+void WallpaperEnginePrivate::setBackend(const QString &name)
+{
+    if (backend && backend->name() == name) {
+        return;
+    }
+
+    VW_TRACE_SCOPE("WallpaperEnginePrivate::setBackend");
+    fmInfo() << "switch playback backend to" << name;
+    if (backend) {
+        backend->stop();
+        delete backend;
+    }
+
+    if (name == BackendName::kMultimedia) {
+        backend = new MultimediaBackend(q);
+    } else {
+        backend = new MpvBackend(q);
+    }
+
+    QObject::connect(backend, &PlaybackBackend::frameReady, q, [this](const QImage &frame) {
+        for (const VideoProxyPointer &bwp : widgets.values()) {
+            bwp->updateImage(frame);
+        }
+    });
+    QObject::connect(backend, &PlaybackBackend::unsupported, q, [this](const QUrl &source) {
+        // chosen by the container, the codec decides; a backend set by the user stays.
+        if (!WpCfg->enable() || WpCfg->backend() == BackendName::kMultimedia) {
+            return;
+        }
+        fmInfo() << "play" << source << "by mpv instead";
+        // not within a signal of the backend to be replaced.
+        QMetaObject::invokeMethod(q, [this]() { startPlayers(true); }, Qt::QueuedConnection);
+    });
+    backend->setWidgets(widgets);
+    for (auto itor = screenFiles.begin(); itor != screenFiles.end(); ++itor) {
+        backend->setScreenSource(itor.key(), itor.value());
+    }
+}
+
+void WallpaperEnginePrivate::startPlayers(bool reload)
+{
+    // remote sources are played from the local cache once fetched.
+    const QUrl source = sources->resolve(currentVideo());
+    if (source.isEmpty()) {
+        fmInfo() << "waiting for" << currentVideo() << "to be fetched.";
+        stopPlayers();
+        return;
+    }
+
+    const QString file = source.isLocalFile() ? source.toLocalFile() : source.toString();
+    clipBytes = sources->clipSize(currentVideo());
+    // probed by the source cache, mpv plays it until that is known.
+    animated = source.isLocalFile() && sources->isAnimated(currentVideo());
+
+    // where it was before the restart, only once after turnOn.
+    qreal start = 0;
+    const bool resume = resumePending;
+    resumePending = false;
+    if (resume) {
+        // the screens of the common source are kept on the same frame.
+        QString screen;
+        for (auto itor = widgets.begin(); itor != widgets.end() && screen.isEmpty(); ++itor) {
+            if (!screenFiles.contains(itor.key())) {
+                screen = itor.key();
+            }
+        }
+        start = playback.position(currentVideo(), screen);
+        if (start > 0) {
+            fmInfo() << "resume" << file << "at" << start;
+        }
+    }
+    if (!animated) {
+        setBackend(BackendProbe::choose(WpCfg->backend(), source, widgets.size()));
+    }
+    applyLayout();
+    applyPixelFormat();
+    applyHwdec();
+
+    if (animated) {
+        if (backend) {
+            backend->stop();
+        }
+        if (reload || imageSource->fileName() != file) {
+            imageSource->load(file);
+        }
+    } else if (decoder) {
+        backend->stop();
+        if (reload || decoder->fileName() != file) {
+            decoder->load(file, start);
+        }
+    } else {
+        backend->setSeamlessLoop(WpCfg->seamlessLoop(), clipBytes);
+        backend->load(source, reload, start);
+        // screens of their own file resume on their own.
+        for (auto itor = screenFiles.begin(); resume && itor != screenFiles.end(); ++itor) {
+            const qreal own = playback.position(itor.value(), itor.key());
+            if (own > 0 && widgets.contains(itor.key())) {
+                backend->setScreenSource(itor.key(), itor.value(), own);
+            }
+        }
+    }
+
+    applyAudio();
+    applyProfile();
+    applyMemoryLevel();
+
+    // nobody can see it now, the new players start paused.
+    if (isPaused()) {
+        setPaused(true);
+    }
+}
+
+void WallpaperEnginePrivate::stopPlayers()
+{
+    delete imageSource;
+    imageSource = nullptr;
+    animated = false;
+    if (decoder) {
+        decoder->stop();
+    }
+    if (backend) {
+        backend->stop();
+    }
+}
+
+void WallpaperEnginePrivate::setPaused(bool pause)
+{
+    if (imageSource) {
+        imageSource->setPaused(pause);
+    }
+
+    if (decoder) {
+        decoder->setPaused(pause);
+    }
+
+    if (backend) {
+        backend->setPaused(pause);
+    }
+}
+
+void WallpaperEnginePrivate::applyAudio()
+{
+#ifdef ENABLE_AUDIO_OUTPUT
+    const bool audible = !WpCfg->mute() && !animated;
+#else
+    const bool audible = false;
+#endif
+    // a track that is not selected is neither demuxed nor decoded.
+    if (decoder) {
+        decoder->setMpvProperty("aid", audible ? "auto" : "no");
+    }
+
+    if (backend) {
+        backend->setAudible(audible && !decoder);
+    }
+}
+
+bool WallpaperEnginePrivate::isPaused() const
+{
+    return suspended || userPaused || profile().paused;
+}
+
+void WallpaperEnginePrivate::updatePaused()
+{
+    if (videos.isEmpty()) {
+        return;
+    }
+    setPaused(isPaused());
+}
+
+void WallpaperEnginePrivate::requestQuality(const QString &policy, QualityLevel level)
+{
+    if (level == QualityLevel::kFull) {
+        qualityRequests.remove(policy);
+    } else {
+        qualityRequests.insert(policy, level);
+    }
+
+    QualityLevel worst = QualityLevel::kFull;
+    for (QualityLevel l : qualityRequests.values()) {
+        worst = qMax(worst, l);
+    }
+
+    if (worst == quality) {
+        return;
+    }
+
+    fmInfo() << "quality" << qualityName(quality) << "->" << qualityName(worst)
+             << "requested by" << policy;
+    const bool wasPaused = isPaused();
+    quality = worst;
+    applyProfile();
+    updateSpan();
+    if (wasPaused != isPaused()) {
+        updatePaused();
+    }
+}
+
+QualityProfile WallpaperEnginePrivate::profile() const
+{
+    // the policies only ever lower what the user allows.
+    QualityProfile ret = QualityProfile::of(quality);
+    const int userFps = WpCfg->maxFps();
+    if (userFps > 0) {
+        ret.maxFps = ret.maxFps > 0 ? qMin(ret.maxFps, userFps) : userFps;
+    }
+    ret.renderScale = qMin(ret.renderScale, WpCfg->renderScale());
+    return ret;
+}
+
+void WallpaperEnginePrivate::applyProfile()
+{
+    const QualityProfile current = profile();
+    if (backend) {
+        backend->setMaxFps(current.maxFps);
+    }
+
+    if (decoder) {
+        const QVariantMap props = MpvBackend::fpsProperties(current.maxFps);
+        for (auto itor = props.begin(); itor != props.end(); ++itor) {
+            decoder->setMpvProperty(itor.key(), itor.value());
+        }
+    }
+
+    if (imageSource) {
+        imageSource->setMaxFps(current.maxFps);
+    }
+}
+
+void WallpaperEnginePrivate::setMemoryLevel(MemoryPressureMonitor::Level level)
+{
+    const bool wasShared = memoryLevel >= MemoryPressureMonitor::kShared;
+    memoryLevel = level;
+
+    // freezing is a quality step, it is undone with the others.
+    requestQuality("memory", level >= MemoryPressureMonitor::kFrozen ? QualityLevel::kPaused : QualityLevel::kFull);
+
+    if (wasShared != (level >= MemoryPressureMonitor::kShared) && WpCfg->enable() && !videos.isEmpty()) {
+        // the per-screen decoders are to be replaced by a single one or back.
+        startPlayers();
+        return;
+    }
+
+    applyMemoryLevel();
+}
+
+void WallpaperEnginePrivate::applySeamless()
+{
+    if (backend) {
+        backend->setSeamlessLoop(WpCfg->seamlessLoop(), clipBytes);
+    }
+    applyMemoryLevel();
+}
+
+void WallpaperEnginePrivate::applyMemoryLevel()
+{
+    const bool dropCaches = memoryLevel >= MemoryPressureMonitor::kCaches;
+    if (backend) {
+        backend->setCacheSize(WpCfg->demuxerMaxBytes(), WpCfg->demuxerBackBytes());
+        backend->setCacheLimited(dropCaches);
+    }
+
+    if (decoder) {
+        const QVariantMap props = MpvBackend::cacheProperties(dropCaches, WpCfg->seamlessLoop(),
+                                                              WpCfg->demuxerMaxBytes(), WpCfg->demuxerBackBytes(),
+                                                              clipBytes);
+        for (auto itor = props.begin(); itor != props.end(); ++itor) {
+            decoder->setMpvProperty(itor.key(), itor.value());
+        }
+    }
+
+    const bool shrinkPools = memoryLevel >= MemoryPressureMonitor::kPools;
+    if (imageSource) {
+        imageSource->setBudget(shrinkPools ? 0 : AnimatedImageSource::defaultBudget());
+    }
+
+    if (shrinkPools) {
+        // the decoders of parked widgets are the largest pools of all.
+        releaseParked();
+        for (const VideoProxyPointer &bwp : widgets.values()) {
+            bwp->trimBuffer();
+        }
+    }
+
+    if (dropCaches) {
+        q->releaseMemory();
+    }
+}
+
+void WallpaperEnginePrivate::applyPixelFormat()
+{
+    const QImage::Format format = FrameConverter::imageFormat(WpCfg->pixelFormat());
+    for (const VideoProxyPointer &bwp : widgets.values()) {
+        bwp->setPixelFormat(format);
+    }
+
+    if (backend) {
+        backend->setPixelFormat(format);
+    }
+
+    if (imageSource) {
+        imageSource->setPixelFormat(format);
+    }
+}
+
+void WallpaperEnginePrivate::applyHwdec()
+{
+    const QString mode = WpCfg->hwdec();
+    if (backend) {
+        backend->setHwdec(mode);
+    }
+
+    // the frames of the helper are read back to be shared.
+    if (decoder) {
+        decoder->setMpvProperty("hwdec", MpvBackend::hwdecProperty(mode, true));
+    }
+}
+
+void WallpaperEnginePrivate::initSettingHandlers()
+{
+    // the players keep running, only what the key is about is reconfigured.
+    auto restart = [this]() {
+        if (WpCfg->enable() && !videos.isEmpty()) {
+            startPlayers(true);
+        }
+    };
+
+    settingHandlers.insert(SettingKey::kLayout, [this]() {
+        if (!WpCfg->enable()) {
+            return;
+        }
+
+        if (videos.isEmpty()) {
+            applyLayout();
+        } else {
+            startPlayers(true);
+        }
+    });
+    // players are kept, they just load the other file.
+    settingHandlers.insert(SettingKey::kSource, restart);
+    settingHandlers.insert(SettingKey::kBackend, restart);
+    // switch the audio track only, the video keeps playing.
+    settingHandlers.insert(SettingKey::kMute, [this]() {
+        if (WpCfg->enable()) {
+            applyAudio();
+        }
+    });
+    settingHandlers.insert(SettingKey::kPixelFormat, [this]() { applyPixelFormat(); });
+    settingHandlers.insert(SettingKey::kHwdec, [this]() { applyHwdec(); });
+    settingHandlers.insert(SettingKey::kMaxFps, [this]() { applyProfile(); });
+    settingHandlers.insert(SettingKey::kRenderScale, [this]() { updateSpan(); });
+    settingHandlers.insert(SettingKey::kDemuxerMaxBytes, [this]() { applyMemoryLevel(); });
+    settingHandlers.insert(SettingKey::kDemuxerBackBytes, [this]() { applyMemoryLevel(); });
+    settingHandlers.insert(SettingKey::kSeamlessLoop, [this]() { applySeamless(); });
+    settingHandlers.insert(SettingKey::kLoadHighThreshold, [this]() {
+        load->setThresholds(WpCfg->loadHighThreshold(), WpCfg->loadLowThreshold());
+    });
+    settingHandlers.insert(SettingKey::kLoadLowThreshold, settingHandlers.value(SettingKey::kLoadHighThreshold));
+    settingHandlers.insert(SettingKey::kThermalHeadroom, [this]() {
+        thermal->setHeadroom(WpCfg->thermalHeadroom());
+    });
+    settingHandlers.insert(SettingKey::kSourceCacheQuota, [this]() {
+        sources->setQuota(WpCfg->sourceCacheQuota());
+    });
+    settingHandlers.insert(SettingKey::kDecoder, [this, restart]() {
+        // another process to decode in, the players of the screens are reused.
+        delete decoder;
+        decoder = nullptr;
+        decoderFailed = false;
+        restart();
+    });
+    settingHandlers.insert(SettingKey::kTraceFile, []() {
+        Tracer::instance()->setOutput(WpCfg->traceFile());
+    });
+}
+
+void WallpaperEnginePrivate::applySetting(const QString &key)
+{
+    auto handler = settingHandlers.constFind(key);
+    if (handler == settingHandlers.constEnd()) {
+        // the limits of the helper are set when its scope is created.
+        fmInfo() << key << "changed, applied when the decoder is restarted.";
+        return;
+    }
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    (*handler)();
+
+    // until the players got it, mpv applies the properties asynchronously.
+    ApplyLatency &latency = settingLatency[key];
+    latency.last = elapsed.nsecsElapsed() / 1000;
+    latency.max = qMax(latency.max, latency.last);
+    ++latency.count;
+    fmInfo() << "apply" << key << "=" << WpCfg->value(key) << "in" << latency.last << "us";
+}
+
+void WallpaperEnginePrivate::savePlayback()
+{
+    if (videos.isEmpty() || animated) {
+        return;
+    }
+
+    for (auto itor = widgets.begin(); itor != widgets.end(); ++itor) {
+        PlaybackState::Entry entry;
+        entry.own = screenFiles.contains(itor.key());
+        entry.file = screenFiles.value(itor.key(), currentVideo());
+        if (decoder) {
+            entry.position = decoder->currentPosition();
+        } else {
+            entry.position = backend ? backend->position(itor.key()) : -1;
+        }
+
+        if (entry.position < 0) {
+            continue;
+        }
+        playback.setEntry(itor.key(), entry);
+    }
+
+    // nothing is written if no screen moved.
+    if (playback.save()) {
+        fmDebug() << "playback state saved";
+    }
 }
 
 WallpaperEngine::WallpaperEngine(QObject *parent)
     : QObject(parent)
     , d(new WallpaperEnginePrivate(this))
 {
+    if (Tracer::isEnabled()) {
+        d->paints = new PaintCounter([this]() {
+            return WpCfg->enable() && !d->videos.isEmpty() && !d->suspended;
+        }, this);
+    }
+
+    d->geometryTimer.setSingleShot(true);
+    d->geometryTimer.setInterval(0);
+    connect(&d->geometryTimer, &QTimer::timeout, this, [this]() {
+        d->applyGeometry();
+    });
+
+    d->sources = new SourceCache(this);
+    connect(d->sources, &SourceCache::ready, this, [this](const QUrl &url) {
+        if (WpCfg->enable() && d->currentVideo() == url) {
+            d->startPlayers(true);
+        }
+    });
+    // a gone or animated file is played another way.
+    connect(d->sources, &SourceCache::kindChanged, this, [this](const QUrl &url) {
+        if (d->sources->isMissing(url)) {
+            fmWarning() << "source" << url << "is gone";
+            for (const QString &screen : d->screenFiles.keys(url)) {
+                setScreenFile(screen, QUrl());
+            }
+        }
+        if (WpCfg->enable() && !d->videos.isEmpty()
+            && (d->currentVideo() == url || QUrl(WpCfg->source()) == url)) {
+            d->startPlayers(true);
+        }
+    });
+    connect(d->sources, &SourceCache::listed, this, [this](const QString &path, const QList<QUrl> &urls) {
+        if (path == d->sourcePath()) {
+            d->listed = urls;
+        }
+    });
+    // local files are sized off the gui thread, after they started playing.
+    connect(d->sources, &SourceCache::sized, this, [this](const QUrl &url) {
+        if (WpCfg->enable() && d->currentVideo() == url) {
+            d->clipBytes = d->sources->clipSize(url);
+            d->applySeamless();
+        }
+    });
+
+    d->session = new SessionMonitor(QDBusConnection::sessionBus(), this);
+    connect(d->session, &SessionMonitor::suspendChanged, this, [this](bool suspend) {
+        d->suspended = suspend;
+        fmInfo() << (suspend ? "suspend" : "resume") << "video wallpaper";
+        d->updatePaused();
+    });
+
+    d->load = new LoadGovernor("/proc", this);
+    connect(d->load, &LoadGovernor::levelChanged, this, [this](QualityLevel level) {
+        d->requestQuality("load", level);
+    });
+
+    d->thermal = new ThermalMonitor("/sys/class/thermal", this);
+    connect(d->thermal, &ThermalMonitor::levelChanged, this, [this](QualityLevel level) {
+        d->requestQuality("thermal", level);
+    });
+
+    d->memory = new MemoryPressureMonitor("/proc", this);
+    connect(d->memory, &MemoryPressureMonitor::levelChanged, this, [this](MemoryPressureMonitor::Level level) {
+        d->setMemoryLevel(level);
+    });
+
+    // a playing clip always moves, what is lost by a crash is not worth more writes.
+    d->saveTimer.setInterval(kSaveInterval);
+    connect(&d->saveTimer, &QTimer::timeout, this, [this]() {
+        d->savePlayback();
+    });
+    // the engine may outlive the event loop, the state must not.
+    connect(qApp, &QCoreApplication::aboutToQuit, this, [this]() {
+        if (WpCfg->enable()) {
+            d->savePlayback();
+        }
+        d->playback.flush();
+    });
+
+    // screens usually come back soon when docking or switching display mode.
+    d->parkTimer.setSingleShot(true);
+    d->parkTimer.setInterval(10000);
+    connect(&d->parkTimer, &QTimer::timeout, this, [this]() {
+        d->releaseParked();
+    });
 }
 
 WallpaperEngine::~WallpaperEngine()
 {
+    if (d->dbus) {
+        d->dbus->unregisterObject();
+    }
     turnOff();
+    d->playback.flush();
 }
 
-bool WallpaperEngine::init()
+void WallpaperEngine::loadConfig()
 {
     WpCfg->initialize();
+    if (!WpCfg->traceFile().isEmpty()) {
+        Tracer::instance()->setOutput(WpCfg->traceFile());
+    }
+}
+
+bool WallpaperEngine::init()
+{
+    loadConfig();
+    VW_TRACE_SCOPE("WallpaperEngine::init");
 
     QFileInfo source(d->sourcePath());
     if (!source.exists()) {
         source.absoluteDir().mkpath(source.fileName());
     }
     fmInfo() << "the wallpaper resource is in" << source.absoluteFilePath();
+    // for the menu to list them at once while turned off.
+    d->sources->requestListing(d->sourcePath());
+
+    d->dbus = new VideoWallpaperDBus(this);
+    d->dbus->registerObject();
 
     if (!registerMenu()) {
         // waiting canvas menu
         dpfSignalDispatcher->subscribe("dfmplugin_menu", "signal_MenuScene_SceneAdded", this, &WallpaperEngine::registerMenu);
     }
 
+    d->initSettingHandlers();
+    connect(WpCfg, &WallpaperConfig::changeLayout, this, [this]() {
+        d->applySetting(SettingKey::kLayout);
+    });
+
+    connect(WpCfg, &WallpaperConfig::changeSource, this, [this]() {
+        d->applySetting(SettingKey::kSource);
+    });
+
+    connect(WpCfg, &WallpaperConfig::changeBackend, this, [this]() {
+        d->applySetting(SettingKey::kBackend);
+    });
+
+    connect(WpCfg, &WallpaperConfig::changeMute, this, [this]() {
+        d->applySetting(SettingKey::kMute);
+    });
+
+    connect(WpCfg, &WallpaperConfig::changeSetting, this, [this](const QString &key) {
+        d->applySetting(key);
+    });
+
     connect(WpCfg, &WallpaperConfig::changeEnableState, this, [this](bool e) {
         if (WpCfg->enable() == e) {
             return;
@@ -186,12 +985,12 @@ bool WallpaperEngine::init()
 
 void WallpaperEngine::turnOn(bool b)
 {
-    CanvasCoreUnsubscribe(signal_DesktopFrame_WindowAboutToBeBuilded, &WallpaperEngine::onDetachWindows);
-    CanvasCoreSubscribe(signal_DesktopFrame_WindowBuilded, &WallpaperEngine::build);
-    CanvasCoreSubscribe(signal_DesktopFrame_WindowShowed, &WallpaperEngine::play);
-    CanvasCoreSubscribe(signal_DesktopFrame_GeometryChanged, &WallpaperEngine::geometryChanged);
+    VW_TRACE_SCOPE("WallpaperEngine::turnOn");
+    VW_LIFECYCLE_SCOPE("turnOn");
+    DesktopHost::instance()->subscribe(this);
 
     d->watcher = new QFileSystemWatcher(this);
+    LifecycleStats::track(d->watcher, LifecycleStats::kWatcher);
     d->watcher->addPath(d->sourcePath());
     /**
      * FIXME: when a large video file is copied to directory,
@@ -199,26 +998,24 @@ void WallpaperEngine::turnOn(bool b)
      */
     connect(d->watcher, &QFileSystemWatcher::directoryChanged, this, &WallpaperEngine::refreshSource);
 
-#ifndef USE_LIBMPV
-    d->player = new QMediaPlayer(nullptr);
-
-    connect(
-        d->player, &QMediaPlayer::sourceChanged, this, [&] {
-            // try to release memory
-            releaseMemory();
-        },
-        Qt::QueuedConnection);
-    d->surface = new QVideoSink;
-    connect(d->surface, &QVideoSink::videoFrameChanged, this, &WallpaperEngine::catchImage);
-
-    d->player->setVideoSink(d->surface);
-    d->player->setLoops(QMediaPlayer::Infinite);
-
-#ifdef ENABLE_AUDIO_OUTPUT
-    QAudioOutput *output = new QAudioOutput(QMediaDevices::defaultAudioOutput(), d->player);
-    d->player->setAudioOutput(output);
-#endif
-#endif
+    d->session->start();
+    d->sources->setQuota(WpCfg->sourceCacheQuota());
+    d->load->setThresholds(WpCfg->loadHighThreshold(), WpCfg->loadLowThreshold());
+    d->thermal->setHeadroom(WpCfg->thermalHeadroom());
+    d->playback.read();
+    // files set over d-bus for a screen come back with it.
+    for (const QString &screen : d->playback.screens()) {
+        const PlaybackState::Entry entry = d->playback.entry(screen);
+        if (entry.own && !d->screenFiles.contains(screen)) {
+            d->screenFiles.insert(screen, entry.file);
+            d->sources->validate(entry.file);
+        }
+    }
+    d->resumePending = true;
+    d->saveTimer.start();
+    d->load->start();
+    d->thermal->start();
+    d->memory->start();
 
     if (b) {
         build();
@@ -229,87 +1026,251 @@ void WallpaperEngine::turnOn(bool b)
 
 void WallpaperEngine::turnOff()
 {
-    CanvasCoreUnsubscribe(signal_DesktopFrame_WindowAboutToBeBuilded, &WallpaperEngine::onDetachWindows);
-    CanvasCoreUnsubscribe(signal_DesktopFrame_WindowBuilded, &WallpaperEngine::build);
-    CanvasCoreUnsubscribe(signal_DesktopFrame_WindowShowed, &WallpaperEngine::play);
-    CanvasCoreUnsubscribe(signal_DesktopFrame_GeometryChanged, &WallpaperEngine::geometryChanged);
+    VW_LIFECYCLE_SCOPE("turnOff");
+    DesktopHost::instance()->unsubscribe(this);
 
     delete d->watcher;
     d->watcher = nullptr;
 
-#ifdef USE_LIBMPV
-    for (const VideoProxyPointer &bwp : d->widgets.values()) {
-        bwp->command(QVariantList {"stop"});
-        bwp->hide();
-    }
-#else
-    d->player->setSource(QUrl());
-    delete d->player;
-    d->player = nullptr;
-
-    delete d->surface;
-    d->surface = nullptr;
-
+    d->saveTimer.stop();
+    d->savePlayback();
+    d->resumePending = false;
+
+    d->session->stop();
+    d->suspended = false;
+    d->userPaused = false;
+    d->screenFiles.clear();
+    d->load->stop();
+    d->thermal->stop();
+    // nothing to rebuild when the monitor steps back.
+    d->memoryLevel = MemoryPressureMonitor::kNone;
+    d->memory->stop();
+    d->qualityRequests.clear();
+    d->quality = QualityLevel::kFull;
+
+    d->stopPlayers();
+    delete d->decoder;
+    d->decoder = nullptr;
+    d->decoderFailed = false;
+    delete d->backend;
+    d->backend = nullptr;
     d->clearWidgets();
-#endif
 
     d->videos.clear();
+    d->geometryTimer.stop();
+    d->parkTimer.stop();
+    d->parked.clear();
 
     // show background.
     d->setBackgroundVisible(true);
 
-#ifdef USE_LIBMPV
     // release memory
     releaseMemory();
-#endif
+}
+
+QVariantMap WallpaperEngine::stats() const
+{
+    QVariantMap ret {
+        { "enabled", WpCfg->enable() },
+        { "backend", d->backend ? d->backend->name() : QString() },
+        { "quality", qualityName(d->quality) },
+        { "suspended", d->suspended },
+        { "load", d->load->stats() },
+        { "thermal", d->thermal->stats() },
+        { "memory", d->memory->stats() },
+        { "sources", d->sources->stats() },
+        { "lifecycle", LifecycleStats::stats() },
+        { "playbackStateWrites", d->playback.writes() },
+        // of the last rebuild of the root windows
+        { "reattachUs", d->reattachTime },
+        { "parkedWidgets", d->parked.size() },
+        // the gui thread was held by the last coalesced geometry update
+        { "geometryStallUs", d->geometryStallTime },
+    };
+
+    if (d->paints) {
+        ret.insert("canvasPaintsPlaying", d->paints->rate(true));
+        ret.insert("canvasPaintsStopped", d->paints->rate(false));
+    }
+
+    if (d->decoder) {
+        ret.insert("decoderRestarts", d->decoder->restarts());
+    }
+
+    if (d->backend) {
+        const QVariantMap screens = d->backend->screenStats();
+        ret.insert("screens", screens);
+        // of the screens kept in sync, in s
+        qreal maxDrift = 0;
+        for (const QVariant &screen : screens) {
+            maxDrift = qMax(maxDrift, qAbs(screen.toMap().value("drift").toDouble()));
+        }
+        ret.insert("maxDrift", maxDrift);
+    }
+
+    qint64 presented = 0;
+    for (const VideoProxyPointer &bwp : d->widgets.values()) {
+        presented += bwp->presentedBytes();
+    }
+    ret.insert("pixelFormat", WpCfg->pixelFormat());
+    ret.insert("presentedBytes", presented);
+
+    QVariantMap settings;
+    for (auto itor = d->settingLatency.begin(); itor != d->settingLatency.end(); ++itor) {
+        settings.insert(itor.key(), QVariantMap {
+                                            { "lastUs", itor.value().last },
+                                            { "maxUs", itor.value().max },
+                                            { "count", itor.value().count },
+                                    });
+    }
+    ret.insert("settings", settings);
+
+    return ret;
+}
+
+QList<QUrl> WallpaperEngine::videos() const
+{
+    if (!d->videos.isEmpty()) {
+        return d->videos;
+    }
+
+    // listed even when turned off, for the menu, as of the last look at the directory.
+    d->sources->requestListing(d->sourcePath());
+    return d->listed;
+}
+
+QUrl WallpaperEngine::currentVideo() const
+{
+    return d->currentVideo();
+}
+
+void WallpaperEngine::setPaused(bool pause)
+{
+    if (d->userPaused == pause) {
+        return;
+    }
+
+    const bool wasPaused = d->isPaused();
+    d->userPaused = pause;
+    if (wasPaused != d->isPaused()) {
+        d->updatePaused();
+    }
+}
+
+bool WallpaperEngine::next()
+{
+    const QList<QUrl> list = videos();
+    if (list.isEmpty()) {
+        return false;
+    }
+
+    const int index = list.indexOf(currentVideo());
+    return setFile(list.at((index + 1) % list.size()));
+}
+
+bool WallpaperEngine::setFile(const QUrl &file)
+{
+    // a file found gone later is replaced by the first one of the directory.
+    if (!file.isValid() || d->sources->isMissing(file)) {
+        fmWarning() << "can not play" << file;
+        return false;
+    }
+    d->sources->validate(file);
+
+    // the players load it on changeSource.
+    WpCfg->setSource(file.toString());
+    return true;
+}
+
+bool WallpaperEngine::setScreenFile(const QString &screen, const QUrl &file)
+{
+    // back to the common source, also for a screen that is gone.
+    if (file.isEmpty()) {
+        d->screenFiles.remove(screen);
+        // not to come back with the next turnOn.
+        d->playback.removeEntry(screen);
+        if (d->backend && !d->backend->pushesFrames()) {
+            d->backend->setScreenSource(screen, file);
+        }
+        return true;
+    }
+
+    if (!d->widgets.contains(screen)) {
+        fmWarning() << "no wallpaper on screen" << screen;
+        return false;
+    }
+
+    if (!file.isValid() || d->sources->isMissing(file)) {
+        fmWarning() << "can not play" << file << "on" << screen;
+        return false;
+    }
+
+    // pushed frames are the same on all screens.
+    if (!d->backend || d->animated || d->decoder || d->backend->pushesFrames()
+        || !d->backend->setScreenSource(screen, file)) {
+        return false;
+    }
+
+    // a file found gone later is dropped again.
+    d->sources->validate(file);
+    d->screenFiles.insert(screen, file);
+    return true;
+}
+
+bool WallpaperEngine::setQualityLevel(const QString &level)
+{
+    QualityLevel l = QualityLevel::kFull;
+    if (!qualityFromName(level, &l)) {
+        fmWarning() << "unknown quality level" << level;
+        return false;
+    }
+
+    d->requestQuality("dbus", l);
+    return true;
 }
 
 void WallpaperEngine::refreshSource()
 {
-    d->videos = d->getVideos(d->sourcePath());
+    VW_TRACE_SCOPE("WallpaperEngine::refreshSource");
+    VW_LIFECYCLE_SCOPE("refreshSource");
+    d->videos = SourceCache::listDirectory(d->sourcePath());
     checkResource();
 
     if (d->videos.isEmpty()) {
-#ifdef USE_LIBMPV
-        for (const VideoProxyPointer &bwp : d->widgets.values()) {
-            bwp->command(QVariantList {"stop"});
-        }
-        releaseMemory();
-#else
-        d->player->setSource(QUrl());
+        d->stopPlayers();
         for (const VideoProxyPointer &bwp : d->widgets.values()) {
             bwp->clear();
         }
-#endif
+        releaseMemory();
         return;
     }
 
-#ifdef USE_LIBMPV
     releaseMemory();
-    for (const VideoProxyPointer &bwp : d->widgets.values()) {
-        bwp->command(QVariantList {"loadfile", d->videos.constFirst().toLocalFile()});
-    }
-#else
-    d->player->setSource(d->videos.constFirst());
-    d->player->play();
-#endif
+    d->startPlayers(true);
 }
 
 void WallpaperEngine::build()
 {
+    VW_TRACE_SCOPE("WallpaperEngine::build");
+    VW_LIFECYCLE_SCOPE("build");
+    QElapsedTimer elapsed;
+    elapsed.start();
+
     // clean up invalid widget
     auto cleanupInvalidWidgets = [this] {
-        auto winMap = rootMap();
-        for (const QString &sp : d->widgets.keys()) {
-            if (!winMap.contains(sp)) {
-                auto videoProxy = d->widgets.take(sp);
-                videoProxy.clear();
-                fmInfo() << "remove screen:" << sp;
-            }
+        d->parkInvalidWidgets(rootMap());
+        if (d->backend) {
+            d->backend->setWidgets(d->widgets);
         }
+        d->applyLayout();
+        // the audible screen might be gone.
+        d->applyAudio();
     };
 
-    QList<QWidget *> root = ddplugin_desktop_util::desktopFrameRootWindows();
+    // widgets of removed screens can be taken by the new ones.
+    d->parkInvalidWidgets(rootMap());
+
+    QList<QWidget *> root = DesktopHost::instance()->rootWindows();
     if (root.size() == 1) {
         QWidget *primary = root.first();
         if (primary == nullptr) {
@@ -327,18 +1288,7 @@ void WallpaperEngine::build()
             return;
         }
 
-        VideoProxyPointer bwp = d->widgets.value(screenName);
-        if (!bwp.isNull()) {
-            // update widget
-            bwp->setParent(primary);
-            QRect geometry = d->relativeGeometry(primary->geometry()); // scaled area
-            bwp->setGeometry(geometry);
-        } else {
-            // add new widget
-            fmInfo() << "screen:" << screenName << "added, create it.";
-            bwp = d->createWidget(primary);
-            d->widgets.insert(screenName, bwp);
-        }
+        d->attachWidget(screenName, primary);
     } else {
         // check whether to add
         for (QWidget *win : root) {
@@ -348,47 +1298,45 @@ void WallpaperEngine::build()
                 continue;
             }
 
-            VideoProxyPointer bwp = d->widgets.value(screenName);
-            if (!bwp.isNull()) {
-                // update widget
-                bwp->setParent(win);
-                QRect geometry = d->relativeGeometry(win->geometry()); // scaled area
-                bwp->setGeometry(geometry);
-            } else {
-                // add new widget
-                fmInfo() << "screen:" << screenName << "added, create it.";
-                bwp = d->createWidget(win);
-                d->widgets.insert(screenName, bwp);
-            }
+            d->attachWidget(screenName, win);
         }
     }
 
     cleanupInvalidWidgets();
+
+    if (d->paints) {
+        for (QWidget *win : root) {
+            d->paints->watch(win);
+        }
+    }
+
+    // a mode switch may change the rate only, the geometry staying the same.
+    for (QWidget *win : root) {
+        if (win && win->screen()) {
+            connect(win->screen(), &QScreen::refreshRateChanged, this, &WallpaperEngine::geometryChanged, Qt::UniqueConnection);
+        }
+    }
+
+    d->reattachTime = elapsed.nsecsElapsed() / 1000;
+    fmInfo() << "attach" << d->widgets.size() << "widgets in" << d->reattachTime << "us,"
+             << d->parked.size() << "parked";
 }
 
 void WallpaperEngine::onDetachWindows()
 {
+    VW_LIFECYCLE_SCOPE("onDetachWindows");
+    // the root windows are deleted, build attaches the widgets to the new ones.
     for (const VideoProxyPointer &bwp : d->widgets.values()) {
-        bwp->setParent(nullptr);
+        bwp->setParent(d->parkingWindow());
     }
 }
 
 void WallpaperEngine::geometryChanged()
 {
-    auto winMap = rootMap();
-    for (auto itor = d->widgets.begin(); itor != d->widgets.end(); ++itor) {
-        VideoProxyPointer bw = itor.value();
-        auto *win = winMap.value(itor.key());
-        if (win == nullptr) {
-            fmCritical() << "can not get root " << itor.key() << getScreenName(win);
-            continue;
-        }
-
-        if (bw.get() != nullptr) {
-            QRect geometry = d->relativeGeometry(win->geometry()); // scaled area
-            bw->setGeometry(geometry);
-        }
-    }
+    // resolution and scale changes emit a burst of signals,
+    // only the last geometry of this event loop turn matters.
+    ++d->geometryRequests;
+    d->geometryTimer.start();
 }
 
 void WallpaperEngine::play()
@@ -397,16 +1345,14 @@ void WallpaperEngine::play()
         if (d->videos.isEmpty()) {
             return;
         }
-#ifdef USE_LIBMPV
         // TODO: implement playlist
-        for (const VideoProxyPointer &bwp : d->widgets.values()) {
-            bwp->command(QVariantList {"loadfile", d->videos.constFirst()});
+        d->startPlayers();
+        if (d->paints) {
+            // the canvas views are created after the windows are built.
+            for (QWidget *win : DesktopHost::instance()->rootWindows()) {
+                d->paints->watch(win);
+            }
         }
-#else
-        // TODO: implement playlist
-        d->player->setSource(d->videos.constFirst());
-        d->player->play();
-#endif
         d->setBackgroundVisible(false);
         show();
     }
@@ -415,7 +1361,7 @@ void WallpaperEngine::play()
 void WallpaperEngine::show()
 {
     // relayout
-    dpfSlotChannel->push("ddplugin_core", "slot_DesktopFrame_LayoutWidget");
+    DesktopHost::instance()->layoutWidgets();
     for (const VideoProxyPointer &bwp : d->widgets.values()) {
         bwp->show();
     }
@@ -440,7 +1386,7 @@ bool WallpaperEngine::registerMenu()
 {
     if (dfmplugin_menu_util::menuSceneContains("CanvasMenu")) {
         // register menu for canvas
-        dfmplugin_menu_util::menuSceneRegisterScene(VideoWallpaerMenuCreator::name(), new VideoWallpaerMenuCreator());
+        dfmplugin_menu_util::menuSceneRegisterScene(VideoWallpaerMenuCreator::name(), new VideoWallpaerMenuCreator(this));
         dfmplugin_menu_util::menuSceneBind(VideoWallpaerMenuCreator::name(), "CanvasMenu");
 
         dpfSignalDispatcher->unsubscribe("dfmplugin_menu", "signal_MenuScene_SceneAdded", this, &WallpaperEngine::registerMenu);
@@ -454,34 +1400,6 @@ void WallpaperEngine::checkResource()
 {
     if (d->videos.isEmpty()) {
         QString text = tr("Please add the video file to %0").arg(d->sourcePath());
-        Dtk::Core::DUtil::DNotifySender(text)
-            .appName(tr("Video Wallpaper"))
-            .appIcon("deepin-toggle-desktop")
-            .timeOut(5000)
-            .call();
-    }
-}
-
-#ifndef USE_LIBMPV
-void WallpaperEngine::catchImage(const QVideoFrame &frame)
-{
-    /**
-     * FIXME: QVideoFrame::toImage might cause SIGSEGV
-     * in Qt6, seems to be QVideoFrame mapped failed
-     * so try to map manually first
-     *
-     * (related to vdpau/vaapi?)
-     */
-    QVideoFrame tmp(frame);
-    bool ret = tmp.map(QVideoFrame::ReadOnly);
-    if (!ret) {
-        return;
-    }
-    // release memcpy
-    tmp.unmap();
-
-    for (const VideoProxyPointer &bwp : d->widgets.values()) {
-        bwp->updateImage(frame.toImage());
+        DesktopHost::instance()->notify(tr("Video Wallpaper"), text);
     }
 }
-#endif
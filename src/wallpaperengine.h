@@ -8,9 +8,8 @@
 #include "ddplugin_videowallpaper_global.h"
 
 #include <QObject>
-#ifndef USE_LIBMPV
-#include <QVideoFrame>
-#endif
+#include <QUrl>
+#include <QVariantMap>
 
 DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
 
@@ -22,9 +21,21 @@ class WallpaperEngine : public QObject
 public:
     explicit WallpaperEngine(QObject *parent = nullptr);
     ~WallpaperEngine() override;
+    // reads the config and starts tracing if it says so, before the first scope is entered
+    static void loadConfig();
     bool init();
     void turnOn(bool build = true);
     void turnOff();
+    QVariantMap stats() const;
+    QList<QUrl> videos() const;
+    QUrl currentVideo() const;
+
+    // applied to the running players, nothing is torn down
+    void setPaused(bool pause);
+    bool next();
+    bool setFile(const QUrl &file);
+    bool setScreenFile(const QString &screen, const QUrl &file);
+    bool setQualityLevel(const QString &level);
 
 public slots:
     void refreshSource();
@@ -39,9 +50,6 @@ public slots:
 private slots:
     bool registerMenu();
     void checkResource();
-#ifndef USE_LIBMPV
-    void catchImage(const QVideoFrame &frame);
-#endif
 
 private:
     friend class WallpaperEnginePrivate;
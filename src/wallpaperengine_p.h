@@ -7,14 +7,26 @@
 
 #include "ddplugin_videowallpaper_global.h"
 #include "videoproxy.h"
+#include "sessionmonitor.h"
+#include "animatedimagesource.h"
+#include "sourcecache.h"
+#include "decoderclient.h"
+#include "paintcounter.h"
+#include "playbackbackend.h"
+#include "loadgovernor.h"
+#include "memorypressuremonitor.h"
+#include "thermalmonitor.h"
+#include "videowallpaperdbus.h"
+#include "playbackstate.h"
+#include "qualitylevel.h"
 
 #include <QFileSystemWatcher>
 #include <QRect>
 #include <QUrl>
-#ifndef USE_LIBMPV
-#include <QMediaPlayer>
-#include <QVideoSink>
-#endif
+#include <QTimer>
+#include <QHash>
+
+#include <functional>
 
 DDP_VIDEOWALLPAPER_BEGIN_NAMESPACE
 
@@ -27,22 +39,89 @@ public:
     {
         return QRect(QPoint(0, 0), geometry.size());
     }
-    static QList<QUrl> getVideos(const QString &path);
 
 private:
     VideoProxyPointer createWidget(QWidget *root);
+    void attachWidget(const QString &screenName, QWidget *root);
+    void parkInvalidWidgets(const QMap<QString, QWidget *> &winMap);
+    QWidget *parkingWindow();
+    void releaseParkingWindow();
+    void releaseParked();
+    void applyGeometry();
     void setBackgroundVisible(bool v);
     QString sourcePath() const;
+    QUrl currentVideo() const;
     QMap<QString, VideoProxyPointer> widgets;
     void clearWidgets();
+    bool spanMode() const;
+    bool useDecoder() const;
+    void applyLayout();
+    void updateSpan();
+    void startPlayers(bool reload = false);
+    void stopPlayers();
+    void setPaused(bool pause);
+    void applyAudio();
+    void setBackend(const QString &name);
+    bool isPaused() const;
+    void updatePaused();
+    void requestQuality(const QString &policy, QualityLevel level);
+    QualityProfile profile() const;
+    void applyProfile();
+    void setMemoryLevel(MemoryPressureMonitor::Level level);
+    void applyMemoryLevel();
+    void applySeamless();
+    void savePlayback();
+    void applyPixelFormat();
+    void applyHwdec();
+    void initSettingHandlers();
+    void applySetting(const QString &key);
 
 private:
     QFileSystemWatcher *watcher = nullptr;
-#ifndef USE_LIBMPV
-    QMediaPlayer *player = nullptr;
-    QVideoSink *surface = nullptr;
-#endif
+    SessionMonitor *session = nullptr;
+    bool suspended = false;
+    bool userPaused = false; // over d-bus
+    QMap<QString, QUrl> screenFiles; // per-screen files set over d-bus
+    SourceCache *sources = nullptr;
+    AnimatedImageSource *imageSource = nullptr;
+    bool animated = false; // the current source is an animated image
+    DecoderClient *decoder = nullptr;
+    bool decoderFailed = false;
+    PaintCounter *paints = nullptr; // only when tracing
+    LoadGovernor *load = nullptr;
+    MemoryPressureMonitor *memory = nullptr;
+    ThermalMonitor *thermal = nullptr;
+    VideoWallpaperDBus *dbus = nullptr;
+    MemoryPressureMonitor::Level memoryLevel = MemoryPressureMonitor::kNone;
+    QMap<QString, QualityLevel> qualityRequests; // by policy
+    QualityLevel quality = QualityLevel::kFull; // the worst of the requests
+    PlaybackBackend *backend = nullptr; // chosen for each source
     QList<QUrl> videos;
+    QList<QUrl> listed; // off the gui thread, for the menu while turned off
+    qint64 clipBytes = -1; // of the current source, bounds the seamless loop cache
+    PlaybackState playback; // resumed after turnOn
+    bool resumePending = false;
+    QTimer saveTimer;
+    // widgets of removed screens, kept alive for a while to be reused
+    QMap<QString, VideoProxyPointer> parked;
+    QTimer parkTimer;
+    // hidden parent of detached and parked widgets, so they never become windows of their own
+    QWidget *holder = nullptr;
+    qint64 reattachTime = 0; // us
+    QTimer geometryTimer;
+    int geometryRequests = 0;
+    qint64 geometryStallTime = 0; // us, of the last coalesced update
+    QSize spanFrame;
+    qreal spanRatio = 1.0;
+    // reconfigure the running players for a changed setting
+    QHash<QString, std::function<void()>> settingHandlers;
+    struct ApplyLatency
+    {
+        qint64 last = 0; // us
+        qint64 max = 0;
+        int count = 0;
+    };
+    QHash<QString, ApplyLatency> settingLatency;
 
     friend class WallpaperEngine;
     WallpaperEngine *q;
@@ -0,0 +1,132 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef FIXTURES_H
+#define FIXTURES_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QSize>
+#include <QString>
+
+/**
+ * Media the tests write themselves, no encoder is needed for either.
+ */
+namespace Fixtures {
+
+// LZW codes of 9 bits without compression, a clear code keeps the table from growing.
+inline QByteArray uncompressed(const QByteArray &pixels)
+{
+    static constexpr int kClear = 256;
+    static constexpr int kEnd = 257;
+    static constexpr int kRun = 250;
+
+    QByteArray out;
+    quint32 bits = 0;
+    int count = 0;
+    auto put = [&](int code) {
+        bits |= static_cast<quint32>(code) << count;
+        count += 9;
+        while (count >= 8) {
+            out.append(static_cast<char>(bits & 0xff));
+            bits >>= 8;
+            count -= 8;
+        }
+    };
+
+    for (int i = 0; i < pixels.size(); ++i) {
+        if (i % kRun == 0)
+            put(kClear);
+        put(static_cast<uchar>(pixels.at(i)));
+    }
+    put(kEnd);
+    if (count > 0)
+        out.append(static_cast<char>(bits & 0xff));
+    return out;
+}
+
+inline void writeShort(QFile *f, int v)
+{
+    const char b[2] = { static_cast<char>(v & 0xff), static_cast<char>((v >> 8) & 0xff) };
+    f->write(b, 2);
+}
+
+// a looping gif of frames moving a gradient, delay in 1/100 s
+inline bool writeGif(const QString &path, const QSize &size, int frames, int delay)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly))
+        return false;
+
+    f.write("GIF89a");
+    writeShort(&f, size.width());
+    writeShort(&f, size.height());
+    f.write("\xf7\x00\x00", 3);
+    for (int i = 0; i < 256; ++i) {
+        const char rgb[3] = { static_cast<char>(i), static_cast<char>(255 - i), static_cast<char>(i / 2) };
+        f.write(rgb, 3);
+    }
+    f.write("\x21\xff\x0bNETSCAPE2.0\x03\x01\x00\x00\x00", 19);
+
+    for (int n = 0; n < frames; ++n) {
+        f.write("\x21\xf9\x04\x04", 4);
+        writeShort(&f, delay);
+        f.write("\x00\x00", 2);
+
+        f.write("\x2c", 1);
+        writeShort(&f, 0);
+        writeShort(&f, 0);
+        writeShort(&f, size.width());
+        writeShort(&f, size.height());
+        f.write("\x00\x08", 2);
+
+        QByteArray pixels(size.width() * size.height(), Qt::Uninitialized);
+        for (int y = 0; y < size.height(); ++y) {
+            for (int x = 0; x < size.width(); ++x)
+                pixels[y * size.width() + x] = static_cast<char>((x + y + n * 16) & 0xff);
+        }
+
+        const QByteArray data = uncompressed(pixels);
+        for (int i = 0; i < data.size(); i += 255) {
+            const int len = qMin(255, static_cast<int>(data.size()) - i);
+            const char c = static_cast<char>(len);
+            f.write(&c, 1);
+            f.write(data.constData() + i, len);
+        }
+        f.write("\x00", 1);
+    }
+
+    f.write("\x3b", 1);
+    return true;
+}
+
+// an uncompressed YUV4MPEG2 clip of frames moving a gradient, any libavformat plays it
+inline bool writeClip(const QString &path, const QSize &size, int frames, int fps)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly))
+        return false;
+
+    f.write(QString("YUV4MPEG2 W%1 H%2 F%3:1 Ip A1:1 C420jpeg\n")
+                    .arg(size.width()).arg(size.height()).arg(fps).toLatin1());
+
+    const int chroma = (size.width() / 2) * (size.height() / 2);
+    for (int n = 0; n < frames; ++n) {
+        f.write("FRAME\n");
+        QByteArray luma(size.width() * size.height(), Qt::Uninitialized);
+        for (int y = 0; y < size.height(); ++y) {
+            for (int x = 0; x < size.width(); ++x)
+                luma[y * size.width() + x] = static_cast<char>((x + y + n * 8) & 0xff);
+        }
+        f.write(luma);
+        f.write(QByteArray(chroma, static_cast<char>(64 + n % 128)));
+        f.write(QByteArray(chroma, static_cast<char>(192 - n % 128)));
+    }
+
+    return f.error() == QFile::NoError;
+}
+
+}
+
+#endif // FIXTURES_H
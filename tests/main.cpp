@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testregistry.h"
+
+#include "wallpaperconfig.h"
+
+#include <QApplication>
+#include <QStandardPaths>
+#include <QTest>
+
+#include <memory>
+
+int main(int argc, char *argv[])
+{
+    // the settings of the user are neither read nor written, caches go to the
+    // test locations, and the engine tests bring a wallpaper directory of their own.
+    QStandardPaths::setTestModeEnabled(true);
+    ddplugin_videowallpaper::WallpaperConfig::useDefaults();
+    qputenv("QT_QPA_PLATFORM", qgetenv("QT_QPA_PLATFORM").isEmpty() ? "offscreen" : qgetenv("QT_QPA_PLATFORM"));
+
+    QApplication app(argc, argv);
+    int failed = 0;
+    for (const TestRegistry::Factory &factory : TestRegistry::factories()) {
+        std::unique_ptr<QObject> test(factory());
+        failed += QTest::qExec(test.get(), argc, argv);
+    }
+    return failed;
+}
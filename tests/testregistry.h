@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TESTREGISTRY_H
+#define TESTREGISTRY_H
+
+#include <QList>
+#include <QObject>
+
+#include <functional>
+
+/**
+ * All test classes run in one executable, each file registers its own.
+ */
+namespace TestRegistry {
+
+using Factory = std::function<QObject *()>;
+
+inline QList<Factory> &factories()
+{
+    static QList<Factory> list;
+    return list;
+}
+
+inline int add(const Factory &factory)
+{
+    factories().append(factory);
+    return factories().size();
+}
+
+}
+
+#define VW_TEST_CONCAT_IMPL(a, b) a##b
+#define VW_TEST_CONCAT(a, b) VW_TEST_CONCAT_IMPL(a, b)
+
+#define VW_REGISTER_TEST(Class) \
+    static const int VW_TEST_CONCAT(__vwTest, __LINE__) = TestRegistry::add([]() -> QObject * { return new Class; });
+
+#endif // TESTREGISTRY_H
@@ -0,0 +1,141 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testregistry.h"
+#include "fixtures.h"
+
+#include "animatedimagesource.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTimer>
+
+#include <time.h>
+#include <unistd.h>
+
+using namespace ddplugin_videowallpaper;
+
+namespace {
+
+qint64 cpuTime() // us, of the process
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+qint64 rss() // bytes
+{
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly))
+        return 0;
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    return fields.size() > 1 ? fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE) : 0;
+}
+
+}
+
+class AnimatedImageSourceTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(dir.isValid());
+        small = dir.filePath("small.gif");
+        QVERIFY(Fixtures::writeGif(small, QSize(64, 36), 5, 2));
+        QVERIFY(AnimatedImageSource::isAnimatedImage(small));
+    }
+
+    void cachesLoop()
+    {
+        AnimatedImageSource source;
+        QSignalSpy spy(&source, &AnimatedImageSource::frameReady);
+        QVERIFY(source.load(small));
+
+        // more than one pass of the loop
+        QTRY_VERIFY_WITH_TIMEOUT(spy.count() >= 12, 5000);
+        const QImage frame = spy.last().first().value<QImage>();
+        QCOMPARE(frame.size(), QSize(64, 36));
+        QCOMPARE(source.cacheSize(), 5 * frame.sizeInBytes());
+    }
+
+    void streamsOverBudget()
+    {
+        AnimatedImageSource source;
+        source.setBudget(1);
+        QSignalSpy spy(&source, &AnimatedImageSource::frameReady);
+        QVERIFY(source.load(small));
+
+        QTRY_VERIFY_WITH_TIMEOUT(spy.count() >= 12, 5000);
+        QCOMPARE(source.cacheSize(), 0);
+    }
+
+    void retarget()
+    {
+        AnimatedImageSource source;
+        QSignalSpy spy(&source, &AnimatedImageSource::frameReady);
+        QVERIFY(source.load(small));
+        QTRY_VERIFY_WITH_TIMEOUT(spy.count() >= 2, 5000);
+
+        // frames of the old size are never shown again.
+        source.setTarget(QSize(128, 72), 1.0);
+        spy.clear();
+        QTRY_VERIFY_WITH_TIMEOUT(spy.count() >= 6, 5000);
+        for (const QList<QVariant> &args : spy)
+            QCOMPARE(args.first().value<QImage>().size(), QSize(128, 72));
+    }
+
+    // what a 1080p loop costs, and how long the gui thread is held at most.
+    void measure()
+    {
+        const QString big = dir.filePath("big.gif");
+        QVERIFY(Fixtures::writeGif(big, QSize(1920, 1080), 6, 4));
+
+        QElapsedTimer stall;
+        qint64 longest = 0;
+        QTimer probe;
+        probe.setInterval(0);
+        connect(&probe, &QTimer::timeout, this, [&]() {
+            if (stall.isValid())
+                longest = qMax(longest, stall.nsecsElapsed() / 1000);
+            stall.start();
+        });
+
+        const qint64 rssBefore = rss();
+        const qint64 cpuBefore = cpuTime();
+        QElapsedTimer wall;
+        wall.start();
+
+        AnimatedImageSource source;
+        QSignalSpy spy(&source, &AnimatedImageSource::frameReady);
+        probe.start();
+        QVERIFY(source.load(big));
+        // three passes of the loop, the first one decodes into the cache.
+        QTRY_VERIFY_WITH_TIMEOUT(spy.count() >= 18, 20000);
+        probe.stop();
+
+        const qint64 cpu = cpuTime() - cpuBefore;
+        const qint64 grown = rss() - rssBefore;
+        qInfo("1080p gif, %lld frames in %lld ms: cpu %lld us per frame, rss +%lld KiB, cache %lld KiB, "
+              "longest gui stall %lld us",
+              static_cast<qint64>(spy.count()), wall.elapsed(), cpu / spy.count(), grown / 1024,
+              source.cacheSize() / 1024, longest);
+
+        QVERIFY(source.cacheSize() > 0);
+        QVERIFY(source.cacheSize() <= AnimatedImageSource::defaultBudget());
+    }
+
+private:
+    QTemporaryDir dir;
+    QString small;
+};
+
+VW_REGISTER_TEST(AnimatedImageSourceTest)
+
+#include "tst_animatedimagesource.moc"
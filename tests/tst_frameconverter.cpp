@@ -0,0 +1,130 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testregistry.h"
+
+#include "frameconverter.h"
+
+#include <QTest>
+#include <QVideoFrame>
+
+#include <cstring>
+
+using namespace ddplugin_videowallpaper;
+
+namespace {
+
+// an NV12 frame of one color
+QVideoFrame makeFrame(const QSize &size, uchar y, uchar u, uchar v,
+                      QVideoFrameFormat::ColorSpace space, QVideoFrameFormat::ColorRange range)
+{
+    QVideoFrameFormat format(size, QVideoFrameFormat::Format_NV12);
+    format.setColorSpace(space);
+    format.setColorRange(range);
+
+    QVideoFrame frame(format);
+    if (!frame.map(QVideoFrame::WriteOnly))
+        return QVideoFrame();
+
+    for (int row = 0; row < size.height(); ++row)
+        memset(frame.bits(0) + row * frame.bytesPerLine(0), y, static_cast<size_t>(size.width()));
+    for (int row = 0; row < size.height() / 2; ++row) {
+        uchar *line = frame.bits(1) + row * frame.bytesPerLine(1);
+        for (int x = 0; x < size.width(); x += 2) {
+            line[x] = u;
+            line[x + 1] = v;
+        }
+    }
+
+    frame.unmap();
+    return frame;
+}
+
+QRgb centerOf(const QVideoFrame &frame)
+{
+    const QImage img = FrameConverter::fromVideoFrame(frame, QImage::Format_RGB32, QSize(64, 36), true);
+    return img.pixel(img.width() / 2, img.height() / 2);
+}
+
+bool near(int a, int b)
+{
+    return qAbs(a - b) <= 2;
+}
+
+}
+
+class FrameConverterTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void range()
+    {
+        const QSize size(320, 180);
+        // black of limited range is code 16, of full range 0.
+        QRgb px = centerOf(makeFrame(size, 16, 128, 128, QVideoFrameFormat::ColorSpace_BT601, QVideoFrameFormat::ColorRange_Video));
+        QVERIFY(near(qRed(px), 0) && near(qGreen(px), 0) && near(qBlue(px), 0));
+
+        px = centerOf(makeFrame(size, 16, 128, 128, QVideoFrameFormat::ColorSpace_BT601, QVideoFrameFormat::ColorRange_Full));
+        QVERIFY(near(qRed(px), 16) && near(qGreen(px), 16) && near(qBlue(px), 16));
+
+        px = centerOf(makeFrame(size, 235, 128, 128, QVideoFrameFormat::ColorSpace_BT709, QVideoFrameFormat::ColorRange_Video));
+        QVERIFY(near(qRed(px), 255) && near(qGreen(px), 255) && near(qBlue(px), 255));
+    }
+
+    void matrix()
+    {
+        const QSize size(320, 180);
+        // pure red in full range BT.709
+        QRgb px = centerOf(makeFrame(size, 54, 99, 255, QVideoFrameFormat::ColorSpace_BT709, QVideoFrameFormat::ColorRange_Full));
+        QVERIFY2(near(qRed(px), 255) && near(qGreen(px), 0) && near(qBlue(px), 0), qPrintable(QString::number(px, 16)));
+
+        // pure red in limited range BT.601
+        px = centerOf(makeFrame(size, 81, 90, 240, QVideoFrameFormat::ColorSpace_BT601, QVideoFrameFormat::ColorRange_Video));
+        QVERIFY2(near(qRed(px), 255) && near(qGreen(px), 0) && near(qBlue(px), 0), qPrintable(QString::number(px, 16)));
+
+        // untagged HD is taken as BT.709
+        const QRgb tagged = centerOf(makeFrame(QSize(1280, 720), 63, 102, 240, QVideoFrameFormat::ColorSpace_BT709, QVideoFrameFormat::ColorRange_Video));
+        const QRgb untagged = centerOf(makeFrame(QSize(1280, 720), 63, 102, 240, QVideoFrameFormat::ColorSpace_Undefined, QVideoFrameFormat::ColorRange_Unknown));
+        QCOMPARE(untagged, tagged);
+    }
+
+    void convert_data()
+    {
+        QTest::addColumn<int>("format");
+        QTest::addColumn<bool>("qt");
+
+        QTest::newRow("rgb32") << int(QImage::Format_RGB32) << false;
+        QTest::newRow("rgb888") << int(QImage::Format_RGB888) << false;
+        QTest::newRow("rgb16") << int(QImage::Format_RGB16) << false;
+        // what the planar path replaces
+        QTest::newRow("qt-rgb32") << int(QImage::Format_RGB32) << true;
+    }
+
+    // a 1080p frame onto a 1080p screen
+    void convert()
+    {
+        QFETCH(int, format);
+        QFETCH(bool, qt);
+
+        const QSize size(1920, 1080);
+        const QVideoFrame frame = makeFrame(size, 120, 100, 150, QVideoFrameFormat::ColorSpace_BT709, QVideoFrameFormat::ColorRange_Video);
+        QVERIFY(frame.isValid());
+
+        QImage out;
+        QBENCHMARK {
+            if (qt)
+                out = frame.toImage().scaled(size, Qt::KeepAspectRatioByExpanding, Qt::FastTransformation).convertToFormat(QImage::Format(format));
+            else
+                out = FrameConverter::fromVideoFrame(frame, QImage::Format(format), size, true);
+        }
+
+        QCOMPARE(out.size(), size);
+        QCOMPARE(out.format(), QImage::Format(format));
+    }
+};
+
+VW_REGISTER_TEST(FrameConverterTest)
+
+#include "tst_frameconverter.moc"
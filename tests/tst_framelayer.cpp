@@ -0,0 +1,122 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testregistry.h"
+
+#include "videoproxy.h"
+
+#include <QApplication>
+#include <QOpenGLContext>
+#include <QTest>
+#include <QWidget>
+
+using namespace ddplugin_videowallpaper;
+
+namespace {
+
+class PaintSpy : public QObject
+{
+public:
+    explicit PaintSpy(QWidget *widget)
+    {
+        widget->installEventFilter(this);
+    }
+
+    int paints = 0;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override
+    {
+        if (event->type() == QEvent::Paint)
+            ++paints;
+        return QObject::eventFilter(watched, event);
+    }
+};
+
+}
+
+// the desktop window: the video at the bottom, the canvas of the icons above it.
+class FrameLayerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        QOpenGLContext context;
+        if (!context.create())
+            QSKIP("no OpenGL on this platform");
+    }
+
+    void init()
+    {
+        root = new QWidget;
+        root->setGeometry(0, 0, 1280, 720);
+        proxy = new VideoProxy(root);
+        proxy->setGeometry(root->rect());
+        canvas = new QWidget(root);
+        canvas->setGeometry(root->rect());
+        canvas->raise();
+        root->show();
+        QVERIFY(QTest::qWaitForWindowExposed(root));
+        settle();
+    }
+
+    void cleanup()
+    {
+        delete root;
+        root = nullptr;
+    }
+
+    void canvasPaints_data()
+    {
+        QTest::addColumn<bool>("layer");
+
+        QTest::newRow("layer") << true;
+        // what the layer replaces, the proxy painting the frames itself
+        QTest::newRow("proxy") << false;
+    }
+
+    // canvas repaints per presented frame
+    void canvasPaints()
+    {
+        QFETCH(bool, layer);
+
+        QImage frame(1280, 720, QImage::Format_RGB32);
+        PaintSpy spy(canvas);
+        int frames = 0;
+        // a second of 60 fps video per iteration
+        QBENCHMARK {
+            for (int i = 0; i < 60; ++i) {
+                frame.fill(i % 2 ? Qt::darkBlue : Qt::darkRed);
+                if (layer)
+                    proxy->updateImage(frame);
+                else
+                    proxy->update();
+                ++frames;
+                settle();
+            }
+        }
+
+        const qreal perFrame = qreal(spy.paints) / frames;
+        qInfo("%s: %d frames, %.2f canvas paints per frame", layer ? "layer" : "proxy", frames, perFrame);
+        if (layer)
+            QVERIFY2(perFrame < 0.1, qPrintable(QString::number(perFrame)));
+    }
+
+private:
+    void settle()
+    {
+        QCoreApplication::sendPostedEvents();
+        QCoreApplication::processEvents();
+    }
+
+    QWidget *root = nullptr;
+    VideoProxy *proxy = nullptr;
+    QWidget *canvas = nullptr;
+};
+
+VW_REGISTER_TEST(FrameLayerTest)
+
+#include "tst_framelayer.moc"
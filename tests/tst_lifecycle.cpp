@@ -0,0 +1,394 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testregistry.h"
+#include "fixtures.h"
+
+#include "desktophost.h"
+#include "lifecyclestats.h"
+#include "videoproxy.h"
+#include "wallpaperconfig.h"
+#include "wallpaperengine.h"
+
+#include <dfm-base/dfm_desktop_defines.h>
+
+#include <QApplication>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QWidget>
+
+#include <malloc.h>
+
+using namespace ddplugin_videowallpaper;
+DFMBASE_USE_NAMESPACE
+
+namespace {
+
+constexpr qint64 kMaxLatency = 2000000; // us, of any lifecycle operation
+constexpr qint64 kMaxRssGrowth = 64 * 1024 * 1024; // over the random sequences
+
+// root windows of screens that come and go, events are delivered by the test.
+class FakeDesktopHost : public DesktopHost
+{
+public:
+    ~FakeDesktopHost() override { qDeleteAll(roots); }
+
+    QList<QWidget *> rootWindows() const override { return roots; }
+    void subscribe(WallpaperEngine *) override { ++subscribed; }
+    void unsubscribe(WallpaperEngine *) override { --subscribed; }
+    void layoutWidgets() override { }
+    void notify(const QString &, const QString &) override { ++notifications; }
+    QString wallpaperDirectory() const override { return directory; }
+
+    void addScreen()
+    {
+        auto root = new QWidget;
+        const int index = nextScreen++;
+        root->setProperty(DesktopFrameProperty::kPropScreenName, QString("screen-%0").arg(index));
+        root->setGeometry(1920 * index, 0, 1920, 1080);
+        // the engine sets the surface type of the native window.
+        root->winId();
+        roots.append(root);
+    }
+
+    void removeScreen()
+    {
+        if (roots.size() > 1)
+            delete roots.takeAt(QRandomGenerator::global()->bounded(roots.size()));
+    }
+
+    QList<QWidget *> roots;
+    QString directory;
+    int nextScreen = 0;
+    int subscribed = 0;
+    int notifications = 0;
+};
+
+}
+
+class LifecycleTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        // a clip for mpv, an animated image to switch to
+        QVERIFY(media.isValid() && spare.isValid());
+        QVERIFY(Fixtures::writeClip(media.filePath("clip.y4m"), QSize(160, 90), 50, 25));
+        gif = spare.filePath("a.gif");
+        QVERIFY(Fixtures::writeGif(gif, QSize(64, 36), 5, 4));
+
+        // dconfig is detached in main, nothing is written back.
+        WpCfg->initialize();
+        WpCfg->setEnable(true);
+    }
+
+    void cleanupTestCase()
+    {
+        WpCfg->setEnable(false);
+        report();
+    }
+
+    void init()
+    {
+        host = new FakeDesktopHost;
+        host->directory = media.path();
+        host->addScreen();
+        DesktopHost::setInstance(host);
+        engine = new WallpaperEngine;
+    }
+
+    void cleanup()
+    {
+        delete engine;
+        engine = nullptr;
+        DesktopHost::setInstance(nullptr);
+        host = nullptr;
+        setAnimated(false);
+    }
+
+    // the players the leak checks are about really exist.
+    void players()
+    {
+        host->addScreen();
+        engine->turnOn();
+        settle();
+        QCOMPARE(LifecycleStats::live(LifecycleStats::kVideoProxy), 2);
+        QVERIFY(LifecycleStats::live(LifecycleStats::kMpvContext) > 0);
+
+        setAnimated(true);
+        engine->refreshSource();
+        settle();
+        QCOMPARE(LifecycleStats::live(LifecycleStats::kImageSource), 1);
+
+        setAnimated(false);
+        engine->refreshSource();
+        settle();
+        QCOMPARE(LifecycleStats::live(LifecycleStats::kImageSource), 0);
+        QVERIFY(LifecycleStats::live(LifecycleStats::kMpvContext) > 0);
+
+        engine->turnOff();
+        settle();
+        verifyNothingLive();
+    }
+
+    void toggle()
+    {
+        for (int i = 0; i < 200; ++i) {
+            engine->turnOn();
+            settle();
+            engine->turnOff();
+            settle();
+            verifyNothingLive();
+        }
+        QCOMPARE(host->subscribed, 0);
+    }
+
+    void hotplug()
+    {
+        engine->turnOn();
+        for (int i = 0; i < 200; ++i) {
+            // the desktop detaches the widgets before it rebuilds the root windows.
+            engine->onDetachWindows();
+            if (i % 2)
+                host->removeScreen();
+            else
+                host->addScreen();
+            engine->build();
+            settle();
+            verifyNoProxyWindow();
+        }
+        engine->turnOff();
+        settle();
+        verifyNothingLive();
+    }
+
+    // the widgets move from the old root windows to the new ones.
+    void reattach()
+    {
+        host->addScreen();
+        host->addScreen();
+        engine->turnOn();
+        settle();
+
+        QBENCHMARK {
+            engine->onDetachWindows();
+            verifyNoProxyWindow();
+            engine->build();
+        }
+
+        verifyNoProxyWindow();
+        engine->turnOff();
+        settle();
+        verifyNothingLive();
+    }
+
+    // a burst of geometry signals is applied once, to the last geometry.
+    void resizeStorm()
+    {
+        host->addScreen();
+        host->addScreen();
+        engine->turnOn();
+        settle();
+
+        QRandomGenerator random(29);
+        for (int burst = 0; burst < 5; ++burst) {
+            const qint64 applied = operationCount("applyGeometry");
+            for (int i = 0; i < 500; ++i) {
+                QWidget *root = host->roots.at(random.bounded(host->roots.size()));
+                root->resize(1280 + random.bounded(1280), 720 + random.bounded(720));
+                engine->geometryChanged();
+            }
+            settle();
+            QCOMPARE(operationCount("applyGeometry"), applied + 1);
+
+            for (QWidget *root : host->roots) {
+                const QList<VideoProxy *> proxies = root->findChildren<VideoProxy *>(QString(), Qt::FindDirectChildrenOnly);
+                QCOMPARE(proxies.size(), 1);
+                QCOMPARE(proxies.first()->geometry(), QRect(QPoint(0, 0), root->size()));
+            }
+        }
+        qInfo("coalesced geometry update: %s us at most",
+              qPrintable(operation("applyGeometry").value("maxUs").toString()));
+
+        engine->turnOff();
+        settle();
+        verifyNothingLive();
+    }
+
+    // frames of a resizing source are scaled into the same buffer.
+    void resizeReusesBuffer()
+    {
+        engine->turnOn();
+        settle();
+        const QList<VideoProxy *> proxies = host->roots.first()->findChildren<VideoProxy *>(QString(), Qt::FindDirectChildrenOnly);
+        QCOMPARE(proxies.size(), 1);
+        VideoProxy *proxy = proxies.first();
+        proxy->setFrameMode(true);
+
+        // larger than what a screen keeps, each one is scaled down.
+        QImage frame(2560, 1440, QImage::Format_RGB32);
+        frame.fill(Qt::darkCyan);
+        const int allocations = proxy->bufferAllocations();
+        proxy->updateImage(frame);
+        QVERIFY(proxy->bufferAllocations() <= allocations + 1);
+        const int reserved = proxy->bufferAllocations();
+
+        for (int i = 0; i < 100; ++i) {
+            QImage next(2560 + i % 40, 1440 + (i * 7) % 40, QImage::Format_RGB32);
+            next.fill(Qt::darkCyan);
+            proxy->updateImage(next);
+        }
+        QCOMPARE(proxy->bufferAllocations(), reserved);
+
+        engine->turnOff();
+        settle();
+        verifyNothingLive();
+    }
+
+    void randomSequence_data()
+    {
+        QTest::addColumn<quint32>("seed");
+        for (quint32 seed : { 42u, 7u, 1234u, 2024u, 31337u })
+            QTest::newRow(qPrintable(QString::number(seed))) << seed;
+    }
+
+    void randomSequence()
+    {
+        QFETCH(quint32, seed);
+        if (rssBefore < 0)
+            rssBefore = residentAfterTrim();
+
+        QRandomGenerator random(seed);
+        bool on = false;
+        for (int i = 0; i < 1000; ++i) {
+            switch (random.bounded(6)) {
+            case 0:
+                if (on)
+                    engine->turnOff();
+                else
+                    engine->turnOn();
+                on = !on;
+                break;
+            case 1:
+                engine->geometryChanged();
+                break;
+            case 2:
+                // the root windows are rebuilt
+                if (on)
+                    engine->onDetachWindows();
+                if (random.bounded(2))
+                    host->addScreen();
+                else
+                    host->removeScreen();
+                if (on)
+                    engine->build();
+                break;
+            case 3:
+                if (on)
+                    engine->refreshSource();
+                break;
+            case 4:
+                // the clip is replaced by an animated image and back
+                setAnimated(!QFile::exists(media.filePath("a.gif")));
+                if (on)
+                    engine->refreshSource();
+                break;
+            default:
+                break;
+            }
+            settle();
+
+            if (!on)
+                verifyNothingLive();
+        }
+
+        engine->turnOff();
+        settle();
+        verifyNothingLive();
+        rssAfter = residentAfterTrim();
+    }
+
+private:
+    void setAnimated(bool on)
+    {
+        const QString path = media.filePath("a.gif");
+        if (on && !QFile::exists(path))
+            QVERIFY(QFile::copy(gif, path));
+        else if (!on && QFile::exists(path))
+            QVERIFY(QFile::remove(path));
+    }
+
+    static qint64 residentAfterTrim()
+    {
+        malloc_trim(0);
+        return LifecycleStats::residentBytes();
+    }
+
+    // latency of each operation and the memory left behind by all of them
+    void report()
+    {
+        const QVariantMap stats = LifecycleStats::stats();
+        const QVariantMap ops = stats.value("operations").toMap();
+        for (auto itor = ops.cbegin(); itor != ops.cend(); ++itor) {
+            const QVariantMap op = itor.value().toMap();
+            qInfo("%-16s count %6lld avg %7lld us max %8lld us", qPrintable(itor.key()),
+                  op.value("count").toLongLong(), op.value("avgUs").toLongLong(), op.value("maxUs").toLongLong());
+            QVERIFY2(op.value("maxUs").toLongLong() < kMaxLatency, qPrintable(itor.key()));
+        }
+
+        qInfo("rss drift since the first operation %lld KiB, over the random sequences %lld KiB",
+              stats.value("rssDrift").toLongLong() / 1024, (rssAfter - rssBefore) / 1024);
+        if (rssBefore >= 0 && rssAfter >= 0)
+            QVERIFY2(rssAfter - rssBefore < kMaxRssGrowth, "the random sequences leak memory");
+    }
+
+    void settle()
+    {
+        // deleteLater and the coalesced geometry update.
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+        QCoreApplication::processEvents();
+    }
+
+    static QVariantMap operation(const char *name)
+    {
+        return LifecycleStats::stats().value("operations").toMap().value(name).toMap();
+    }
+
+    static qint64 operationCount(const char *name)
+    {
+        return operation(name).value("count").toLongLong();
+    }
+
+    void verifyNoProxyWindow()
+    {
+        // a detached or parked widget is never a window of its own.
+        for (QWidget *top : QApplication::topLevelWidgets())
+            QVERIFY2(!qobject_cast<VideoProxy *>(top), "a video widget became a top level window");
+    }
+
+    void verifyNothingLive()
+    {
+        for (int i = 0; i < LifecycleStats::kKindCount; ++i) {
+            const auto kind = static_cast<LifecycleStats::Kind>(i);
+            QVERIFY2(LifecycleStats::live(kind) == 0,
+                     qPrintable(QString("%0 objects of kind %1 outlived turnOff").arg(LifecycleStats::live(kind)).arg(i)));
+        }
+    }
+
+    FakeDesktopHost *host = nullptr;
+    WallpaperEngine *engine = nullptr;
+    QTemporaryDir media; // the wallpaper directory
+    QTemporaryDir spare;
+    QString gif;
+    qint64 rssBefore = -1;
+    qint64 rssAfter = -1;
+};
+
+VW_REGISTER_TEST(LifecycleTest)
+
+#include "tst_lifecycle.moc"
@@ -0,0 +1,237 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testregistry.h"
+
+#include "loadgovernor.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace ddplugin_videowallpaper;
+
+namespace {
+
+// "system/self/pressure" in percent, one sample per token
+QList<LoadGovernor::Sample> parseTrace(const QString &trace)
+{
+    QList<LoadGovernor::Sample> samples;
+    for (const QString &token : trace.split(' ', Qt::SkipEmptyParts)) {
+        const QStringList v = token.split('/');
+        LoadGovernor::Sample s;
+        s.system = v.value(0).toDouble() / 100;
+        s.self = v.value(1).toDouble() / 100;
+        s.pressure = v.value(2).toDouble() / 100;
+        samples.append(s);
+    }
+    return samples;
+}
+
+bool writeFile(const QString &path, const QByteArray &content)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return f.write(content) == content.size();
+}
+
+// a procfs of the counters a recording holds
+class FakeProc
+{
+public:
+    explicit FakeProc(const QString &root)
+        : root(root)
+    {
+        QDir(root).mkpath("self");
+        QDir(root).mkpath("pressure");
+    }
+
+    // cpu time of one sample period in ticks
+    bool advance(qint64 busyTicks, qint64 selfTicks, qreal avg10)
+    {
+        busy += busyTicks;
+        idle += kPeriod - busyTicks;
+        self += selfTicks;
+
+        // user nice system idle iowait irq softirq steal guest guest_nice
+        const QByteArray stat = QString("cpu  %1 0 0 %2 0 0 0 0 0 0\ncpu0 %1 0 0 %2 0 0 0 0 0 0\n")
+                                        .arg(busy).arg(idle).toLatin1();
+        const QByteArray selfStat = QString("42 (dde desktop) S 1 42 42 0 -1 4194560 0 0 0 0 %1 %2 0 0 20 0 8 0\n")
+                                            .arg(self - self / 2).arg(self / 2).toLatin1();
+        const QByteArray pressure = QString("some avg10=%1 avg60=0.00 avg300=0.00 total=0\n"
+                                            "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n")
+                                            .arg(avg10, 0, 'f', 2).toLatin1();
+        return writeFile(root + "/stat", stat) && writeFile(root + "/self/stat", selfStat)
+                && writeFile(root + "/pressure/cpu", pressure);
+    }
+
+    static constexpr qint64 kPeriod = 1000;
+
+private:
+    QString root;
+    qint64 busy = 0;
+    qint64 idle = 0;
+    qint64 self = 0;
+};
+
+}
+
+class LoadGovernorTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void trace_data()
+    {
+        QTest::addColumn<QString>("trace");
+        QTest::addColumn<QString>("levels");
+
+        QTest::newRow("build then idle")
+                << "95/5/0 95/5/0 95/5/0 95/5/0 20/5/0 20/5/0 20/5/0 20/5/0 20/5/0"
+                << "full reduced reduced low low low low low reduced";
+        QTest::newRow("own decoding")
+                << "95/90/0 95/90/0 95/90/0 98/80/0"
+                << "full full full full";
+        QTest::newRow("cpu pressure")
+                << "30/5/90 30/5/90 30/5/20"
+                << "full reduced reduced";
+        QTest::newRow("flapping")
+                << "95/5/0 60/5/0 95/5/0 60/5/0 95/5/0 60/5/0"
+                << "full full full full full full";
+        QTest::newRow("interrupted recovery")
+                << "95/0/0 95/0/0 10/0/0 10/0/0 10/0/0 10/0/0 70/0/0 10/0/0 10/0/0 10/0/0 10/0/0 10/0/0"
+                << "full reduced reduced reduced reduced reduced reduced reduced reduced reduced reduced full";
+        QTest::newRow("floor")
+                << "99/0/0 99/0/0 99/0/0 99/0/0 99/0/0 99/0/0 99/0/0 99/0/0"
+                << "full reduced reduced low low paused paused paused";
+        QTest::newRow("ceiling")
+                << "5/0/0 5/0/0 5/0/0 5/0/0 5/0/0 5/0/0"
+                << "full full full full full full";
+    }
+
+    void trace()
+    {
+        QFETCH(QString, trace);
+        QFETCH(QString, levels);
+
+        const QList<LoadGovernor::Sample> samples = parseTrace(trace);
+        const QStringList expected = levels.split(' ');
+        QCOMPARE(samples.size(), expected.size());
+
+        LoadGovernor gov;
+        QSignalSpy spy(&gov, &LoadGovernor::levelChanged);
+        int changes = 0;
+        QualityLevel prev = gov.level();
+        for (int i = 0; i < samples.size(); ++i) {
+            gov.evaluate(samples.at(i));
+            QVERIFY2(qualityName(gov.level()) == expected.at(i),
+                     qPrintable(QString("sample %1: %2").arg(i).arg(qualityName(gov.level()))));
+            if (gov.level() != prev)
+                ++changes;
+            prev = gov.level();
+        }
+
+        // one signal per step, never a repeat of the same level
+        QCOMPARE(spy.count(), changes);
+        QCOMPARE(gov.stats().value("changes").toInt(), changes);
+    }
+
+    void thresholds()
+    {
+        LoadGovernor gov;
+        gov.setThresholds(0.5, 0.9);
+        QCOMPARE(gov.stats().value("highLoad").toDouble(), 0.85);
+        QCOMPARE(gov.stats().value("lowLoad").toDouble(), 0.5);
+
+        // 70% is busy once the bar is lowered
+        gov.setThresholds(0.6, 0.3);
+        for (const LoadGovernor::Sample &s : parseTrace("70/0/0 70/0/0"))
+            gov.evaluate(s);
+        QCOMPARE(gov.level(), QualityLevel::kReduced);
+    }
+
+    void stop()
+    {
+        LoadGovernor gov;
+        for (const LoadGovernor::Sample &s : parseTrace("95/0/0 95/0/0 95/0/0 95/0/0"))
+            gov.evaluate(s);
+        QCOMPARE(gov.level(), QualityLevel::kLow);
+
+        QSignalSpy spy(&gov, &LoadGovernor::levelChanged);
+        gov.stop();
+        QCOMPARE(gov.level(), QualityLevel::kFull);
+        QCOMPARE(spy.count(), 1);
+
+        gov.stop();
+        QCOMPARE(spy.count(), 1);
+    }
+
+    // the same policy fed from procfs counters instead of samples
+    void procfs()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        FakeProc proc(dir.path());
+        QVERIFY(proc.advance(0, 0, 0));
+
+        LoadGovernor gov(dir.path());
+        gov.start();
+        QCOMPARE(gov.level(), QualityLevel::kFull);
+
+        // busy, but mostly by us
+        for (int i = 0; i < 3; ++i) {
+            QVERIFY(proc.advance(950, 900, 0));
+            QVERIFY(QMetaObject::invokeMethod(&gov, "sample"));
+        }
+        QCOMPARE(gov.level(), QualityLevel::kFull);
+        QVERIFY(qAbs(gov.stats().value("system").toDouble() - 0.95) < 0.01);
+        QVERIFY(qAbs(gov.stats().value("self").toDouble() - 0.9) < 0.01);
+
+        // busy by others
+        for (int i = 0; i < 2; ++i) {
+            QVERIFY(proc.advance(950, 50, 0));
+            QVERIFY(QMetaObject::invokeMethod(&gov, "sample"));
+        }
+        QCOMPARE(gov.level(), QualityLevel::kReduced);
+
+        // idle cpus, but tasks stall waiting for them
+        for (int i = 0; i < 2; ++i) {
+            QVERIFY(proc.advance(300, 50, 92.5));
+            QVERIFY(QMetaObject::invokeMethod(&gov, "sample"));
+        }
+        QCOMPARE(gov.level(), QualityLevel::kLow);
+        QVERIFY(qAbs(gov.stats().value("pressure").toDouble() - 0.925) < 0.001);
+
+        gov.stop();
+        QCOMPARE(gov.level(), QualityLevel::kFull);
+    }
+
+    // a kernel without psi
+    void procfsWithoutPressure()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        FakeProc proc(dir.path());
+        QVERIFY(proc.advance(0, 0, 0));
+        QVERIFY(QFile::remove(dir.filePath("pressure/cpu")));
+
+        LoadGovernor gov(dir.path());
+        gov.start();
+        for (int i = 0; i < 2; ++i) {
+            QVERIFY(proc.advance(990, 0, 0));
+            QFile::remove(dir.filePath("pressure/cpu"));
+            QVERIFY(QMetaObject::invokeMethod(&gov, "sample"));
+        }
+        QCOMPARE(gov.level(), QualityLevel::kReduced);
+        QCOMPARE(gov.stats().value("pressure").toDouble(), 0.0);
+        gov.stop();
+    }
+};
+
+VW_REGISTER_TEST(LoadGovernorTest)
+
+#include "tst_loadgovernor.moc"
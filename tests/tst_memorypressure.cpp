@@ -0,0 +1,186 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testregistry.h"
+
+#include "memorypressuremonitor.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace ddplugin_videowallpaper;
+
+namespace {
+
+// a plain file takes no trigger, the monitor polls it.
+bool feed(const QString &root, qreal avg10)
+{
+    QFile f(root + "/pressure/memory");
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    const QByteArray psi = QString("some avg10=%1 avg60=0.00 avg300=0.00 total=0\n"
+                                   "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n")
+                                   .arg(avg10, 0, 'f', 2).toLatin1();
+    return f.write(psi) == psi.size();
+}
+
+}
+
+class MemoryPressureTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init()
+    {
+        dir.reset(new QTemporaryDir);
+        QVERIFY(dir->isValid());
+        QVERIFY(QDir(dir->path()).mkpath("pressure"));
+        QVERIFY(feed(dir->path(), 0));
+    }
+
+    void polling()
+    {
+        MemoryPressureMonitor monitor(dir->path());
+        QSignalSpy spy(&monitor, &MemoryPressureMonitor::levelChanged);
+        monitor.start();
+        QCOMPARE(monitor.stats().value("trigger").toBool(), false);
+        // the feed is left as it was, not overwritten by a trigger.
+        QFile psi(dir->filePath("pressure/memory"));
+        QVERIFY(psi.open(QIODevice::ReadOnly));
+        QVERIFY(psi.readLine().startsWith("some avg10=0.00 "));
+
+        QVERIFY(feed(dir->path(), 25));
+        const QList<MemoryPressureMonitor::Level> steps { MemoryPressureMonitor::kCaches, MemoryPressureMonitor::kPools,
+                                                          MemoryPressureMonitor::kShared, MemoryPressureMonitor::kFrozen };
+        for (MemoryPressureMonitor::Level expected : steps) {
+            tick(&monitor);
+            QCOMPARE(monitor.level(), expected);
+        }
+        QCOMPARE(spy.count(), steps.size());
+        QCOMPARE(monitor.stats().value("avg10").toDouble(), 25.0);
+
+        // frozen is the last step
+        tick(&monitor);
+        QCOMPARE(monitor.level(), MemoryPressureMonitor::kFrozen);
+        QCOMPARE(spy.count(), steps.size());
+    }
+
+    void recovery()
+    {
+        MemoryPressureMonitor monitor(dir->path());
+        monitor.start();
+        QVERIFY(feed(dir->path(), 12.5));
+        tick(&monitor);
+        tick(&monitor);
+        QCOMPARE(monitor.level(), MemoryPressureMonitor::kPools);
+
+        // still some stall, not yet quiet
+        QVERIFY(feed(dir->path(), 4));
+        for (int i = 0; i < 8; ++i)
+            tick(&monitor);
+        QCOMPARE(monitor.level(), MemoryPressureMonitor::kPools);
+
+        // one step back per quiet period
+        QVERIFY(feed(dir->path(), 0.2));
+        for (int i = 0; i < 4; ++i)
+            tick(&monitor);
+        QCOMPARE(monitor.level(), MemoryPressureMonitor::kPools);
+        tick(&monitor);
+        QCOMPARE(monitor.level(), MemoryPressureMonitor::kCaches);
+
+        // a spike in the quiet period starts it over
+        for (int i = 0; i < 4; ++i)
+            tick(&monitor);
+        QVERIFY(feed(dir->path(), 30));
+        tick(&monitor);
+        QCOMPARE(monitor.level(), MemoryPressureMonitor::kPools);
+        QVERIFY(feed(dir->path(), 0));
+        for (int i = 0; i < 4; ++i)
+            tick(&monitor);
+        QCOMPARE(monitor.level(), MemoryPressureMonitor::kPools);
+    }
+
+    // a moderate stall in the quiet period starts it over as well
+    void interruptedRecovery()
+    {
+        MemoryPressureMonitor monitor(dir->path());
+        monitor.start();
+        QVERIFY(feed(dir->path(), 25));
+        tick(&monitor);
+        tick(&monitor);
+        QCOMPARE(monitor.level(), MemoryPressureMonitor::kPools);
+
+        QVERIFY(feed(dir->path(), 0.2));
+        for (int i = 0; i < 4; ++i)
+            tick(&monitor);
+        QVERIFY(feed(dir->path(), 4));
+        tick(&monitor);
+        QVERIFY(feed(dir->path(), 0.2));
+        for (int i = 0; i < 4; ++i)
+            tick(&monitor);
+        QCOMPARE(monitor.level(), MemoryPressureMonitor::kPools);
+        tick(&monitor);
+        QCOMPARE(monitor.level(), MemoryPressureMonitor::kCaches);
+    }
+
+    // a trigger steps up once per tick, however often it fires.
+    void triggered()
+    {
+        MemoryPressureMonitor monitor(dir->path());
+        QSignalSpy spy(&monitor, &MemoryPressureMonitor::levelChanged);
+        monitor.start();
+
+        QVERIFY(QMetaObject::invokeMethod(&monitor, "onTriggered"));
+        QVERIFY(QMetaObject::invokeMethod(&monitor, "onTriggered"));
+        QTRY_COMPARE(spy.count(), 1);
+        QTest::qWait(50);
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(monitor.level(), MemoryPressureMonitor::kCaches);
+        QCOMPARE(monitor.stats().value("stalls").toInt(), 2);
+    }
+
+    void missingFeed()
+    {
+        QVERIFY(QFile::remove(dir->filePath("pressure/memory")));
+        MemoryPressureMonitor monitor(dir->path());
+        monitor.start();
+        for (int i = 0; i < 3; ++i)
+            tick(&monitor);
+        QCOMPARE(monitor.level(), MemoryPressureMonitor::kNone);
+    }
+
+    void stop()
+    {
+        MemoryPressureMonitor monitor(dir->path());
+        monitor.start();
+        QVERIFY(feed(dir->path(), 50));
+        tick(&monitor);
+        tick(&monitor);
+        QCOMPARE(monitor.level(), MemoryPressureMonitor::kPools);
+
+        QSignalSpy spy(&monitor, &MemoryPressureMonitor::levelChanged);
+        monitor.stop();
+        QCOMPARE(monitor.level(), MemoryPressureMonitor::kNone);
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(spy.first().first().value<MemoryPressureMonitor::Level>(), MemoryPressureMonitor::kNone);
+    }
+
+private:
+    // one poll, without waiting for the timer
+    static void tick(MemoryPressureMonitor *monitor)
+    {
+        QVERIFY(QMetaObject::invokeMethod(monitor, "tick"));
+    }
+
+    QScopedPointer<QTemporaryDir> dir;
+};
+
+VW_REGISTER_TEST(MemoryPressureTest)
+
+#include "tst_memorypressure.moc"
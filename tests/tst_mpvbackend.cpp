@@ -0,0 +1,108 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testregistry.h"
+#include "fixtures.h"
+
+#include "mpvbackend.h"
+#include "mpvframesource.h"
+
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace ddplugin_videowallpaper;
+
+static constexpr qint64 kMiB = 1024 * 1024;
+
+class MpvBackendTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void seamlessCache_data()
+    {
+        QTest::addColumn<bool>("limited");
+        QTest::addColumn<qint64>("clip");
+        QTest::addColumn<QString>("cache");
+        QTest::addColumn<qint64>("back");
+
+        // the whole clip and the slack
+        QTest::newRow("fits") << false << 10 * kMiB << "yes" << 11 * kMiB;
+        QTest::newRow("bound") << false << MpvBackend::kMaxSeamlessBytes << "yes" << MpvBackend::kMaxSeamlessBytes + kMiB;
+        // the configured back buffer, the loop reads the file again
+        QTest::newRow("too large") << false << MpvBackend::kMaxSeamlessBytes + 1 << "auto" << 20 * kMiB;
+        QTest::newRow("unknown") << false << qint64(-1) << "auto" << 20 * kMiB;
+        QTest::newRow("limited") << true << 10 * kMiB << "no" << qint64(0);
+    }
+
+    void seamlessCache()
+    {
+        QFETCH(bool, limited);
+        QFETCH(qint64, clip);
+        QFETCH(QString, cache);
+        QFETCH(qint64, back);
+
+        const QVariantMap props = MpvBackend::cacheProperties(limited, true, 100 * kMiB, 20 * kMiB, clip);
+        QCOMPARE(props.value("cache").toString(), cache);
+        QCOMPARE(props.value("demuxer-max-back-bytes").toLongLong(), back);
+    }
+
+    void loop()
+    {
+        const QVariantMap primed = MpvBackend::loopProperties(true);
+        QCOMPARE(primed.value("loop-file").toString(), QString("no"));
+        QCOMPARE(primed.value("loop-playlist").toString(), QString("inf"));
+        QCOMPARE(primed.value("prefetch-playlist").toString(), QString("yes"));
+
+        const QVariantMap seeking = MpvBackend::loopProperties(false);
+        QCOMPARE(seeking.value("loop-file").toString(), QString("inf"));
+        QCOMPARE(seeking.value("loop-playlist").toString(), QString("no"));
+    }
+
+    void seam_data()
+    {
+        QTest::addColumn<bool>("primed");
+
+        QTest::newRow("primed") << true;
+        // what it replaces, for the log
+        QTest::newRow("seek") << false;
+    }
+
+    // frame time at the wrap of a short generated clip, software rendered
+    void seam()
+    {
+        QFETCH(bool, primed);
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString clip = dir.filePath("clip.y4m");
+        QVERIFY(Fixtures::writeClip(clip, QSize(160, 90), 25, 25));
+
+        MpvFrameSource source;
+        if (!source.mpvProperty("mpv-version").isValid())
+            QSKIP("no mpv context");
+        source.setFrameSize(QSize(160, 90));
+        const QVariantMap props = MpvBackend::loopProperties(primed);
+        for (auto itor = props.begin(); itor != props.end(); ++itor)
+            source.setMpvProperty(itor.key(), itor.value());
+        source.command(QVariantList { "loadfile", clip });
+        if (primed)
+            source.command(QVariantList { "loadfile", clip, "append" });
+
+        // a second a round
+        QTRY_VERIFY_WITH_TIMEOUT(source.seamStats().value("seams").toInt() >= 3, 15000);
+        const QVariantMap stats = source.seamStats();
+        const qreal frameMs = stats.value("frameMs").toDouble();
+        const qreal maxSeamMs = stats.value("maxSeamMs").toDouble();
+        qInfo("%s: %d seams, at most %.0f ms, frames take %.1f ms", primed ? "primed" : "seek",
+              stats.value("seams").toInt(), maxSeamMs, frameMs);
+        QVERIFY(frameMs > 0);
+        if (primed)
+            QVERIFY2(maxSeamMs < qMax(4 * frameMs, 200.0), qPrintable(QString::number(maxSeamMs)));
+    }
+};
+
+VW_REGISTER_TEST(MpvBackendTest)
+
+#include "tst_mpvbackend.moc"
@@ -0,0 +1,206 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testregistry.h"
+
+#include "sessionmonitor.h"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QProcess>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+
+using namespace ddplugin_videowallpaper;
+
+namespace {
+
+class FakeScreenSaver : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.ScreenSaver")
+
+public:
+    bool active = false;
+
+public slots:
+    bool GetActive() { return active; }
+
+signals:
+    void ActiveChanged(bool on);
+};
+
+class FakeSessionManager : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.deepin.dde.SessionManager1")
+    Q_PROPERTY(bool Locked READ isLocked)
+
+public:
+    bool isLocked() const { return locked; }
+    bool locked = false;
+};
+
+}
+
+// the services run on a private dbus-daemon, the monitor is on a connection of its own.
+class SessionMonitorTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        const QString daemon = QStandardPaths::findExecutable("dbus-daemon");
+        if (daemon.isEmpty())
+            QSKIP("dbus-daemon is not installed");
+
+        bus.start(daemon, { "--session", "--nofork", "--print-address" });
+        QVERIFY(bus.waitForStarted());
+        QVERIFY(bus.waitForReadyRead(5000));
+        address = QString::fromLatin1(bus.readLine()).trimmed();
+        QVERIFY(!address.isEmpty());
+    }
+
+    void cleanupTestCase()
+    {
+        if (bus.state() == QProcess::NotRunning)
+            return;
+        bus.terminate();
+        bus.waitForFinished();
+    }
+
+    void init()
+    {
+        service = new QDBusConnection(QDBusConnection::connectToBus(address, "vw-test-service"));
+        QVERIFY(service->isConnected());
+        saver = new FakeScreenSaver;
+        session = new FakeSessionManager;
+        QVERIFY(service->registerObject("/org/freedesktop/ScreenSaver", saver,
+                                        QDBusConnection::ExportAllSlots | QDBusConnection::ExportAllSignals));
+        QVERIFY(service->registerObject("/org/deepin/dde/SessionManager1", session,
+                                        QDBusConnection::ExportAllProperties));
+        QVERIFY(service->registerService("org.freedesktop.ScreenSaver"));
+        QVERIFY(service->registerService("org.deepin.dde.SessionManager1"));
+    }
+
+    void cleanup()
+    {
+        delete monitor;
+        monitor = nullptr;
+        service->unregisterService("org.freedesktop.ScreenSaver");
+        service->unregisterService("org.deepin.dde.SessionManager1");
+        service->unregisterObject("/org/freedesktop/ScreenSaver");
+        service->unregisterObject("/org/deepin/dde/SessionManager1");
+        delete saver;
+        delete session;
+        delete service;
+        QDBusConnection::disconnectFromBus("vw-test-service");
+        QDBusConnection::disconnectFromBus("vw-test-client");
+    }
+
+    void initialState()
+    {
+        saver->active = true;
+        session->locked = true;
+        createMonitor();
+
+        QTRY_VERIFY(monitor->reasons().testFlag(SessionMonitor::kScreenSaver));
+        QTRY_VERIFY(monitor->reasons().testFlag(SessionMonitor::kLocked));
+        QVERIFY(monitor->isSuspended());
+    }
+
+    void screenSaver()
+    {
+        createMonitor();
+        QSignalSpy spy(monitor, &SessionMonitor::suspendChanged);
+
+        emit saver->ActiveChanged(true);
+        QTRY_COMPARE(spy.count(), 1);
+        QCOMPARE(spy.last().first().toBool(), true);
+
+        emit saver->ActiveChanged(false);
+        QTRY_COMPARE(spy.count(), 2);
+        QCOMPARE(spy.last().first().toBool(), false);
+    }
+
+    void lock()
+    {
+        createMonitor();
+        QSignalSpy spy(monitor, &SessionMonitor::suspendChanged);
+
+        setLocked(true);
+        QTRY_COMPARE(spy.count(), 1);
+        QVERIFY(monitor->reasons().testFlag(SessionMonitor::kLocked));
+
+        // still hidden by the screensaver after unlocking
+        emit saver->ActiveChanged(true);
+        QTRY_VERIFY(monitor->reasons().testFlag(SessionMonitor::kScreenSaver));
+        setLocked(false);
+        QTRY_VERIFY(!monitor->reasons().testFlag(SessionMonitor::kLocked));
+        QCOMPARE(spy.count(), 1);
+        QVERIFY(monitor->isSuspended());
+    }
+
+    void stop()
+    {
+        createMonitor();
+        emit saver->ActiveChanged(true);
+        QTRY_VERIFY(monitor->isSuspended());
+
+        monitor->stop();
+        QVERIFY(!monitor->isSuspended());
+
+        // nothing is followed any more
+        QSignalSpy spy(monitor, &SessionMonitor::suspendChanged);
+        emit saver->ActiveChanged(true);
+        QTest::qWait(200);
+        QCOMPARE(spy.count(), 0);
+    }
+
+    // the replies to the initial queries come after stop
+    void stopBeforeReplies()
+    {
+        saver->active = true;
+        session->locked = true;
+        monitor = new SessionMonitor(QDBusConnection::connectToBus(address, "vw-test-client"));
+        QSignalSpy spy(monitor, &SessionMonitor::suspendChanged);
+        monitor->start();
+        monitor->stop();
+
+        QTest::qWait(200);
+        QCOMPARE(spy.count(), 0);
+        QCOMPARE(monitor->reasons(), SessionMonitor::Reasons(SessionMonitor::kNone));
+    }
+
+private:
+    void createMonitor()
+    {
+        monitor = new SessionMonitor(QDBusConnection::connectToBus(address, "vw-test-client"));
+        monitor->start();
+        // the replies of the initial queries must not overtake the signals of the test.
+        QTest::qWait(200);
+    }
+
+    void setLocked(bool locked)
+    {
+        session->locked = locked;
+        QDBusMessage msg = QDBusMessage::createSignal("/org/deepin/dde/SessionManager1",
+                                                      "org.freedesktop.DBus.Properties", "PropertiesChanged");
+        msg << QString("org.deepin.dde.SessionManager1") << QVariantMap { { "Locked", locked } } << QStringList();
+        service->send(msg);
+    }
+
+    QProcess bus;
+    QString address;
+    QDBusConnection *service = nullptr;
+    FakeScreenSaver *saver = nullptr;
+    FakeSessionManager *session = nullptr;
+    SessionMonitor *monitor = nullptr;
+};
+
+VW_REGISTER_TEST(SessionMonitorTest)
+
+#include "tst_sessionmonitor.moc"
@@ -0,0 +1,220 @@
+// SPDX-FileCopyrightText: 2024 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "testregistry.h"
+
+#include "sourcecache.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTest>
+
+using namespace ddplugin_videowallpaper;
+
+namespace {
+
+// serves one answer per path, a connection per request
+class HttpStub : public QObject
+{
+public:
+    struct Route
+    {
+        QByteArray status = "200 OK";
+        QByteArray body;
+        bool length = true; // a Content-Length header
+        qint64 announced = -1; // in it, the size of the body if negative
+        bool hold = false; // the connection is left open after the body
+    };
+
+    HttpStub()
+    {
+        clock.start();
+        server.listen(QHostAddress::LocalHost);
+        connect(&server, &QTcpServer::newConnection, this, [this]() {
+            while (QTcpSocket *socket = server.nextPendingConnection()) {
+                connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { serve(socket); });
+                connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            }
+        });
+    }
+
+    bool isListening() const { return server.isListening(); }
+
+    QUrl url(const QString &path) const
+    {
+        return QUrl(QString("http://127.0.0.1:%1%2").arg(server.serverPort()).arg(path));
+    }
+
+    QHash<QString, Route> routes;
+    QHash<QString, QList<qint64>> requests; // ms since the stub started, by path
+
+private:
+    void serve(QTcpSocket *socket)
+    {
+        // the request has no body, its head is all there is to wait for.
+        QByteArray head = socket->property("head").toByteArray() + socket->readAll();
+        socket->setProperty("head", head);
+        if (!head.contains("\r\n\r\n"))
+            return;
+
+        const QString path = QString::fromLatin1(head.split(' ').value(1));
+        requests[path].append(clock.elapsed());
+        Route route = routes.value(path);
+        if (!routes.contains(path))
+            route.status = "404 Not Found";
+
+        QByteArray reply = "HTTP/1.1 " + route.status + "\r\nConnection: close\r\n";
+        if (route.length)
+            reply += "Content-Length: " + QByteArray::number(route.announced < 0 ? route.body.size() : route.announced) + "\r\n";
+        socket->write(reply + "\r\n" + route.body);
+        if (!route.hold)
+            socket->disconnectFromHost();
+    }
+
+    QTcpServer server;
+    QElapsedTimer clock;
+};
+
+HttpStub::Route route(const QByteArray &status, const QByteArray &body)
+{
+    HttpStub::Route r;
+    r.status = status;
+    r.body = body;
+    return r;
+}
+
+QByteArray readFile(const QString &path)
+{
+    QFile f(path);
+    return f.open(QIODevice::ReadOnly) ? f.readAll() : QByteArray();
+}
+
+}
+
+// remote sources fetched from a local http server into the cache
+class SourceCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init()
+    {
+        stub.reset(new HttpStub);
+        QVERIFY(stub->isListening());
+        QVERIFY(QDir(SourceCache().cacheDir()).removeRecursively());
+    }
+
+    void cleanup()
+    {
+        stub.reset();
+    }
+
+    void hit()
+    {
+        const QByteArray clip(4096, 'v');
+        stub->routes.insert("/clip.mp4", route("200 OK", clip));
+        const QUrl url = stub->url("/clip.mp4");
+
+        {
+            SourceCache cache;
+            QSignalSpy ready(&cache, &SourceCache::ready);
+            QVERIFY(cache.resolve(url).isEmpty());
+            QTRY_COMPARE(ready.count(), 1);
+            QCOMPARE(ready.first().first().toUrl(), url);
+
+            const QUrl local = cache.resolve(url);
+            QVERIFY(local.isLocalFile());
+            QCOMPARE(readFile(local.toLocalFile()), clip);
+            QCOMPARE(cache.clipSize(url), clip.size());
+        }
+
+        // played from the disk by the next start as well, never fetched again
+        SourceCache cache;
+        QVERIFY(cache.resolve(url).isLocalFile());
+        QTest::qWait(100);
+        QCOMPARE(stub->requests.value("/clip.mp4").size(), 1);
+        QCOMPARE(cache.stats().value("fetching").toInt(), 0);
+    }
+
+    // announced larger than the quota, aborted before the body
+    void contentLength()
+    {
+        // nothing of the body is sent, only the header can end the fetch.
+        HttpStub::Route large = route("200 OK", QByteArray());
+        large.announced = 1000;
+        large.hold = true;
+        stub->routes.insert("/large.mp4", large);
+        const QUrl url = stub->url("/large.mp4");
+
+        SourceCache cache;
+        cache.setQuota(100);
+        QSignalSpy ready(&cache, &SourceCache::ready);
+        QVERIFY(cache.resolve(url).isEmpty());
+        QTRY_COMPARE(ready.count(), 1);
+
+        // the players take it from the network, it is not asked for again.
+        QCOMPARE(cache.resolve(url), url);
+        QCOMPARE(cache.stats().value("rejected").toInt(), 1);
+        QCOMPARE(cache.stats().value("fetching").toInt(), 0);
+        QTRY_VERIFY(QDir(cache.cacheDir()).entryList(QDir::Files).isEmpty());
+        QCOMPARE(stub->requests.value("/large.mp4").size(), 1);
+    }
+
+    // no length given, aborted once more than the quota arrived
+    void streaming()
+    {
+        // the connection stays open, only the quota can end the fetch.
+        HttpStub::Route live = route("200 OK", QByteArray(150, 'v'));
+        live.length = false;
+        live.hold = true;
+        stub->routes.insert("/live.mp4", live);
+        const QUrl url = stub->url("/live.mp4");
+
+        SourceCache cache;
+        cache.setQuota(100);
+        QSignalSpy ready(&cache, &SourceCache::ready);
+        QVERIFY(cache.resolve(url).isEmpty());
+        QTRY_COMPARE(ready.count(), 1);
+
+        QCOMPARE(cache.resolve(url), url);
+        QCOMPARE(cache.stats().value("rejected").toInt(), 1);
+        QTRY_VERIFY(QDir(cache.cacheDir()).entryList(QDir::Files).isEmpty());
+    }
+
+    // a failed fetch is tried again, but not at once
+    void backoff()
+    {
+        stub->routes.insert("/flaky.mp4", route("503 Service Unavailable", QByteArray()));
+        const QUrl url = stub->url("/flaky.mp4");
+
+        SourceCache cache;
+        QSignalSpy ready(&cache, &SourceCache::ready);
+        QVERIFY(cache.resolve(url).isEmpty());
+        QTRY_COMPARE(stub->requests.value("/flaky.mp4").size(), 1);
+
+        // still waiting for the retry, resolving does not fetch it meanwhile.
+        QTest::qWait(1000);
+        QVERIFY(cache.resolve(url).isEmpty());
+        QCOMPARE(stub->requests.value("/flaky.mp4").size(), 1);
+
+        const QByteArray clip(512, 'v');
+        stub->routes.insert("/flaky.mp4", route("200 OK", clip));
+        QTRY_COMPARE_WITH_TIMEOUT(ready.count(), 1, 15000);
+        const QList<qint64> times = stub->requests.value("/flaky.mp4");
+        QCOMPARE(times.size(), 2);
+        QVERIFY2(times.at(1) - times.at(0) >= 4500, qPrintable(QString::number(times.at(1) - times.at(0))));
+        QCOMPARE(readFile(cache.resolve(url).toLocalFile()), clip);
+    }
+
+private:
+    QScopedPointer<HttpStub> stub;
+};
+
+VW_REGISTER_TEST(SourceCacheTest)
+
+#include "tst_sourcecache.moc"